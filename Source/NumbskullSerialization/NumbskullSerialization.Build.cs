@@ -25,6 +25,9 @@ namespace UnrealBuildTool.Rules
 				"Engine",
 				}
 				);
+
+			// Preset dictionaries aren't exposed through FCompression
+			AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "ActorData.h"
+
+void FActorData::SerializeStream(FArchive& Ar)
+{
+    if (Ar.IsSaving())
+    {
+        // Data refers to its bulk data by index, so it's useless without it
+        if (!BulkData.IsEmpty())
+        {
+            int32 Marker = BulkDataMarker;
+            Ar << Marker;
+            Ar << Data;
+            Ar << Transform;
+            BulkData.Serialize(Ar);
+        }
+        else
+        {
+            Ar << Data;
+            Ar << Transform;
+        }
+        return;
+    }
+
+    BulkData.Reset();
+
+    int32 NumBytes = 0;
+    Ar << NumBytes;
+
+    if (NumBytes == BulkDataMarker)
+    {
+        Ar << Data;
+        Ar << Transform;
+        BulkData.Serialize(Ar);
+        return;
+    }
+
+    // Otherwise this was the size of a plain byte array
+    Data.LoadBytes(Ar, NumBytes);
+    Ar << Transform;
+}
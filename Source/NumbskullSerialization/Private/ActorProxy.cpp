@@ -0,0 +1,45 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "ActorProxy.h"
+
+void FActorProxy::SerializeStream(FArchive& Ar)
+{
+    Ar << ActorClass;
+    Ar << ActorName;
+    Ar << ActorTransform;
+
+    if (Ar.IsSaving())
+    {
+        // ActorData refers to its bulk data by index, so it's useless without it
+        if (!PossessedBy.IsEmpty() || !BulkData.IsEmpty())
+        {
+            int32 Marker = ExtendedMarker;
+            Ar << Marker;
+            Ar << ActorData;
+            Ar << PossessedBy;
+            BulkData.Serialize(Ar);
+        }
+        else
+        {
+            Ar << ActorData;
+        }
+        return;
+    }
+
+    PossessedBy.Reset();
+    BulkData.Reset();
+
+    int32 NumBytes = 0;
+    Ar << NumBytes;
+
+    if (NumBytes == ExtendedMarker)
+    {
+        Ar << ActorData;
+        Ar << PossessedBy;
+        BulkData.Serialize(Ar);
+        return;
+    }
+
+    // Otherwise this was the size of a plain byte array
+    ActorData.LoadBytes(Ar, NumBytes);
+}
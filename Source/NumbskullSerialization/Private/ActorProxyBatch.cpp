@@ -0,0 +1,165 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "ActorProxyBatch.h"
+#include "NumbskullTransformCodec.h"
+
+void FActorProxyBatch::Reset()
+{
+    Classes.Reset();
+    ClassIndices.Reset();
+    Names.Reset();
+    Transforms.Reset();
+    PayloadOffsets.Reset();
+    PossessedBy.Reset();
+    if (Payload.IsUnique())
+    {
+        Payload.GetMutable().Reset();
+    }
+    else
+    {
+        Payload.Reset();
+    }
+    References = FNumbskullReferenceTable();
+    ClassLookup.Reset();
+}
+
+void FActorProxyBatch::Reserve(int32 NumActors)
+{
+    ClassIndices.Reserve(NumActors);
+    Names.Reserve(NumActors);
+    Transforms.Reserve(NumActors);
+    PayloadOffsets.Reserve(NumActors);
+    PossessedBy.Reserve(NumActors);
+}
+
+void FActorProxyBatch::Add(const FActorProxy& InActorProxy)
+{
+    // Standalone proxies store references as paths, which can't be mixed with a reference table
+    ensureMsgf(!References.bEnabled, TEXT("Can't add an actor proxy to a batch with a reference table"));
+
+    Add(InActorProxy.ActorClass, InActorProxy.ActorName, InActorProxy.ActorTransform, InActorProxy.ActorData.GetData(), InActorProxy.ActorData.Num(), InActorProxy.PossessedBy);
+}
+
+void FActorProxyBatch::Add(const FString& InActorClass, FName InActorName, const FTransform& InActorTransform, const uint8* InData, int32 InNumBytes, const FString& InPossessedBy)
+{
+    // Batches loaded from disk don't have the lookup yet
+    if (ClassLookup.Num() != Classes.Num())
+    {
+        ClassLookup.Reset();
+        for (int32 Index = 0; Index < Classes.Num(); ++Index)
+        {
+            ClassLookup.Add(Classes[Index], Index);
+        }
+    }
+
+    int32 ClassIndex = INDEX_NONE;
+    if (const int32* ExistingIndex = ClassLookup.Find(InActorClass))
+    {
+        ClassIndex = *ExistingIndex;
+    }
+    else
+    {
+        ClassIndex = Classes.Add(InActorClass);
+        ClassLookup.Add(InActorClass, ClassIndex);
+    }
+
+    ClassIndices.Add(ClassIndex);
+    Names.Add(InActorName);
+    Transforms.Add(InActorTransform);
+    PayloadOffsets.Add(Payload.Num());
+    PossessedBy.Add(InPossessedBy);
+    Payload.GetMutable().Append(InData, InNumBytes);
+}
+
+int32 FActorProxyBatch::GetDataSize(int32 Index) const
+{
+    const int32 End = PayloadOffsets.IsValidIndex(Index + 1) ? PayloadOffsets[Index + 1] : Payload.Num();
+    return End - PayloadOffsets[Index];
+}
+
+void FActorProxyBatch::GetActorProxy(int32 Index, FActorProxy& OutActorProxy) const
+{
+    OutActorProxy.ActorClass = Classes[ClassIndices[Index]];
+    OutActorProxy.ActorName = Names[Index];
+    OutActorProxy.ActorTransform = Transforms[Index];
+    OutActorProxy.ActorData = TArray<uint8>(GetData(Index), GetDataSize(Index));
+    OutActorProxy.PossessedBy = PossessedBy[Index];
+}
+
+bool FActorProxyBatch::IsValid() const
+{
+    const int32 NumActors = ClassIndices.Num();
+
+    if (Names.Num() != NumActors || Transforms.Num() != NumActors || PayloadOffsets.Num() != NumActors || PossessedBy.Num() != NumActors)
+    {
+        return false;
+    }
+
+    for (int32 Index = 0; Index < NumActors; ++Index)
+    {
+        if (!Classes.IsValidIndex(ClassIndices[Index]))
+        {
+            return false;
+        }
+
+        const int32 Start = PayloadOffsets[Index];
+        const int32 End = Index + 1 < NumActors ? PayloadOffsets[Index + 1] : Payload.Num();
+
+        if (Start < 0 || Start > End || End > Payload.Num())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FActorProxyBatch::SerializeStream(FArchive& Ar)
+{
+    // Streams carry their own version, as there's no file header to describe them
+    FNumbskullFileHeader Header;
+    Header.Version = ENumbskullFileVersion::Latest;
+    Ar << Header.Version;
+
+    if (Ar.IsLoading() && (Header.Version < ENumbskullFileVersion::AddedFileHeader || Header.Version > ENumbskullFileVersion::Latest))
+    {
+        Ar.SetError();
+        return;
+    }
+
+    SerializeVersioned(Ar, Header);
+}
+
+void FActorProxyBatch::SerializeVersioned(FArchive& Ar, const FNumbskullFileHeader& Header)
+{
+    Ar << Classes;
+    Ar << ClassIndices;
+    Ar << Names;
+    FNumbskullTransformCodec::SerializeArray(Ar, Transforms, Header.TransformFormat);
+    Ar << PayloadOffsets;
+    Ar << Payload;
+
+    if (Header.Version >= ENumbskullFileVersion::AddedReferenceTable)
+    {
+        Ar << References;
+    }
+
+    if (Header.Version >= ENumbskullFileVersion::AddedPossessedBy)
+    {
+        Ar << PossessedBy;
+    }
+    else if (Ar.IsLoading())
+    {
+        PossessedBy.SetNum(ClassIndices.Num());
+    }
+
+    if (Ar.IsLoading())
+    {
+        ClassLookup.Reset();
+
+        if (!IsValid())
+        {
+            Ar.SetError();
+        }
+    }
+}
@@ -0,0 +1,39 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NewGameSnapshot.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+const TCHAR* FNewGameSnapshot::Extension = TEXT(".nskng");
+
+FString FNewGameSnapshot::GetFileName(const FString& InMapName)
+{
+    // Mirrors the map's package path, so maps with the same name in different folders don't collide
+    FString RelativeName = InMapName;
+    RelativeName.RemoveFromStart(TEXT("/"));
+
+    return FPaths::ProjectContentDir() / TEXT("Numbskull") / TEXT("NewGame") / RelativeName + Extension;
+}
+
+namespace
+{
+    /**
+     * Numbskull.BakeNewGame
+     *
+     * Bakes the new game of the current map. Run it in a standalone game started on the map, for example:
+     * UE4Editor MyGame.uproject /Game/Maps/Start -game -ExecCmds="Numbskull.BakeNewGame, Quit"
+     */
+    void RunBakeNewGame(UWorld* InWorld)
+    {
+        UNumbskullSerializationBPLibrary::BakeNewGame(InWorld);
+    }
+
+    FAutoConsoleCommandWithWorld BakeNewGameCommand(
+        TEXT("Numbskull.BakeNewGame"),
+        TEXT("Runs the new game setup of every listener that can be baked in the current map and saves the result to apply at each new game"),
+        FConsoleCommandWithWorldDelegate::CreateStatic(&RunBakeNewGame));
+}
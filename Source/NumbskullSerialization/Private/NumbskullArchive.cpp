@@ -0,0 +1,106 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullArchive.h"
+#include "NumbskullReferenceTable.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "UObject/UnrealType.h"
+
+namespace
+{
+    /** Most recently created archive on each thread. Archives are created on the stack, so they nest*/
+    thread_local FNumbskullArchive* ActiveArchive = nullptr;
+}
+
+FNumbskullArchive::FNumbskullArchive(FArchive& InInnerArchive, bool bInLoadIfFindFails)
+: FObjectAndNameAsStringProxyArchive(InInnerArchive, bInLoadIfFindFails)
+, Previous(ActiveArchive)
+{
+    ActiveArchive = this;
+}
+
+FNumbskullArchive::~FNumbskullArchive()
+{
+    check(ActiveArchive == this);
+    ActiveArchive = Previous;
+}
+
+const FNumbskullArchive* FNumbskullArchive::Find(const FArchive& Ar)
+{
+    for (const FNumbskullArchive* Archive = ActiveArchive; Archive; Archive = Archive->Previous)
+    {
+        if (Archive == &Ar)
+        {
+            return Archive;
+        }
+    }
+    return nullptr;
+}
+
+FArchive& FNumbskullArchive::operator<<(UObject*& Obj)
+{
+    if (IsSaving() && ReferenceWriter)
+    {
+        int32 Id = ReferenceWriter->GetReferenceId(Obj);
+        InnerArchive << Id;
+        return *this;
+    }
+
+    // Resolved as it's read, as the value may be a temporary that's moved into a container afterwards
+    if (IsLoading() && ReferenceReader)
+    {
+        Obj = ReadReference();
+        return *this;
+    }
+
+    return FObjectAndNameAsStringProxyArchive::operator<<(Obj);
+}
+
+FArchive& FNumbskullArchive::operator<<(FWeakObjectPtr& Obj)
+{
+    if (IsSaving() && ReferenceWriter)
+    {
+        UObject* Object = Obj.Get(true);
+        return *this << Object;
+    }
+
+    if (IsLoading() && ReferenceReader)
+    {
+        Obj = ReadReference();
+        return *this;
+    }
+
+    return FObjectAndNameAsStringProxyArchive::operator<<(Obj);
+}
+
+void FNumbskullArchive::SkipProperty(const FProperty* InProperty)
+{
+    if (InProperty)
+    {
+        SkippedProperties.Add(InProperty);
+    }
+}
+
+bool FNumbskullArchive::ShouldSkipProperty(const FProperty* InProperty) const
+{
+    return SkippedProperties.Contains(InProperty) || FObjectAndNameAsStringProxyArchive::ShouldSkipProperty(InProperty);
+}
+
+UObject* FNumbskullArchive::ReadReference()
+{
+    int32 Id = ENumbskullReferenceId::Null;
+    InnerArchive << Id;
+
+    if (Id >= 0)
+    {
+        return ReferenceReader->ResolveId(Id);
+    }
+
+    if (Id != ENumbskullReferenceId::Null)
+    {
+        UE_LOG(Serializer, Error, TEXT("Invalid object reference id %d"), Id);
+        SetError();
+    }
+
+    return nullptr;
+}
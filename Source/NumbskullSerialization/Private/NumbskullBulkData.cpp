@@ -0,0 +1,305 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullBulkData.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+const int64 FNumbskullBulkData::SectionAlignment = 4096;
+const int64 FNumbskullBulkData::EntryAlignment = 64;
+
+struct FNumbskullBulkData::FFileSection
+{
+    /** Full path. Size and modification time detect the file being changed behind the library's back*/
+    FString FileName;
+
+    int64 Offset = 0;
+
+    int64 Size = 0;
+
+    int64 FileSize = 0;
+
+    FDateTime ModificationTime;
+
+    /** The section, once the file was detached. Read from here from then on*/
+    TArray<uint8> Detached;
+
+    bool bDetached = false;
+
+    FCriticalSection CriticalSection;
+
+    /** Reads part of the section, from wherever it is now*/
+    bool Read(int64 InOffset, void* OutData, int64 InNumBytes)
+    {
+        FScopeLock Lock(&CriticalSection);
+
+        if (bDetached)
+        {
+            FMemory::Memcpy(OutData, Detached.GetData() + InOffset, InNumBytes);
+            return true;
+        }
+
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+        const FFileStatData StatData = PlatformFile.GetStatData(*FileName);
+        if (!StatData.bIsValid || StatData.FileSize != FileSize || StatData.ModificationTime != ModificationTime)
+        {
+            UE_LOG(Serializer, Error, TEXT("{%s} changed since it was loaded, so its bulk data can't be read"), *FileName);
+            return false;
+        }
+
+        // One read straight into the destination, from an aligned offset
+        TUniquePtr<IFileHandle> Handle(PlatformFile.OpenRead(*FileName));
+
+        if (!Handle || !Handle->Seek(Offset + InOffset) || !Handle->Read(static_cast<uint8*>(OutData), InNumBytes))
+        {
+            UE_LOG(Serializer, Error, TEXT("Couldn't read bulk data from {%s}"), *FileName);
+            return false;
+        }
+
+        return true;
+    }
+};
+
+namespace
+{
+    FCriticalSection BoundFilesLock;
+
+    /** Sections still read from each file, by full path*/
+    TMultiMap<FString, TWeakPtr<FNumbskullBulkData::FFileSection, ESPMode::ThreadSafe>> BoundFiles;
+
+    FString GetFullPath(const FString& InFileName)
+    {
+        FString FullPath = FPaths::ConvertRelativePathToFull(InFileName);
+        FPaths::NormalizeFilename(FullPath);
+        return FullPath;
+    }
+}
+
+void FNumbskullBulkData::LogMissing(int32 InIndex)
+{
+    UE_LOG(Serializer, Error, TEXT("Data stores array %d out of line, but was applied without its bulk data"), InIndex);
+}
+
+int32 FNumbskullBulkData::Add(const void* InData, int64 InNumBytes)
+{
+    // Anything loaded from a file has to be pulled into memory before it can be added to
+    if (File.IsValid())
+    {
+        TArray<uint8> LoadedSection;
+        GetSection(LoadedSection);
+        Section = MoveTemp(LoadedSection);
+        File.Reset();
+    }
+
+    TArray<uint8>& Bytes = Section.GetMutable();
+
+    FEntry& Entry = Entries.AddDefaulted_GetRef();
+    Entry.Offset = Align(static_cast<int64>(Bytes.Num()), EntryAlignment);
+    Entry.Size = InNumBytes;
+
+    Bytes.SetNumZeroed(static_cast<int32>(Entry.Offset));
+    Bytes.Append(static_cast<const uint8*>(InData), static_cast<int32>(InNumBytes));
+
+    return Entries.Num() - 1;
+}
+
+bool FNumbskullBulkData::Read(int32 InIndex, void* OutData, int64 InNumBytes) const
+{
+    if (!Entries.IsValidIndex(InIndex) || Entries[InIndex].Size != InNumBytes)
+    {
+        UE_LOG(Serializer, Error, TEXT("Bulk data has no array %d of %lld bytes"), InIndex, InNumBytes);
+        return false;
+    }
+
+    const FEntry& Entry = Entries[InIndex];
+
+    if (Entry.Size == 0)
+    {
+        return true;
+    }
+
+    if (!File.IsValid())
+    {
+        if (Entry.Offset + Entry.Size > Section.Num())
+        {
+            UE_LOG(Serializer, Error, TEXT("Bulk data array %d is outside its section"), InIndex);
+            return false;
+        }
+
+        FMemory::Memcpy(OutData, Section.GetData() + Entry.Offset, Entry.Size);
+        return true;
+    }
+
+    if (Entry.Offset + Entry.Size > File->Size)
+    {
+        UE_LOG(Serializer, Error, TEXT("Bulk data array %d is outside its section in {%s}"), InIndex, *File->FileName);
+        return false;
+    }
+
+    return File->Read(Entry.Offset, OutData, Entry.Size);
+}
+
+void FNumbskullBulkData::Reset()
+{
+    Entries.Reset();
+    Section.Reset();
+    File.Reset();
+}
+
+bool FNumbskullBulkData::GetSection(TArray<uint8>& OutSection) const
+{
+    if (!File.IsValid())
+    {
+        OutSection = Section.Get();
+        return true;
+    }
+
+    OutSection.SetNumUninitialized(static_cast<int32>(File->Size));
+
+    if (!File->Read(0, OutSection.GetData(), File->Size))
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't read the bulk data section of {%s}"), *File->FileName);
+        OutSection.Reset();
+        return false;
+    }
+
+    return true;
+}
+
+bool FNumbskullBulkData::BindFile(const FString& InFileName, int64 InSectionOffset, int64 InSectionSize)
+{
+    const FString FullPath = GetFullPath(InFileName);
+    const FFileStatData StatData = FPlatformFileManager::Get().GetPlatformFile().GetStatData(*FullPath);
+
+    if (!StatData.bIsValid || InSectionOffset < 0 || InSectionSize < 0 || InSectionSize > MAX_int32 || InSectionOffset + InSectionSize > StatData.FileSize)
+    {
+        UE_LOG(Serializer, Error, TEXT("{%s} is too small for its bulk data section"), *InFileName);
+        return false;
+    }
+
+    TSharedPtr<FFileSection, ESPMode::ThreadSafe> NewFile = MakeShared<FFileSection, ESPMode::ThreadSafe>();
+    NewFile->FileName = FullPath;
+    NewFile->Offset = InSectionOffset;
+    NewFile->Size = InSectionSize;
+    NewFile->FileSize = StatData.FileSize;
+    NewFile->ModificationTime = StatData.ModificationTime;
+
+    {
+        FScopeLock Lock(&BoundFilesLock);
+
+        // Drops sections whose records are gone while we're here, so the map doesn't grow with every load
+        for (auto It = BoundFiles.CreateKeyIterator(FullPath); It; ++It)
+        {
+            if (!It.Value().IsValid())
+            {
+                It.RemoveCurrent();
+            }
+        }
+
+        BoundFiles.Add(FullPath, NewFile);
+    }
+
+    Section.Reset();
+    File = MoveTemp(NewFile);
+
+    return true;
+}
+
+void FNumbskullBulkData::DetachFile(const FString& InFileName)
+{
+    const FString FullPath = GetFullPath(InFileName);
+
+    TArray<TWeakPtr<FFileSection, ESPMode::ThreadSafe>> Sections;
+
+    {
+        FScopeLock Lock(&BoundFilesLock);
+        BoundFiles.MultiFind(FullPath, Sections);
+        BoundFiles.Remove(FullPath);
+    }
+
+    for (const TWeakPtr<FFileSection, ESPMode::ThreadSafe>& WeakSection : Sections)
+    {
+        const TSharedPtr<FFileSection, ESPMode::ThreadSafe> FileSection = WeakSection.Pin();
+
+        if (!FileSection.IsValid())
+        {
+            continue;
+        }
+
+        TArray<uint8> Bytes;
+        Bytes.SetNumUninitialized(static_cast<int32>(FileSection->Size));
+
+        if (FileSection->Read(0, Bytes.GetData(), Bytes.Num()))
+        {
+            FScopeLock Lock(&FileSection->CriticalSection);
+            FileSection->Detached = MoveTemp(Bytes);
+            FileSection->bDetached = true;
+        }
+        else
+        {
+            UE_LOG(Serializer, Warning, TEXT("Couldn't keep the bulk data of {%s} before it was overwritten"), *FullPath);
+        }
+    }
+}
+
+FArchive& operator << (FArchive& Ar, FNumbskullBulkData& BulkData)
+{
+    if (Ar.IsLoading())
+    {
+        BulkData.Reset();
+    }
+
+    Ar << BulkData.Entries;
+    return Ar;
+}
+
+bool FNumbskullBulkData::Serialize(FArchive& Ar)
+{
+    // There's no file section to put the arrays in, so they go inline after the entries
+    if (Ar.IsLoading())
+    {
+        Reset();
+
+        TArray<uint8> Bytes;
+        Ar << Entries;
+        Ar << Bytes;
+        Section = MoveTemp(Bytes);
+
+        return true;
+    }
+
+    TArray<uint8> Bytes;
+    GetSection(Bytes);
+
+    Ar << Entries;
+    Ar << Bytes;
+
+    return true;
+}
+
+bool FNumbskullBulkData::operator==(const FNumbskullBulkData& Other) const
+{
+    if (Entries.Num() == 0 && Other.Entries.Num() == 0)
+    {
+        return true;
+    }
+
+    if (Entries.Num() != Other.Entries.Num() || File != Other.File || !(Section == Other.Section))
+    {
+        return false;
+    }
+
+    for (int32 Index = 0; Index < Entries.Num(); ++Index)
+    {
+        if (Entries[Index].Offset != Other.Entries[Index].Offset || Entries[Index].Size != Other.Entries[Index].Size)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
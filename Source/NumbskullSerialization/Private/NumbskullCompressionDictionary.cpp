@@ -0,0 +1,431 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullCompressionDictionary.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/CompressionFlags.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+const int32 FNumbskullCompressionDictionary::MaxSize = 32 * 1024;
+const TCHAR* FNumbskullCompressionDictionary::Extension = TEXT(".nskdict");
+
+namespace
+{
+    using FDictionaryPtr = TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe>;
+
+    /** Dictionaries loaded from disk, shared by every thread that saves or loads*/
+    struct FDictionaryRegistry
+    {
+        FCriticalSection CriticalSection;
+
+        TMap<uint32, FDictionaryPtr> ById;
+
+        TMap<FString, FDictionaryPtr> ByName;
+
+        bool bScanned = false;
+
+        static FDictionaryRegistry& Get()
+        {
+            static FDictionaryRegistry Registry;
+            return Registry;
+        }
+
+        void Add(const FDictionaryPtr& InDictionary)
+        {
+            ById.Add(InDictionary->Id, InDictionary);
+            ByName.Add(InDictionary->Name, InDictionary);
+        }
+
+        /** Must be called with the lock held*/
+        void ScanIfNeeded()
+        {
+            if (bScanned)
+            {
+                return;
+            }
+
+            bScanned = true;
+
+            const FString Directory = FNumbskullCompressionDictionary::GetDirectory();
+
+            TArray<FString> Files;
+            IFileManager::Get().FindFiles(Files, *(Directory / (FString(TEXT("*")) + FNumbskullCompressionDictionary::Extension)), true, false);
+
+            for (const FString& File : Files)
+            {
+                TSharedRef<FNumbskullCompressionDictionary, ESPMode::ThreadSafe> Dictionary = MakeShared<FNumbskullCompressionDictionary, ESPMode::ThreadSafe>();
+
+                if (!FFileHelper::LoadFileToArray(Dictionary->Bytes, *(Directory / File)) || Dictionary->Bytes.Num() == 0)
+                {
+                    UE_LOG(Serializer, Warning, TEXT("Couldn't load compression dictionary {%s}"), *File);
+                    continue;
+                }
+
+                Dictionary->Name = FPaths::GetBaseFilename(File);
+                Dictionary->Id = FNumbskullCompressionDictionary::MakeId(Dictionary->Bytes);
+
+                if (const FDictionaryPtr* Existing = ById.Find(Dictionary->Id))
+                {
+                    UE_LOG(Serializer, Warning, TEXT("Compression dictionaries %s and %s are identical"), *(*Existing)->Name, *Dictionary->Name);
+                }
+
+                Add(Dictionary);
+            }
+        }
+    };
+
+    /** Length of the byte sequences counted while training. Eight bytes fit a uint64, so they're compared exactly*/
+    const int32 DmerSize = 8;
+
+    /** Length of the pieces of samples the dictionary is built from*/
+    const int32 SegmentSize = 64;
+
+    struct FSegment
+    {
+        int64 Score = 0;
+        int32 Start = 0;
+        int32 Length = 0;
+    };
+
+    uint64 ReadDmer(const uint8* Data)
+    {
+        uint64 Dmer;
+        FMemory::Memcpy(&Dmer, Data, sizeof(Dmer));
+        return Dmer;
+    }
+
+    int32 GetCompressionLevel(uint32 InFlags)
+    {
+        if (InFlags & COMPRESS_BiasSpeed)
+        {
+            return Z_BEST_SPEED;
+        }
+        if (InFlags & COMPRESS_BiasMemory)
+        {
+            return Z_BEST_COMPRESSION;
+        }
+        return Z_DEFAULT_COMPRESSION;
+    }
+}
+
+FString FNumbskullCompressionDictionary::GetDirectory()
+{
+    return FPaths::ProjectContentDir() / TEXT("Numbskull") / TEXT("Dictionaries");
+}
+
+uint32 FNumbskullCompressionDictionary::MakeId(const TArray<uint8>& InBytes)
+{
+    // Zero means a file has no dictionary
+    const uint32 Crc = FCrc::MemCrc32(InBytes.GetData(), InBytes.Num());
+    return Crc != 0 ? Crc : 1;
+}
+
+bool FNumbskullCompressionDictionary::Train(const TArray<TArray<uint8>>& InSamples, int32 InMaxSize, TArray<uint8>& OutBytes)
+{
+    OutBytes.Reset();
+
+    const int32 TargetSize = FMath::Clamp(InMaxSize, SegmentSize, MaxSize);
+
+    // Samples laid end to end, with where each one ends
+    TArray<uint8> Corpus;
+    TArray<int32> SampleEnds;
+
+    for (const TArray<uint8>& Sample : InSamples)
+    {
+        if (Sample.Num() >= DmerSize)
+        {
+            Corpus.Append(Sample);
+            SampleEnds.Add(Corpus.Num());
+        }
+    }
+
+    if (SampleEnds.Num() < 2)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Need at least two samples to train a compression dictionary"));
+        return false;
+    }
+
+    // How many samples each sequence appears in. Sequences only one sample has don't help any other
+    TMap<uint64, int32> Frequencies;
+    {
+        TSet<uint64> SeenInSample;
+        int32 SampleStart = 0;
+
+        for (const int32 SampleEnd : SampleEnds)
+        {
+            SeenInSample.Reset();
+
+            for (int32 Position = SampleStart; Position + DmerSize <= SampleEnd; ++Position)
+            {
+                const uint64 Dmer = ReadDmer(&Corpus[Position]);
+
+                bool bAlreadySeen = false;
+                SeenInSample.Add(Dmer, &bAlreadySeen);
+
+                if (!bAlreadySeen)
+                {
+                    ++Frequencies.FindOrAdd(Dmer);
+                }
+            }
+
+            SampleStart = SampleEnd;
+        }
+    }
+
+    auto GetFrequency = [&](int32 Position)
+    {
+        const int32* Frequency = Frequencies.Find(ReadDmer(&Corpus[Position]));
+        return Frequency && *Frequency > 1 ? *Frequency : 0;
+    };
+
+    const int32 NumEpochs = FMath::Max(1, TargetSize / SegmentSize);
+    const int32 EpochSize = FMath::Max(1, Corpus.Num() / NumEpochs);
+
+    TArray<FSegment> Segments;
+    int32 FirstSample = 0;
+
+    for (int32 Epoch = 0; Epoch < NumEpochs; ++Epoch)
+    {
+        const int32 EpochStart = Epoch * EpochSize;
+        const int32 EpochEnd = Epoch == NumEpochs - 1 ? Corpus.Num() : EpochStart + EpochSize;
+
+        FSegment Best;
+
+        for (int32 SampleIndex = FirstSample; SampleIndex < SampleEnds.Num(); ++SampleIndex)
+        {
+            const int32 SampleStart = SampleIndex > 0 ? SampleEnds[SampleIndex - 1] : 0;
+            const int32 SampleEnd = SampleEnds[SampleIndex];
+
+            if (SampleStart >= EpochEnd)
+            {
+                break;
+            }
+
+            if (SampleEnd <= EpochStart)
+            {
+                FirstSample = SampleIndex + 1;
+                continue;
+            }
+
+            // Slides a window over the segments starting in this epoch, keeping a running score
+            const int32 Length = FMath::Min(SegmentSize, SampleEnd - SampleStart);
+            const int32 FirstStart = FMath::Max(SampleStart, EpochStart);
+            const int32 LastStart = FMath::Min(SampleEnd - Length, EpochEnd - 1);
+
+            if (FirstStart > LastStart)
+            {
+                continue;
+            }
+
+            int64 Score = 0;
+            for (int32 Position = FirstStart; Position <= FirstStart + Length - DmerSize; ++Position)
+            {
+                Score += GetFrequency(Position);
+            }
+
+            for (int32 Start = FirstStart; ; ++Start)
+            {
+                if (Score > Best.Score)
+                {
+                    Best.Score = Score;
+                    Best.Start = Start;
+                    Best.Length = Length;
+                }
+
+                if (Start == LastStart)
+                {
+                    break;
+                }
+
+                Score += GetFrequency(Start + Length - DmerSize + 1) - GetFrequency(Start);
+            }
+        }
+
+        if (Best.Score == 0)
+        {
+            continue;
+        }
+
+        // Sequences already in the dictionary are worth nothing in another segment
+        for (int32 Position = Best.Start; Position <= Best.Start + Best.Length - DmerSize; ++Position)
+        {
+            if (int32* Frequency = Frequencies.Find(ReadDmer(&Corpus[Position])))
+            {
+                *Frequency = 0;
+            }
+        }
+
+        Segments.Add(Best);
+    }
+
+    if (Segments.Num() == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Samples have nothing in common to build a compression dictionary from"));
+        return false;
+    }
+
+    // Zlib encodes matches closer to the data more cheaply, so the best segments go last
+    Segments.Sort([](const FSegment& A, const FSegment& B) { return A.Score < B.Score; });
+
+    for (const FSegment& Segment : Segments)
+    {
+        OutBytes.Append(&Corpus[Segment.Start], Segment.Length);
+    }
+
+    return true;
+}
+
+TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> FNumbskullCompressionDictionary::Save(const FString& InName, const TArray<uint8>& InBytes)
+{
+    if (InName.IsEmpty() || InBytes.Num() == 0 || InBytes.Num() > MaxSize)
+    {
+        UE_LOG(Serializer, Error, TEXT("Compression dictionaries need a name and between 1 and %d bytes"), MaxSize);
+        return nullptr;
+    }
+
+    const FString FileName = GetDirectory() / InName + Extension;
+
+    if (!FFileHelper::SaveArrayToFile(InBytes, *FileName))
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't save compression dictionary {%s}"), *FileName);
+        return nullptr;
+    }
+
+    TSharedRef<FNumbskullCompressionDictionary, ESPMode::ThreadSafe> Dictionary = MakeShared<FNumbskullCompressionDictionary, ESPMode::ThreadSafe>();
+    Dictionary->Name = InName;
+    Dictionary->Id = MakeId(InBytes);
+    Dictionary->Bytes = InBytes;
+
+    FDictionaryRegistry& Registry = FDictionaryRegistry::Get();
+    FScopeLock Lock(&Registry.CriticalSection);
+    Registry.ScanIfNeeded();
+    Registry.Add(Dictionary);
+
+    UE_LOG(Serializer, Log, TEXT("Saved compression dictionary %s (%08X) to {%s}"), *InName, Dictionary->Id, *FileName);
+
+    return Dictionary;
+}
+
+TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> FNumbskullCompressionDictionary::FindById(uint32 InId)
+{
+    FDictionaryRegistry& Registry = FDictionaryRegistry::Get();
+    FScopeLock Lock(&Registry.CriticalSection);
+    Registry.ScanIfNeeded();
+
+    const FDictionaryPtr* Dictionary = Registry.ById.Find(InId);
+    return Dictionary ? *Dictionary : nullptr;
+}
+
+TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> FNumbskullCompressionDictionary::FindByName(const FString& InName)
+{
+    FDictionaryRegistry& Registry = FDictionaryRegistry::Get();
+    FScopeLock Lock(&Registry.CriticalSection);
+    Registry.ScanIfNeeded();
+
+    const FDictionaryPtr* Dictionary = Registry.ByName.Find(InName);
+    return Dictionary ? *Dictionary : nullptr;
+}
+
+void FNumbskullCompressionDictionary::Rescan()
+{
+    FDictionaryRegistry& Registry = FDictionaryRegistry::Get();
+    FScopeLock Lock(&Registry.CriticalSection);
+
+    Registry.ById.Reset();
+    Registry.ByName.Reset();
+    Registry.bScanned = false;
+    Registry.ScanIfNeeded();
+}
+
+bool FNumbskullCompressionDictionary::Compress(const TArray<uint8>& InBytes, TArray<uint8>& OutCompressedBytes, uint32 InFlags) const
+{
+    z_stream Stream;
+    FMemory::Memzero(Stream);
+
+    // Raw deflate, the file header already says what the stream is and which dictionary it needs
+    if (deflateInit2(&Stream, GetCompressionLevel(InFlags), Z_DEFLATED, -MAX_WBITS, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+
+    bool bSuccess = deflateSetDictionary(&Stream, Bytes.GetData(), Bytes.Num()) == Z_OK;
+
+    if (bSuccess)
+    {
+        const int32 RawSize = InBytes.Num();
+        const int32 HeaderSize = sizeof(RawSize);
+        const int32 Bound = static_cast<int32>(deflateBound(&Stream, RawSize));
+
+        OutCompressedBytes.SetNumUninitialized(HeaderSize + Bound);
+        FMemory::Memcpy(OutCompressedBytes.GetData(), &RawSize, HeaderSize);
+
+        Stream.next_in = const_cast<Bytef*>(InBytes.GetData());
+        Stream.avail_in = RawSize;
+        Stream.next_out = OutCompressedBytes.GetData() + HeaderSize;
+        Stream.avail_out = Bound;
+
+        bSuccess = deflate(&Stream, Z_FINISH) == Z_STREAM_END;
+
+        OutCompressedBytes.SetNum(HeaderSize + static_cast<int32>(Stream.total_out), false);
+    }
+
+    deflateEnd(&Stream);
+
+    return bSuccess;
+}
+
+bool FNumbskullCompressionDictionary::Decompress(const uint8* InCompressedBytes, int64 InNumBytes, TArray<uint8>& OutBytes) const
+{
+    int32 RawSize = 0;
+    const int32 HeaderSize = sizeof(RawSize);
+
+    if (InNumBytes < HeaderSize)
+    {
+        return false;
+    }
+
+    FMemory::Memcpy(&RawSize, InCompressedBytes, HeaderSize);
+
+    // Deflate can't shrink data by more than about 1032 to 1, so a larger size is corrupt and isn't worth allocating
+    const int64 MaxRawSize = (InNumBytes - HeaderSize) * 1032 + 1024;
+
+    if (RawSize < 0 || RawSize > MaxRawSize)
+    {
+        UE_LOG(Serializer, Error, TEXT("Dictionary compressed data claims %d bytes from %lld, so it's corrupt"), RawSize, InNumBytes);
+        return false;
+    }
+
+    z_stream Stream;
+    FMemory::Memzero(Stream);
+
+    if (inflateInit2(&Stream, -MAX_WBITS) != Z_OK)
+    {
+        return false;
+    }
+
+    bool bSuccess = inflateSetDictionary(&Stream, Bytes.GetData(), Bytes.Num()) == Z_OK;
+
+    if (bSuccess)
+    {
+        OutBytes.SetNumUninitialized(RawSize);
+
+        Stream.next_in = const_cast<Bytef*>(InCompressedBytes + HeaderSize);
+        Stream.avail_in = static_cast<uInt>(InNumBytes - HeaderSize);
+        Stream.next_out = OutBytes.GetData();
+        Stream.avail_out = RawSize;
+
+        bSuccess = inflate(&Stream, Z_FINISH) == Z_STREAM_END && Stream.total_out == static_cast<uLong>(RawSize);
+    }
+
+    inflateEnd(&Stream);
+
+    return bSuccess;
+}
@@ -0,0 +1,121 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullFileHeader.h"
+#include "NumbskullCompressionDictionary.h"
+#include "NumbskullSerializationBPLibrary.h"
+#include "NumbskullSerializationSettings.h"
+
+#include "Misc/Compression.h"
+
+// 'NSKF'
+const uint32 FNumbskullFileHeader::Magic = 0x464B534E;
+
+FNumbskullFileHeader FNumbskullFileHeader::FromSettings()
+{
+    const UNumbskullSerializationSettings* Settings = GetDefault<UNumbskullSerializationSettings>();
+
+    FNumbskullFileHeader Header;
+    Header.Version = ENumbskullFileVersion::Latest;
+    Header.TransformFormat = Settings->TransformFormat;
+    Header.CompressionFormat = Settings->CompressionFormat;
+    Header.CompressionFlags = Settings->GetCompressionFlags();
+
+    if (!Settings->CompressionDictionary.IsEmpty())
+    {
+        const TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> Dictionary = FNumbskullCompressionDictionary::FindByName(Settings->CompressionDictionary);
+
+        if (Dictionary.IsValid())
+        {
+            Header.CompressionFormat = NAME_Zlib;
+            Header.DictionaryId = Dictionary->Id;
+        }
+        else
+        {
+            UE_LOG(Serializer, Warning, TEXT("Compression dictionary %s wasn't found in {%s}. Compressing without it"), *Settings->CompressionDictionary, *FNumbskullCompressionDictionary::GetDirectory());
+        }
+    }
+
+    return Header;
+}
+
+bool FNumbskullFileHeader::Read(FArchive& Ar, FNumbskullFileHeader& OutHeader)
+{
+    check(Ar.IsLoading());
+
+    const int64 Start = Ar.Tell();
+
+    uint32 FileMagic = 0;
+    if (Ar.TotalSize() - Start >= static_cast<int64>(sizeof(FileMagic)))
+    {
+        Ar << FileMagic;
+    }
+
+    if (FileMagic != Magic)
+    {
+        Ar.Seek(Start);
+        OutHeader = FNumbskullFileHeader();
+        return true;
+    }
+
+    Ar.Seek(Start);
+    Ar << OutHeader;
+
+    return !Ar.IsError();
+}
+
+FArchive& operator << (FArchive& Ar, FNumbskullFileHeader& Header)
+{
+    uint32 FileMagic = FNumbskullFileHeader::Magic;
+    Ar << FileMagic;
+    Ar << Header.Version;
+
+    if (Header.Version > ENumbskullFileVersion::Latest)
+    {
+        UE_LOG(Serializer, Error, TEXT("File version %u is newer than the supported version %u"), Header.Version, static_cast<uint32>(ENumbskullFileVersion::Latest));
+        Ar.SetError();
+        return Ar;
+    }
+
+    Ar << Header.Flags;
+    Ar << Header.TransformFormat;
+
+    if (Header.Version >= ENumbskullFileVersion::AddedCompressionFormat)
+    {
+        // Stored as a string, plain memory archives don't all agree on how to write names
+        FString CompressionFormat = Header.CompressionFormat.ToString();
+        Ar << CompressionFormat;
+        Ar << Header.CompressionFlags;
+
+        if (Ar.IsLoading())
+        {
+            Header.CompressionFormat = FName(*CompressionFormat);
+        }
+    }
+
+    if (Header.Version >= ENumbskullFileVersion::AddedCompressionDictionary)
+    {
+        Ar << Header.DictionaryId;
+    }
+
+    if (Header.Version >= ENumbskullFileVersion::AddedBulkData)
+    {
+        Ar << Header.PayloadSize;
+        Ar << Header.BulkDataOffset;
+        Ar << Header.BulkDataSize;
+
+        if (Ar.IsLoading() && (Header.PayloadSize < 0 || Header.BulkDataOffset < 0 || Header.BulkDataSize < 0))
+        {
+            UE_LOG(Serializer, Error, TEXT("File header is corrupt"));
+            Ar.SetError();
+        }
+    }
+
+    // Dictionaries are looked up when the payload is decompressed, they may not be loaded yet
+    if (Ar.IsLoading() && Header.HasFlag(ENumbskullFileFlags::Compressed) && Header.DictionaryId == 0 && !FCompression::IsFormatValid(Header.CompressionFormat))
+    {
+        UE_LOG(Serializer, Error, TEXT("File is compressed with unknown format %s"), *Header.CompressionFormat.ToString());
+        Ar.SetError();
+    }
+
+    return Ar;
+}
@@ -0,0 +1,140 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullLoadCache.h"
+#include "NumbskullSerializationSettings.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+FNumbskullLoadCache& FNumbskullLoadCache::Get()
+{
+    static FNumbskullLoadCache Cache;
+    return Cache;
+}
+
+bool FNumbskullLoadCache::IsEnabled()
+{
+    return GetDefault<UNumbskullSerializationSettings>()->bEnableLoadCache;
+}
+
+bool FNumbskullLoadCache::Find(const FString& InFileName, bool bLegacyCompressed, FNumbskullFileHeader& OutHeader, FNumbskullPayload& OutPayload)
+{
+    const FString Key = MakeKey(InFileName);
+
+    // Checked outside the lock, it's the slow part
+    const FFileStatData StatData = IFileManager::Get().GetStatData(*Key);
+
+    FScopeLock Lock(&CriticalSection);
+
+    FEntry* Entry = Entries.Find(Key);
+
+    if (Entry && StatData.bIsValid
+        && Entry->FileSize == StatData.FileSize
+        && Entry->ModificationTime == StatData.ModificationTime
+        && (!Entry->Header.IsLegacy() || Entry->bLegacyCompressed == bLegacyCompressed))
+    {
+        Recency.RemoveNode(Entry->Node, false);
+        Recency.AddHead(Entry->Node);
+
+        OutHeader = Entry->Header;
+        OutPayload = Entry->Payload;
+
+        ++Stats.Hits;
+        return true;
+    }
+
+    if (Entry)
+    {
+        RemoveEntry(Key);
+    }
+
+    ++Stats.Misses;
+    return false;
+}
+
+void FNumbskullLoadCache::Add(const FString& InFileName, bool bLegacyCompressed, const FNumbskullFileHeader& InHeader, const FNumbskullPayload& InPayload, const FFileStatData& InStatData)
+{
+    const int64 Budget = static_cast<int64>(GetDefault<UNumbskullSerializationSettings>()->LoadCacheBudgetKB) * 1024;
+    const FString Key = MakeKey(InFileName);
+
+    FScopeLock Lock(&CriticalSection);
+
+    RemoveEntry(Key);
+
+    if (!InStatData.bIsValid || InPayload.Num() > Budget)
+    {
+        return;
+    }
+
+    while (Stats.BytesUsed + InPayload.Num() > Budget && Recency.GetTail())
+    {
+        const FString OldestKey = Recency.GetTail()->GetValue();
+        RemoveEntry(OldestKey);
+        ++Stats.Evictions;
+    }
+
+    Recency.AddHead(Key);
+
+    FEntry& Entry = Entries.Add(Key);
+    Entry.Header = InHeader;
+    Entry.Payload = InPayload;
+    Entry.bLegacyCompressed = bLegacyCompressed;
+    Entry.FileSize = InStatData.FileSize;
+    Entry.ModificationTime = InStatData.ModificationTime;
+    Entry.Node = Recency.GetHead();
+
+    Stats.BytesUsed += InPayload.Num();
+    Stats.NumEntries = Entries.Num();
+}
+
+void FNumbskullLoadCache::Invalidate(const FString& InFileName)
+{
+    const FString Key = MakeKey(InFileName);
+
+    FScopeLock Lock(&CriticalSection);
+    RemoveEntry(Key);
+}
+
+void FNumbskullLoadCache::Empty()
+{
+    FScopeLock Lock(&CriticalSection);
+
+    Entries.Empty();
+    Recency.Empty();
+    Stats.BytesUsed = 0;
+    Stats.NumEntries = 0;
+}
+
+FNumbskullLoadCacheStats FNumbskullLoadCache::GetStats() const
+{
+    FScopeLock Lock(&CriticalSection);
+    return Stats;
+}
+
+void FNumbskullLoadCache::ResetStats()
+{
+    FScopeLock Lock(&CriticalSection);
+
+    Stats.Hits = 0;
+    Stats.Misses = 0;
+    Stats.Evictions = 0;
+}
+
+FString FNumbskullLoadCache::MakeKey(const FString& InFileName)
+{
+    FString Key = FPaths::ConvertRelativePathToFull(InFileName);
+    FPaths::NormalizeFilename(Key);
+    return Key;
+}
+
+void FNumbskullLoadCache::RemoveEntry(const FString& InKey)
+{
+    FEntry Entry;
+    if (Entries.RemoveAndCopyValue(InKey, Entry))
+    {
+        Recency.RemoveNode(Entry.Node);
+        Stats.BytesUsed -= Entry.Payload.Num();
+        Stats.NumEntries = Entries.Num();
+    }
+}
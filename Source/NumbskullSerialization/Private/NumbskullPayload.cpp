@@ -0,0 +1,116 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullPayload.h"
+
+#include "UObject/PropertyTag.h"
+
+namespace
+{
+    const TArray<uint8> EmptyBytes;
+}
+
+FNumbskullPayload::FNumbskullPayload(const TArray<uint8>& InBytes)
+: Buffer(MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(InBytes))
+{
+}
+
+FNumbskullPayload::FNumbskullPayload(TArray<uint8>&& InBytes)
+: Buffer(MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(InBytes)))
+{
+}
+
+FNumbskullPayload& FNumbskullPayload::operator=(const TArray<uint8>& InBytes)
+{
+    Buffer = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(InBytes);
+    return *this;
+}
+
+FNumbskullPayload& FNumbskullPayload::operator=(TArray<uint8>&& InBytes)
+{
+    Buffer = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(MoveTemp(InBytes));
+    return *this;
+}
+
+const TArray<uint8>& FNumbskullPayload::Get() const
+{
+    return Buffer.IsValid() ? *Buffer : EmptyBytes;
+}
+
+TArray<uint8>& FNumbskullPayload::GetMutable()
+{
+    if (!Buffer.IsValid())
+    {
+        Buffer = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+    }
+    else if (!Buffer.IsUnique())
+    {
+        Buffer = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(*Buffer);
+    }
+
+    return *Buffer;
+}
+
+TArray<uint8> FNumbskullPayload::MoveToArray()
+{
+    TArray<uint8> Bytes = IsUnique() && Buffer.IsValid() ? MoveTemp(*Buffer) : Get();
+    Buffer.Reset();
+    return Bytes;
+}
+
+bool FNumbskullPayload::Serialize(FArchive& Ar)
+{
+    // Same layout as TArray<uint8>
+    if (Ar.IsLoading())
+    {
+        TArray<uint8> Bytes;
+        Ar << Bytes;
+        *this = MoveTemp(Bytes);
+    }
+    else
+    {
+        int32 NumBytes = Num();
+        Ar << NumBytes;
+
+        if (NumBytes > 0)
+        {
+            Ar.Serialize(const_cast<uint8*>(GetData()), NumBytes);
+        }
+    }
+
+    return true;
+}
+
+void FNumbskullPayload::LoadBytes(FArchive& Ar, int32 InNumBytes)
+{
+    Reset();
+
+    if (InNumBytes < 0 || (Ar.TotalSize() >= 0 && InNumBytes > Ar.TotalSize() - Ar.Tell()))
+    {
+        Ar.SetError();
+        return;
+    }
+
+    TArray<uint8> Bytes;
+    Bytes.SetNumUninitialized(InNumBytes);
+    Ar.Serialize(Bytes.GetData(), InNumBytes);
+    *this = MoveTemp(Bytes);
+}
+
+bool FNumbskullPayload::SerializeFromMismatchedTag(const FPropertyTag& Tag, FStructuredArchive::FSlot Slot)
+{
+    if (Tag.Type != NAME_ArrayProperty || Tag.InnerType != NAME_ByteProperty)
+    {
+        return false;
+    }
+
+    TArray<uint8> Bytes;
+    Slot << Bytes;
+    *this = MoveTemp(Bytes);
+
+    return true;
+}
+
+bool FNumbskullPayload::operator==(const FNumbskullPayload& Other) const
+{
+    return Buffer == Other.Buffer || Get() == Other.Get();
+}
@@ -0,0 +1,532 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullProfileStore.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "Math/RandomStream.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+const TCHAR* FNumbskullProfileStore::Extension = TEXT(".nskp");
+
+namespace
+{
+    /** Longest a writer sleeps, so it notices the queue filling up or a flush without being woken*/
+    const double MaxWriterWaitSeconds = 0.1;
+
+    FString MakeSafeId(const FString& InProfileId)
+    {
+        return FPaths::MakeValidFileName(InProfileId, TEXT('_'));
+    }
+}
+
+FNumbskullProfileStore::FWriter::FWriter(FNumbskullProfileStore& InStore)
+: Store(InStore)
+, WakeEvent(FPlatformProcess::GetSynchEventFromPool(false))
+, bStopping(false)
+{
+}
+
+FNumbskullProfileStore::FWriter::~FWriter()
+{
+    FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+uint32 FNumbskullProfileStore::FWriter::Run()
+{
+    while (true)
+    {
+        double WaitSeconds = 0.0;
+        if (WriteNext(WaitSeconds))
+        {
+            continue;
+        }
+
+        // Everything has been written
+        if (bStopping)
+        {
+            break;
+        }
+
+        WakeEvent->Wait(FTimespan::FromSeconds(FMath::Min(WaitSeconds, MaxWriterWaitSeconds)));
+    }
+
+    return 0;
+}
+
+void FNumbskullProfileStore::FWriter::Stop()
+{
+    bStopping = true;
+    WakeEvent->Trigger();
+}
+
+bool FNumbskullProfileStore::FWriter::Enqueue(const FString& InProfileId, const FObjectData& InObjectData, bool& bOutCoalesced)
+{
+    FScopeLock Lock(&CriticalSection);
+
+    // Last save wins, and keeps the place in the queue of the first
+    if (FQueuedProfile* Existing = Queued.Find(InProfileId))
+    {
+        Existing->ObjectData = InObjectData;
+        bOutCoalesced = true;
+        return true;
+    }
+
+    if (!Store.ReserveSlot())
+    {
+        return false;
+    }
+
+    FQueuedProfile& Profile = Queued.Add(InProfileId);
+    Profile.ObjectData = InObjectData;
+    Profile.DueTime = FPlatformTime::Seconds() + Store.Config.CoalesceSeconds;
+    Order.Add(InProfileId);
+
+    bOutCoalesced = false;
+    return true;
+}
+
+bool FNumbskullProfileStore::FWriter::Find(const FString& InProfileId, FObjectData& OutObjectData) const
+{
+    FScopeLock Lock(&CriticalSection);
+
+    if (const FQueuedProfile* Profile = Queued.Find(InProfileId))
+    {
+        OutObjectData = Profile->ObjectData;
+        return true;
+    }
+
+    if (WritingId == InProfileId)
+    {
+        OutObjectData = WritingData;
+        return true;
+    }
+
+    return false;
+}
+
+void FNumbskullProfileStore::FWriter::GetQueued(TMap<FString, FObjectData>& OutProfiles) const
+{
+    FScopeLock Lock(&CriticalSection);
+
+    if (!WritingId.IsEmpty())
+    {
+        OutProfiles.Add(WritingId, WritingData);
+    }
+
+    // Queued saves are newer than the one being written
+    for (const TPair<FString, FQueuedProfile>& Pair : Queued)
+    {
+        OutProfiles.Add(Pair.Key, Pair.Value.ObjectData);
+    }
+}
+
+bool FNumbskullProfileStore::FWriter::WriteNext(double& OutWaitSeconds)
+{
+    FString ProfileId;
+    FObjectData ObjectData;
+
+    {
+        FScopeLock Lock(&CriticalSection);
+
+        if (OrderStart == Order.Num())
+        {
+            Order.Reset();
+            OrderStart = 0;
+            OutWaitSeconds = MaxWriterWaitSeconds;
+            return false;
+        }
+
+        FQueuedProfile& Profile = Queued.FindChecked(Order[OrderStart]);
+
+        const double Now = FPlatformTime::Seconds();
+        if (Profile.DueTime > Now && !bStopping && !Store.ShouldWriteEarly())
+        {
+            OutWaitSeconds = Profile.DueTime - Now;
+            return false;
+        }
+
+        ProfileId = MoveTemp(Order[OrderStart]);
+        ObjectData = Profile.ObjectData;
+        Queued.Remove(ProfileId);
+
+        // Drops the written IDs from the front now and then rather than shifting the array every write
+        if (++OrderStart > 1024 && OrderStart * 2 > Order.Num())
+        {
+            Order.RemoveAt(0, OrderStart, false);
+            OrderStart = 0;
+        }
+
+        WritingId = ProfileId;
+        WritingData = ObjectData;
+    }
+
+    const bool bWritten = Store.WriteProfile(ProfileId, ObjectData);
+
+    bool bRetry = false;
+
+    {
+        FScopeLock Lock(&CriticalSection);
+
+        WritingId.Reset();
+        WritingData = FObjectData();
+
+        // Tried again later unless there's a newer save or the store is shutting down, keeping the slot it had
+        if (!bWritten && !Queued.Contains(ProfileId) && !bStopping && Store.FlushRequests == 0)
+        {
+            FQueuedProfile& Profile = Queued.Add(ProfileId);
+            Profile.ObjectData = ObjectData;
+            Profile.DueTime = FPlatformTime::Seconds() + Store.Config.CoalesceSeconds;
+            Order.Add(ProfileId);
+            bRetry = true;
+        }
+    }
+
+    {
+        FScopeLock Lock(&Store.StatsCriticalSection);
+        ++(bWritten ? Store.Stats.Written : Store.Stats.Failed);
+    }
+
+    if (!bRetry)
+    {
+        Store.ReleaseSlot();
+    }
+
+    Store.WrittenEvent->Trigger();
+
+    return true;
+}
+
+FNumbskullProfileStore::FNumbskullProfileStore(const FNumbskullProfileStoreConfig& InConfig)
+: Config(InConfig)
+, NumQueued(0)
+, FlushRequests(0)
+, WrittenEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+    Config.NumShards = FMath::Clamp(Config.NumShards, 1, 4096);
+    Config.NumWriters = FMath::Clamp(Config.NumWriters, 1, Config.NumShards);
+    Config.MaxQueuedProfiles = FMath::Max(Config.MaxQueuedProfiles, 1);
+    Config.CoalesceSeconds = FMath::Max(Config.CoalesceSeconds, 0.0f);
+
+    for (int32 Index = 0; Index < Config.NumWriters; ++Index)
+    {
+        FWriter* Writer = Writers.Add_GetRef(MakeUnique<FWriter>(*this)).Get();
+        Writer->Thread = FRunnableThread::Create(Writer, *FString::Printf(TEXT("NumbskullProfileWriter%d"), Index), 0, TPri_BelowNormal);
+    }
+}
+
+FNumbskullProfileStore::~FNumbskullProfileStore()
+{
+    Flush();
+
+    for (const TUniquePtr<FWriter>& Writer : Writers)
+    {
+        Writer->Stop();
+    }
+
+    for (const TUniquePtr<FWriter>& Writer : Writers)
+    {
+        Writer->Thread->WaitForCompletion();
+        delete Writer->Thread;
+    }
+
+    Writers.Empty();
+
+    FPlatformProcess::ReturnSynchEventToPool(WrittenEvent);
+}
+
+bool FNumbskullProfileStore::Save(const FString& InProfileId, const FObjectData& InObjectData)
+{
+    return SaveInternal(InProfileId, InObjectData, true);
+}
+
+bool FNumbskullProfileStore::TrySave(const FString& InProfileId, const FObjectData& InObjectData)
+{
+    return SaveInternal(InProfileId, InObjectData, false);
+}
+
+bool FNumbskullProfileStore::SaveInternal(const FString& InProfileId, const FObjectData& InObjectData, bool bWait)
+{
+    if (InProfileId.IsEmpty() || InObjectData.Data.Num() == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Couldn't save profile. It needs an ID and data"));
+        return false;
+    }
+
+    const FString SafeId = MakeSafeId(InProfileId);
+    FWriter& Writer = GetWriter(SafeId);
+
+    bool bCoalesced = false;
+    bool bBlocked = false;
+
+    while (!Writer.Enqueue(SafeId, InObjectData, bCoalesced))
+    {
+        if (!bBlocked)
+        {
+            bBlocked = true;
+
+            FScopeLock Lock(&StatsCriticalSection);
+            ++Stats.Blocked;
+        }
+
+        if (!bWait)
+        {
+            return false;
+        }
+
+        // The queue is full, so writers are already writing early
+        WrittenEvent->Wait(FTimespan::FromMilliseconds(10.0));
+    }
+
+    FScopeLock Lock(&StatsCriticalSection);
+    ++Stats.Saves;
+    Stats.Coalesced += bCoalesced ? 1 : 0;
+
+    return true;
+}
+
+bool FNumbskullProfileStore::Load(const FString& InProfileId, FObjectData& OutObjectData) const
+{
+    const FString SafeId = MakeSafeId(InProfileId);
+
+    if (GetWriter(SafeId).Find(SafeId, OutObjectData))
+    {
+        return true;
+    }
+
+    const FString FileName = GetProfileFileName(SafeId);
+
+    if (!IFileManager::Get().FileExists(*FileName))
+    {
+        return false;
+    }
+
+    return Config.bCompress
+        ? UNumbskullSerializationBPLibrary::LoadObjectDataFromDiskCompressed(FileName, OutObjectData)
+        : UNumbskullSerializationBPLibrary::LoadObjectDataFromDisk(FileName, OutObjectData);
+}
+
+int32 FNumbskullProfileStore::LoadAll(TMap<FString, FObjectData>& OutProfiles) const
+{
+    TArray<FString> Files;
+    IFileManager::Get().FindFilesRecursive(Files, *Config.RootDirectory, *(FString(TEXT("*")) + Extension), true, false);
+
+    TArray<FObjectData> Profiles;
+    TArray<bool> Loaded;
+    UNumbskullSerializationBPLibrary::LoadObjectDataBatchFromDisk(Files, Profiles, Loaded, Config.bCompress);
+
+    int32 NumFailed = 0;
+    OutProfiles.Reserve(OutProfiles.Num() + Files.Num());
+
+    for (int32 Index = 0; Index < Files.Num(); ++Index)
+    {
+        if (Loaded[Index])
+        {
+            OutProfiles.Add(FPaths::GetBaseFilename(Files[Index]), MoveTemp(Profiles[Index]));
+        }
+        else
+        {
+            UE_LOG(Serializer, Error, TEXT("Couldn't load profile {%s}"), *Files[Index]);
+            ++NumFailed;
+        }
+    }
+
+    for (const TUniquePtr<FWriter>& Writer : Writers)
+    {
+        Writer->GetQueued(OutProfiles);
+    }
+
+    return NumFailed;
+}
+
+void FNumbskullProfileStore::Flush()
+{
+    ++FlushRequests;
+
+    while (NumQueued > 0)
+    {
+        for (const TUniquePtr<FWriter>& Writer : Writers)
+        {
+            Writer->Wake();
+        }
+
+        WrittenEvent->Wait(FTimespan::FromMilliseconds(10.0));
+    }
+
+    --FlushRequests;
+}
+
+FString FNumbskullProfileStore::GetProfileFileName(const FString& InProfileId) const
+{
+    const FString SafeId = MakeSafeId(InProfileId);
+    return Config.RootDirectory / FString::Printf(TEXT("%03X"), GetShard(SafeId)) / SafeId + Extension;
+}
+
+FNumbskullProfileStoreStats FNumbskullProfileStore::GetStats() const
+{
+    FScopeLock Lock(&StatsCriticalSection);
+
+    FNumbskullProfileStoreStats Result = Stats;
+    Result.Queued = NumQueued;
+    return Result;
+}
+
+FNumbskullProfileStore::FWriter& FNumbskullProfileStore::GetWriter(const FString& InProfileId) const
+{
+    // Each shard belongs to one writer, so saves of a profile are written in order
+    return *Writers[GetShard(InProfileId) % Writers.Num()];
+}
+
+int32 FNumbskullProfileStore::GetShard(const FString& InProfileId) const
+{
+    // Has to be stable between runs, unlike GetTypeHash
+    return static_cast<int32>(FCrc::StrCrc32(*InProfileId) % static_cast<uint32>(Config.NumShards));
+}
+
+bool FNumbskullProfileStore::ReserveSlot()
+{
+    int32 Current = NumQueued;
+
+    while (Current < Config.MaxQueuedProfiles)
+    {
+        if (NumQueued.CompareExchange(Current, Current + 1))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void FNumbskullProfileStore::ReleaseSlot()
+{
+    --NumQueued;
+}
+
+bool FNumbskullProfileStore::WriteProfile(const FString& InProfileId, const FObjectData& InObjectData)
+{
+    const FString FileName = GetProfileFileName(InProfileId);
+
+    // Both write a temporary file, flush it and rename it over the profile
+    const bool bWritten = Config.bCompress
+        ? UNumbskullSerializationBPLibrary::SaveObjectDataToDiskCompressed(FileName, InObjectData)
+        : UNumbskullSerializationBPLibrary::SaveObjectDataToDisk(FileName, InObjectData);
+
+    if (!bWritten)
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't write profile {%s}"), *FileName);
+    }
+
+    return bWritten;
+}
+
+namespace
+{
+    /**
+     * Numbskull.ProfileStoreBenchmark [NumProfiles] [PayloadBytes]
+     *
+     * Saves every profile twice, as two checkpoints close together would, first synchronously with SaveObjectDataToDisk
+     * and then through a profile store, then loads them all back with LoadAll. Works in a temporary directory under Saved.
+     */
+    void RunProfileStoreBenchmark(const TArray<FString>& Args)
+    {
+        const int32 NumProfiles = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10000;
+        const int32 PayloadBytes = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 2048;
+
+        const FString Directory = FPaths::ProjectSavedDir() / TEXT("NumbskullProfileBenchmark");
+        IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+        // Mostly repetitive with some noise, roughly how serialized profiles compress
+        FRandomStream Random(NumProfiles);
+        TArray<FString> Ids;
+        TArray<FObjectData> Profiles;
+
+        for (int32 Index = 0; Index < NumProfiles; ++Index)
+        {
+            Ids.Add(FString::Printf(TEXT("Player%08d"), Index));
+
+            TArray<uint8>& Bytes = Profiles.AddDefaulted_GetRef().Data.GetMutable();
+            Bytes.SetNumUninitialized(PayloadBytes);
+
+            for (int32 Byte = 0; Byte < PayloadBytes; ++Byte)
+            {
+                Bytes[Byte] = Random.RandRange(0, 7) == 0 ? static_cast<uint8>(Random.RandRange(0, 255)) : static_cast<uint8>(Byte % 32);
+            }
+        }
+
+        // Every read and write is logged otherwise
+        const ELogVerbosity::Type PreviousVerbosity = Serializer.GetVerbosity();
+        Serializer.SetVerbosity(ELogVerbosity::Warning);
+
+        double StartTime = FPlatformTime::Seconds();
+        for (int32 Checkpoint = 0; Checkpoint < 2; ++Checkpoint)
+        {
+            for (int32 Index = 0; Index < NumProfiles; ++Index)
+            {
+                UNumbskullSerializationBPLibrary::SaveObjectDataToDiskCompressed(Directory / TEXT("Sync") / Ids[Index] + FNumbskullProfileStore::Extension, Profiles[Index]);
+            }
+        }
+        const double SyncSeconds = FPlatformTime::Seconds() - StartTime;
+
+        FNumbskullProfileStoreConfig Config;
+        Config.RootDirectory = Directory / TEXT("Store");
+        Config.CoalesceSeconds = 1.0f;
+
+        FNumbskullProfileStoreStats Stats;
+        double SaveSeconds = 0.0;
+        double FlushSeconds = 0.0;
+
+        {
+            FNumbskullProfileStore Store(Config);
+
+            StartTime = FPlatformTime::Seconds();
+            for (int32 Checkpoint = 0; Checkpoint < 2; ++Checkpoint)
+            {
+                for (int32 Index = 0; Index < NumProfiles; ++Index)
+                {
+                    Store.Save(Ids[Index], Profiles[Index]);
+                }
+            }
+            SaveSeconds = FPlatformTime::Seconds() - StartTime;
+
+            StartTime = FPlatformTime::Seconds();
+            Store.Flush();
+            FlushSeconds = FPlatformTime::Seconds() - StartTime;
+
+            Stats = Store.GetStats();
+        }
+
+        TMap<FString, FObjectData> Loaded;
+        int32 NumFailed = 0;
+        double LoadSeconds = 0.0;
+
+        {
+            FNumbskullProfileStore Store(Config);
+
+            StartTime = FPlatformTime::Seconds();
+            NumFailed = Store.LoadAll(Loaded);
+            LoadSeconds = FPlatformTime::Seconds() - StartTime;
+        }
+
+        Serializer.SetVerbosity(PreviousVerbosity);
+
+        IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+        const int32 NumSaves = NumProfiles * 2;
+
+        UE_LOG(Serializer, Display, TEXT("Profile store benchmark: %d profiles of %d bytes, saved twice each"), NumProfiles, PayloadBytes);
+        UE_LOG(Serializer, Display, TEXT("Synchronous: %.2fms total, %.3fms per save on the calling thread"), SyncSeconds * 1000.0, SyncSeconds * 1000.0 / NumSaves);
+        UE_LOG(Serializer, Display, TEXT("Store: %.2fms total, %.3fms per save on the calling thread, %.2fms to flush"), SaveSeconds * 1000.0, SaveSeconds * 1000.0 / NumSaves, FlushSeconds * 1000.0);
+        UE_LOG(Serializer, Display, TEXT("Store: %lld saves, %lld coalesced, %lld blocked, %lld written, %lld failed"), Stats.Saves, Stats.Coalesced, Stats.Blocked, Stats.Written, Stats.Failed);
+        UE_LOG(Serializer, Display, TEXT("Bulk load: %d profiles (%d failed) in %.2fms, %.1f profiles/s"), Loaded.Num(), NumFailed, LoadSeconds * 1000.0, Loaded.Num() / FMath::Max(LoadSeconds, SMALL_NUMBER));
+    }
+
+    FAutoConsoleCommand ProfileStoreBenchmarkCommand(
+        TEXT("Numbskull.ProfileStoreBenchmark"),
+        TEXT("Compares saving profiles synchronously with a profile store. Arguments: [NumProfiles=10000] [PayloadBytes=2048]"),
+        FConsoleCommandWithArgsDelegate::CreateStatic(&RunProfileStoreBenchmark));
+}
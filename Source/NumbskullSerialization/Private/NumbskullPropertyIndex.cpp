@@ -0,0 +1,243 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullPropertyIndex.h"
+#include "NumbskullArchive.h"
+#include "NumbskullReferenceTable.h"
+#include "NumbskullSerializationBPLibrary.h"
+#include "NumbskullVarInt.h"
+
+#include "Serialization/MemoryReader.h"
+#include "Serialization/StructuredArchive.h"
+#include "UObject/PropertyTag.h"
+#include "UObject/UnrealType.h"
+
+namespace
+{
+    /** Data to read from, decoding it into OutDecoded first if it's compact. Offsets are always into the decoded data*/
+    const TArray<uint8>* GetRawData(const TArray<uint8>& InData, TArray<uint8>& OutDecoded)
+    {
+        if (!FNumbskullVarInt::IsEncoded(InData))
+        {
+            return &InData;
+        }
+
+        if (!FNumbskullVarInt::Decode(InData.GetData(), InData.Num(), OutDecoded))
+        {
+            UE_LOG(Serializer, Warning, TEXT("Couldn't decode compact serialized data"));
+            return nullptr;
+        }
+
+        return &OutDecoded;
+    }
+}
+
+void FNumbskullPropertyIndex::Reset()
+{
+    ObjectStarts.Reset();
+    Properties.Reset();
+}
+
+bool FNumbskullPropertyIndex::Build(const TArray<uint8>& InData, const TArray<int32>& InObjectOffsets)
+{
+    Reset();
+
+    TArray<uint8> DecodedData;
+    const TArray<uint8>* Data = GetRawData(InData, DecodedData);
+    if (!Data)
+    {
+        return false;
+    }
+
+    // Tags are read through the library's archive so names are read the same way they were written
+    FMemoryReader Reader(*Data, true);
+    FNumbskullArchive Archive(Reader, false);
+
+    for (const int32 Offset : InObjectOffsets)
+    {
+        ObjectStarts.Add(Properties.Num());
+
+        // Objects that weren't serialized have no properties
+        if (Offset == INDEX_NONE)
+        {
+            continue;
+        }
+
+        Reader.Seek(Offset);
+
+        while (true)
+        {
+            const int64 TagOffset = Reader.Tell();
+
+            FPropertyTag Tag;
+            Archive << Tag;
+
+            if (Archive.IsError())
+            {
+                Reset();
+                return false;
+            }
+
+            if (Tag.Name.IsNone())
+            {
+                break;
+            }
+
+            const int64 ValueEnd = Reader.Tell() + Tag.Size;
+            if (Tag.Size < 0 || ValueEnd > Data->Num())
+            {
+                Reset();
+                return false;
+            }
+
+            FNumbskullIndexedProperty& Property = Properties.AddDefaulted_GetRef();
+            Property.Name = Tag.Name;
+            Property.ArrayIndex = Tag.ArrayIndex;
+            Property.TagOffset = static_cast<int32>(TagOffset);
+
+            Reader.Seek(ValueEnd);
+        }
+    }
+
+    return true;
+}
+
+const FNumbskullIndexedProperty* FNumbskullPropertyIndex::Find(int32 InObjectIndex, FName InName, int32 InArrayIndex) const
+{
+    if (!ObjectStarts.IsValidIndex(InObjectIndex))
+    {
+        return nullptr;
+    }
+
+    const int32 Start = ObjectStarts[InObjectIndex];
+    const int32 End = ObjectStarts.IsValidIndex(InObjectIndex + 1) ? ObjectStarts[InObjectIndex + 1] : Properties.Num();
+
+    for (int32 Index = Start; Index < End; ++Index)
+    {
+        if (Properties[Index].Name == InName && Properties[Index].ArrayIndex == InArrayIndex)
+        {
+            return &Properties[Index];
+        }
+    }
+
+    return nullptr;
+}
+
+bool FNumbskullPropertyIndex::ReadProperty(const TArray<uint8>& InData, const FNumbskullReferenceTable& InReferences, int32 InObjectIndex, UClass* InClass, const FProperty* InProperty, void* OutValue, int32 InArrayIndex) const
+{
+    if (!IsValid() || !ObjectStarts.IsValidIndex(InObjectIndex))
+    {
+        UE_LOG(Serializer, Warning, TEXT("Data has no property index for object %d. It has to be saved again to read properties from it"), InObjectIndex);
+        return false;
+    }
+
+    if (!InClass || !InProperty || !InClass->IsChildOf(InProperty->GetOwnerClass()) || InArrayIndex < 0 || InArrayIndex >= InProperty->ArrayDim)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Can't read property. It doesn't belong to the class"));
+        return false;
+    }
+
+    const FNumbskullIndexedProperty* Indexed = Find(InObjectIndex, InProperty->GetFName(), InArrayIndex);
+
+    if (!Indexed)
+    {
+        // Only properties that differ from the defaults are serialized
+        InProperty->CopySingleValue(OutValue, InProperty->ContainerPtrToValuePtr<void>(InClass->GetDefaultObject(), InArrayIndex));
+        return true;
+    }
+
+    TArray<uint8> DecodedData;
+    const TArray<uint8>* Data = GetRawData(InData, DecodedData);
+    if (!Data)
+    {
+        return false;
+    }
+
+    FMemoryReader Reader(*Data, true);
+    Reader.Seek(Indexed->TagOffset);
+
+    // Objects saved alongside this one don't exist, so only references to outside objects resolve
+    FNumbskullReferenceReader ReferenceReader(InReferences, TArray<UObject*>(), false);
+    FNumbskullArchive Archive(Reader, false);
+    Archive.SetReferenceReader(InReferences.bEnabled ? &ReferenceReader : nullptr);
+
+    FPropertyTag Tag;
+    Archive << Tag;
+
+    if (Archive.IsError() || Tag.Name != InProperty->GetFName())
+    {
+        UE_LOG(Serializer, Warning, TEXT("Property index doesn't match the data"));
+        return false;
+    }
+
+    // Bools are stored in the tag itself
+    const FBoolProperty* BoolProperty = CastField<FBoolProperty>(InProperty);
+    if (BoolProperty && Tag.Type == NAME_BoolProperty)
+    {
+        BoolProperty->SetPropertyValue(OutValue, Tag.BoolVal != 0);
+        return true;
+    }
+
+    const FStructProperty* StructProperty = CastField<FStructProperty>(InProperty);
+    if (Tag.Type != InProperty->GetID() || (StructProperty && Tag.StructName != StructProperty->Struct->GetFName()))
+    {
+        UE_LOG(Serializer, Warning, TEXT("Property %s was saved as %s, which doesn't match its current type"), *InProperty->GetName(), *Tag.Type.ToString());
+        return false;
+    }
+
+    const int64 ValueEnd = Reader.Tell() + Tag.Size;
+
+    FStructuredArchiveFromArchive Adapter(Archive);
+    InProperty->SerializeItem(Adapter.GetSlot(), OutValue, nullptr);
+
+    return !Archive.IsError() && Reader.Tell() == ValueEnd;
+}
+
+bool FNumbskullPropertyIndex::ReadPropertiesAsText(const TArray<uint8>& InData, const FNumbskullReferenceTable& InReferences, int32 InObjectIndex, UClass* InClass, const TArray<FName>& InPropertyNames, TMap<FName, FString>& OutValues) const
+{
+    if (!InClass)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Can't read properties without a class"));
+        return false;
+    }
+
+    // Decoded once here rather than for every property
+    TArray<uint8> DecodedData;
+    const TArray<uint8>* Data = GetRawData(InData, DecodedData);
+    if (!Data)
+    {
+        return false;
+    }
+
+    bool bReadAll = true;
+
+    for (const FName& PropertyName : InPropertyNames)
+    {
+        const FProperty* Property = FindFProperty<FProperty>(InClass, PropertyName);
+
+        if (!Property)
+        {
+            UE_LOG(Serializer, Warning, TEXT("Class %s has no property %s"), *InClass->GetName(), *PropertyName.ToString());
+            bReadAll = false;
+            continue;
+        }
+
+        void* Value = FMemory::Malloc(Property->GetSize(), Property->GetMinAlignment());
+        Property->InitializeValue(Value);
+
+        if (ReadProperty(*Data, InReferences, InObjectIndex, InClass, Property, Value))
+        {
+            FString Text;
+            Property->ExportTextItem(Text, Value, nullptr, nullptr, PPF_None);
+            OutValues.Add(PropertyName, Text);
+        }
+        else
+        {
+            bReadAll = false;
+        }
+
+        Property->DestroyValue(Value);
+        FMemory::Free(Value);
+    }
+
+    return bReadAll;
+}
@@ -0,0 +1,361 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullProxyManager.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+UNumbskullProxyManager* UNumbskullProxyManager::CreateProxyManager(UObject* WorldContextObject, float InRelevanceRadius, float InCellSize)
+{
+    UWorld* const ContextWorld = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+
+    if (!ContextWorld)
+    {
+        return nullptr;
+    }
+
+    // An outer doesn't keep the manager alive, the world's extra references do
+    UNumbskullProxyManager* Manager = NewObject<UNumbskullProxyManager>(ContextWorld);
+    ContextWorld->ExtraReferencedObjects.Add(Manager);
+    Manager->World = ContextWorld;
+    Manager->RelevanceRadius = FMath::Max(InRelevanceRadius, 0.0f);
+    Manager->ReleaseRadius = Manager->RelevanceRadius * 1.2f;
+    Manager->CellSize = FMath::Max(InCellSize, 100.0f);
+
+    return Manager;
+}
+
+void UNumbskullProxyManager::AddProxies(const TArray<FActorProxy>& InActorProxies)
+{
+    Entries.Reserve(Entries.Num() + InActorProxies.Num());
+
+    for (const FActorProxy& ActorProxy : InActorProxies)
+    {
+        AddEntry(ActorProxy);
+    }
+}
+
+bool UNumbskullProxyManager::AddProxyBatch(const FActorProxyBatch& InActorProxyBatch)
+{
+    TArray<FActorProxy> ActorProxies;
+
+    if (!UNumbskullSerializationBPLibrary::BreakActorProxyBatch(InActorProxyBatch, ActorProxies))
+    {
+        return false;
+    }
+
+    AddProxies(ActorProxies);
+    return true;
+}
+
+void UNumbskullProxyManager::GetProxies(TArray<FActorProxy>& OutActorProxies) const
+{
+    OutActorProxies.Reset(Entries.Num());
+
+    for (const FEntry& Entry : Entries)
+    {
+        AActor* Actor = Entry.Actor.Get();
+
+        if (!Actor)
+        {
+            OutActorProxies.Add(Entry.ActorProxy);
+            continue;
+        }
+
+        FActorProxy& ActorProxy = OutActorProxies.AddDefaulted_GetRef();
+
+        if (!UNumbskullSerializationBPLibrary::SaveActor(Actor, ActorProxy))
+        {
+            ActorProxy = Entry.ActorProxy;
+        }
+    }
+}
+
+void UNumbskullProxyManager::Reset()
+{
+    for (const int32 Index : SpawnedEntries)
+    {
+        if (AActor* Actor = Entries[Index].Actor.Get())
+        {
+            Actor->Destroy();
+        }
+    }
+
+    Entries.Empty();
+    Grid.Empty();
+    SpawnedEntries.Empty();
+}
+
+void UNumbskullProxyManager::DestroyManager()
+{
+    Reset();
+    Viewers.Empty();
+
+    if (UWorld* const ManagerWorld = GetWorld())
+    {
+        ManagerWorld->ExtraReferencedObjects.Remove(this);
+    }
+
+    World.Reset();
+    MarkPendingKill();
+}
+
+void UNumbskullProxyManager::AddViewer(AActor* InViewer)
+{
+    if (InViewer)
+    {
+        Viewers.AddUnique(InViewer);
+    }
+}
+
+void UNumbskullProxyManager::RemoveViewer(AActor* InViewer)
+{
+    Viewers.Remove(InViewer);
+}
+
+void UNumbskullProxyManager::Update()
+{
+    if (!GetWorld())
+    {
+        return;
+    }
+
+    TArray<FVector> ViewerLocations;
+    GetViewerLocations(ViewerLocations);
+
+    // Release actors no viewer is near anymore, and forget the ones the game destroyed
+    const float ReleaseRadiusSquared = FMath::Square(FMath::Max(ReleaseRadius, RelevanceRadius));
+
+    TArray<int32> ToRelease;
+    TArray<int32> ToForget;
+
+    for (const int32 Index : SpawnedEntries)
+    {
+        const AActor* Actor = Entries[Index].Actor.Get();
+
+        if (!Actor || Actor->IsPendingKillPending())
+        {
+            ToForget.Add(Index);
+            continue;
+        }
+
+        const FVector Location = Actor->GetActorLocation();
+        const bool bNearViewer = ViewerLocations.ContainsByPredicate([&](const FVector& Viewer) { return FVector::DistSquared(Viewer, Location) <= ReleaseRadiusSquared; });
+
+        if (!bNearViewer)
+        {
+            ToRelease.Add(Index);
+        }
+    }
+
+    for (const int32 Index : ToForget)
+    {
+        SpawnedEntries.Remove(Index);
+        Entries.RemoveAt(Index);
+    }
+
+    for (const int32 Index : ToRelease)
+    {
+        ReleaseEntry(Index);
+    }
+
+    // Gather dormant proxies near any viewer, only looking in the cells the radius overlaps
+    const float RelevanceRadiusSquared = FMath::Square(RelevanceRadius);
+    const float Now = GetWorld()->GetTimeSeconds();
+    const int32 CellRadius = FMath::CeilToInt(RelevanceRadius / CellSize);
+
+    TMap<int32, float> Candidates;
+
+    for (const FVector& Viewer : ViewerLocations)
+    {
+        const FIntPoint Center = GetCell(Viewer);
+
+        for (int32 Y = -CellRadius; Y <= CellRadius; ++Y)
+        {
+            for (int32 X = -CellRadius; X <= CellRadius; ++X)
+            {
+                const TArray<int32>* Cell = Grid.Find(Center + FIntPoint(X, Y));
+
+                if (!Cell)
+                {
+                    continue;
+                }
+
+                for (const int32 Index : *Cell)
+                {
+                    const float DistanceSquared = FVector::DistSquared(Viewer, Entries[Index].ActorProxy.ActorTransform.GetLocation());
+
+                    if (DistanceSquared > RelevanceRadiusSquared || Entries[Index].RetryTime > Now)
+                    {
+                        continue;
+                    }
+
+                    if (float* Closest = Candidates.Find(Index))
+                    {
+                        *Closest = FMath::Min(*Closest, DistanceSquared);
+                    }
+                    else
+                    {
+                        Candidates.Add(Index, DistanceSquared);
+                    }
+                }
+            }
+        }
+    }
+
+    // Closest first, so a budget spawns what the player sees soonest
+    Candidates.ValueSort(TLess<float>());
+
+    int32 NumSpawned = 0;
+
+    for (const TPair<int32, float>& Candidate : Candidates)
+    {
+        if (MaxSpawnsPerTick > 0 && NumSpawned >= MaxSpawnsPerTick)
+        {
+            break;
+        }
+
+        NumSpawned += SpawnEntry(Candidate.Key) ? 1 : 0;
+    }
+}
+
+void UNumbskullProxyManager::Tick(float DeltaTime)
+{
+    Update();
+}
+
+bool UNumbskullProxyManager::IsTickable() const
+{
+    return !HasAnyFlags(RF_ClassDefaultObject) && !IsPendingKill() && World.IsValid();
+}
+
+TStatId UNumbskullProxyManager::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UNumbskullProxyManager, STATGROUP_Tickables);
+}
+
+UWorld* UNumbskullProxyManager::GetWorld() const
+{
+    return World.Get();
+}
+
+FIntPoint UNumbskullProxyManager::GetCell(const FVector& InLocation) const
+{
+    return FIntPoint(FMath::FloorToInt(InLocation.X / CellSize), FMath::FloorToInt(InLocation.Y / CellSize));
+}
+
+void UNumbskullProxyManager::AddEntry(const FActorProxy& InActorProxy)
+{
+    FEntry Entry;
+    Entry.ActorProxy = InActorProxy;
+
+    IndexEntry(Entries.Add(MoveTemp(Entry)));
+}
+
+void UNumbskullProxyManager::IndexEntry(int32 InEntry)
+{
+    FEntry& Entry = Entries[InEntry];
+    Entry.Cell = GetCell(Entry.ActorProxy.ActorTransform.GetLocation());
+
+    Grid.FindOrAdd(Entry.Cell).Add(InEntry);
+}
+
+void UNumbskullProxyManager::UnindexEntry(int32 InEntry)
+{
+    const FIntPoint Cell = Entries[InEntry].Cell;
+
+    if (TArray<int32>* CellEntries = Grid.Find(Cell))
+    {
+        CellEntries->RemoveSingleSwap(InEntry, false);
+
+        if (CellEntries->Num() == 0)
+        {
+            Grid.Remove(Cell);
+        }
+    }
+}
+
+bool UNumbskullProxyManager::SpawnEntry(int32 InEntry)
+{
+    FEntry& Entry = Entries[InEntry];
+
+    // Kept out of the grid for good, but still saved by GetProxies
+    if (Entry.ActorProxy.ActorClass.IsEmpty() || Entry.ActorProxy.ActorData.Num() == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Proxy manager can't spawn {%s} without a class and data"), *Entry.ActorProxy.ActorName.ToString());
+        UnindexEntry(InEntry);
+        return false;
+    }
+
+    AActor* Actor = nullptr;
+
+    // A proxy that failed would be tried again every tick, and may load once whatever it needs is there
+    if (!UNumbskullSerializationBPLibrary::LoadActor(GetWorld(), Entry.ActorProxy, Actor) || !Actor)
+    {
+        const float Delay = FMath::Min(SpawnRetryDelay * FMath::Pow(2.0f, static_cast<float>(FMath::Min(Entry.NumFailedSpawns, 16))), 60.0f);
+
+        ++Entry.NumFailedSpawns;
+        Entry.RetryTime = GetWorld()->GetTimeSeconds() + Delay;
+
+        UE_LOG(Serializer, Warning, TEXT("Proxy manager couldn't spawn {%s}. Trying again in %.1f seconds"), *Entry.ActorProxy.ActorName.ToString(), Delay);
+        return false;
+    }
+
+    UnindexEntry(InEntry);
+
+    Entry.Actor = Actor;
+    Entry.NumFailedSpawns = 0;
+    Entry.RetryTime = 0.0f;
+    SpawnedEntries.Add(InEntry);
+
+    return true;
+}
+
+void UNumbskullProxyManager::ReleaseEntry(int32 InEntry)
+{
+    FEntry& Entry = Entries[InEntry];
+    AActor* Actor = Entry.Actor.Get();
+
+    // The proxy from when it was spawned is kept if the actor can't be captured
+    if (Actor)
+    {
+        UNumbskullSerializationBPLibrary::SaveActor(Actor, Entry.ActorProxy);
+        Actor->Destroy();
+    }
+
+    Entry.Actor.Reset();
+    SpawnedEntries.Remove(InEntry);
+
+    IndexEntry(InEntry);
+}
+
+void UNumbskullProxyManager::GetViewerLocations(TArray<FVector>& OutLocations) const
+{
+    for (const TWeakObjectPtr<AActor>& Viewer : Viewers)
+    {
+        if (const AActor* Actor = Viewer.Get())
+        {
+            OutLocations.Add(Actor->GetActorLocation());
+        }
+    }
+
+    if (!bUsePlayerViewPoints)
+    {
+        return;
+    }
+
+    for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+    {
+        const APlayerController* PlayerController = It->Get();
+
+        if (PlayerController)
+        {
+            FVector Location;
+            FRotator Rotation;
+            PlayerController->GetPlayerViewPoint(Location, Rotation);
+            OutLocations.Add(Location);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullReferenceTable.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "UObject/Package.h"
+
+FNumbskullReferenceWriter::FNumbskullReferenceWriter(FNumbskullReferenceTable& InTable, const TArray<UObject*>& InSnapshotObjects)
+: Table(InTable)
+{
+    Table.bEnabled = true;
+    Table.References.Reset();
+
+    SnapshotIndices.Reserve(InSnapshotObjects.Num());
+    for (int32 Index = 0; Index < InSnapshotObjects.Num(); ++Index)
+    {
+        if (InSnapshotObjects[Index])
+        {
+            SnapshotIndices.Add(InSnapshotObjects[Index], Index);
+        }
+    }
+}
+
+int32 FNumbskullReferenceWriter::GetReferenceId(UObject* InObject)
+{
+    if (!InObject)
+    {
+        return ENumbskullReferenceId::Null;
+    }
+
+    if (const int32* ExistingId = ReferenceIds.Find(InObject))
+    {
+        return *ExistingId;
+    }
+
+    FNumbskullObjectReference Reference;
+
+    // Find the snapshot object this one is or lives inside, so it doesn't depend on the name it's spawned with
+    for (UObject* Outer = InObject; Outer; Outer = Outer->GetOuter())
+    {
+        if (const int32* SnapshotIndex = SnapshotIndices.Find(Outer))
+        {
+            Reference.SnapshotIndex = *SnapshotIndex;
+            Reference.ObjectPath = Outer == InObject ? FString() : InObject->GetPathName(Outer);
+            break;
+        }
+    }
+
+    if (Reference.SnapshotIndex == INDEX_NONE)
+    {
+        Reference.ObjectPath = InObject->GetPathName();
+    }
+
+    const int32 Id = Table.References.Add(Reference);
+    ReferenceIds.Add(InObject, Id);
+    return Id;
+}
+
+FNumbskullReferenceReader::FNumbskullReferenceReader(const FNumbskullReferenceTable& InTable, const TArray<UObject*>& InSnapshotObjects, bool bInLoadIfFindFails)
+: Table(InTable)
+, SnapshotObjects(InSnapshotObjects)
+, bLoadIfFindFails(bInLoadIfFindFails)
+, IsResolved(false, InTable.References.Num())
+{
+    Resolved.SetNumZeroed(Table.References.Num());
+}
+
+UObject* FNumbskullReferenceReader::ResolveId(int32 InReferenceId)
+{
+    if (!Resolved.IsValidIndex(InReferenceId))
+    {
+        return nullptr;
+    }
+
+    // Each entry is resolved once no matter how many times it's referenced, and only if it's referenced at all
+    if (!IsResolved[InReferenceId])
+    {
+        IsResolved[InReferenceId] = true;
+        Resolved[InReferenceId] = ResolveReference(Table.References[InReferenceId]);
+
+        if (!Resolved[InReferenceId])
+        {
+            UE_LOG(Serializer, Warning, TEXT("Couldn't resolve reference to {%s} (snapshot index %d)"), *Table.References[InReferenceId].ObjectPath, Table.References[InReferenceId].SnapshotIndex);
+            ++NumUnresolved;
+        }
+    }
+
+    return Resolved[InReferenceId];
+}
+
+UObject* FNumbskullReferenceReader::ResolveReference(const FNumbskullObjectReference& InReference) const
+{
+    if (InReference.SnapshotIndex != INDEX_NONE)
+    {
+        UObject* SnapshotObject = SnapshotObjects.IsValidIndex(InReference.SnapshotIndex) ? SnapshotObjects[InReference.SnapshotIndex] : nullptr;
+
+        if (!SnapshotObject || InReference.ObjectPath.IsEmpty())
+        {
+            return SnapshotObject;
+        }
+
+        return StaticFindObject(UObject::StaticClass(), SnapshotObject, *InReference.ObjectPath);
+    }
+
+    UObject* Object = StaticFindObject(UObject::StaticClass(), nullptr, *InReference.ObjectPath);
+
+    if (!Object && bLoadIfFindFails)
+    {
+        Object = StaticLoadObject(UObject::StaticClass(), nullptr, *InReference.ObjectPath);
+    }
+
+    return Object;
+}
@@ -0,0 +1,585 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullSaveToolCommandlet.h"
+#include "NumbskullSerializationBPLibrary.h"
+#include "NumbskullSerializationSettings.h"
+#include "NumbskullFileHeader.h"
+#include "NumbskullCompressionDictionary.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeExit.h"
+#include "Serialization/BufferArchive.h"
+#include "Serialization/MemoryReader.h"
+
+namespace
+{
+    enum class ESaveToolMode : uint8
+    {
+        Verify,
+        Recompress,
+        Upgrade,
+        Train,
+    };
+
+    struct FSaveToolOptions
+    {
+        ESaveToolMode Mode = ESaveToolMode::Verify;
+
+        /** Whether Recompress compresses at all*/
+        bool bCompress = true;
+
+        FName CompressionFormat = NAME_Zlib;
+
+        uint32 CompressionFlags = 0;
+
+        /** Dictionary Recompress compresses against, or zero for none*/
+        uint32 DictionaryId = 0;
+
+        /** Name of the dictionary Train saves*/
+        FString DictionaryName;
+
+        /** Most bytes the dictionary Train saves can have*/
+        int32 DictionarySize = FNumbskullCompressionDictionary::MaxSize;
+
+        bool bDryRun = false;
+
+        bool bForce = false;
+    };
+
+    struct FSaveToolResult
+    {
+        bool bSuccess = false;
+
+        bool bRewritten = false;
+
+        uint32 Version = ENumbskullFileVersion::Legacy;
+
+        /** Compression format, or None*/
+        FString Compression;
+
+        int64 SizeBefore = 0;
+
+        int64 SizeAfter = 0;
+
+        int64 PayloadSize = 0;
+
+        double Seconds = 0.0;
+
+        FString Message;
+    };
+
+    /**
+     * Decodes a payload as a storage type and, if a new header is given, encodes it again in that format.
+     * Fails if the payload doesn't decode or has bytes left over, which means the file isn't that storage type.
+     */
+    using FReencodeFunction = bool (*)(const FNumbskullFileHeader&, const TArray<uint8>&, const FNumbskullFileHeader*, TArray<uint8>&);
+
+    template <typename RecordType>
+    bool Reencode(const FNumbskullFileHeader& InHeader, const TArray<uint8>& InPayload, const FNumbskullFileHeader* InNewHeader, TArray<uint8>& OutPayload)
+    {
+        RecordType Record;
+
+        FMemoryReader Reader(InPayload, true);
+        Record.SerializeVersioned(Reader, InHeader);
+
+        if (Reader.IsError() || Reader.Tell() != Reader.TotalSize())
+        {
+            return false;
+        }
+
+        if (InNewHeader)
+        {
+            FBufferArchive Writer;
+            Record.SerializeVersioned(Writer, *InNewHeader);
+            OutPayload = MoveTemp(Writer);
+        }
+
+        return true;
+    }
+
+    FReencodeFunction FindReencodeFunction(const FString& InType)
+    {
+        if (InType == TEXT("ObjectData"))
+        {
+            return &Reencode<FObjectData>;
+        }
+        if (InType == TEXT("ActorData"))
+        {
+            return &Reencode<FActorData>;
+        }
+        if (InType == TEXT("ActorProxy"))
+        {
+            return &Reencode<FActorProxy>;
+        }
+        if (InType == TEXT("ActorProxyBatch"))
+        {
+            return &Reencode<FActorProxyBatch>;
+        }
+        return nullptr;
+    }
+
+    /** Files saved before the header was added don't say whether they're compressed, but compressed streams start with a tag*/
+    bool IsLegacyCompressed(const TArray<uint8>& InFileBytes)
+    {
+        // PACKAGE_FILE_TAG, written at the start of every compressed chunk
+        const uint32 CompressedChunkTag = 0x9E2A83C1;
+
+        uint32 FirstWord = 0;
+        if (InFileBytes.Num() >= static_cast<int32>(sizeof(FirstWord)))
+        {
+            FMemory::Memcpy(&FirstWord, InFileBytes.GetData(), sizeof(FirstWord));
+        }
+        return FirstWord == CompressedChunkTag;
+    }
+
+    FString DescribeCompression(const FNumbskullFileHeader& InHeader, bool bCompressed)
+    {
+        if (!bCompressed)
+        {
+            return TEXT("None");
+        }
+        if (InHeader.DictionaryId != 0)
+        {
+            return FString::Printf(TEXT("%s+%08X"), *InHeader.CompressionFormat.ToString(), InHeader.DictionaryId);
+        }
+        return InHeader.CompressionFormat.ToString();
+    }
+
+    void ProcessFile(const FString& InFileName, const FSaveToolOptions& InOptions, FReencodeFunction InReencode, FSaveToolResult& OutResult)
+    {
+        const double StartTime = FPlatformTime::Seconds();
+        ON_SCOPE_EXIT
+        {
+            OutResult.Seconds = FPlatformTime::Seconds() - StartTime;
+        };
+
+        TArray<uint8> FileBytes;
+        if (!UNumbskullSerializationBPLibrary::LoadBytesFromDisk(InFileName, FileBytes))
+        {
+            OutResult.Message = TEXT("Couldn't read file");
+            return;
+        }
+
+        OutResult.SizeBefore = FileBytes.Num();
+        OutResult.SizeAfter = FileBytes.Num();
+
+        const bool bLegacyCompressed = IsLegacyCompressed(FileBytes);
+
+        FNumbskullFileHeader Header;
+        TArray<uint8> Payload;
+        if (!UNumbskullSerializationBPLibrary::DecodeFile(FileBytes, bLegacyCompressed, Header, Payload))
+        {
+            OutResult.Message = TEXT("Couldn't decode file");
+            return;
+        }
+
+        const bool bCompressed = Header.IsLegacy() ? bLegacyCompressed : Header.HasFlag(ENumbskullFileFlags::Compressed);
+
+        OutResult.Version = Header.Version;
+        OutResult.Compression = DescribeCompression(Header, bCompressed);
+        OutResult.PayloadSize = Payload.Num();
+
+        // Transforms keep their encoding so rewriting never loses precision
+        FNumbskullFileHeader NewHeader = Header;
+        NewHeader.Version = ENumbskullFileVersion::Latest;
+        NewHeader.Flags = (Header.Flags & ~ENumbskullFileFlags::Compressed) | (bCompressed ? ENumbskullFileFlags::Compressed : ENumbskullFileFlags::None);
+
+        bool bUpToDate = Header.Version == ENumbskullFileVersion::Latest;
+
+        if (InOptions.Mode == ESaveToolMode::Recompress)
+        {
+            NewHeader.Flags = (Header.Flags & ~ENumbskullFileFlags::Compressed) | (InOptions.bCompress ? ENumbskullFileFlags::Compressed : ENumbskullFileFlags::None);
+            NewHeader.CompressionFormat = InOptions.CompressionFormat;
+            NewHeader.CompressionFlags = InOptions.CompressionFlags;
+            NewHeader.DictionaryId = InOptions.DictionaryId;
+
+            bUpToDate = bUpToDate
+                && bCompressed == InOptions.bCompress
+                && (!bCompressed || (Header.CompressionFormat == NewHeader.CompressionFormat && Header.CompressionFlags == NewHeader.CompressionFlags
+                    && Header.DictionaryId == NewHeader.DictionaryId));
+        }
+
+        const bool bRewrite = InOptions.Mode != ESaveToolMode::Verify && (InOptions.bForce || !bUpToDate);
+
+        TArray<uint8> NewPayload;
+        if (!InReencode(Header, Payload, bRewrite ? &NewHeader : nullptr, NewPayload))
+        {
+            OutResult.Message = TEXT("Payload is corrupt or not the expected type");
+            return;
+        }
+
+        if (!bRewrite)
+        {
+            OutResult.bSuccess = true;
+            OutResult.Message = InOptions.Mode == ESaveToolMode::Verify ? TEXT("Valid") : TEXT("Up to date");
+            return;
+        }
+
+        // Bulk data is carried over untouched, the payload refers to it by offsets within the section
+        TArray<uint8> BulkSection;
+        if (Header.HasBulkData())
+        {
+            if (Header.BulkDataOffset + Header.BulkDataSize > FileBytes.Num())
+            {
+                OutResult.Message = TEXT("Bulk data section is truncated");
+                return;
+            }
+
+            BulkSection.Append(FileBytes.GetData() + Header.BulkDataOffset, static_cast<int32>(Header.BulkDataSize));
+        }
+
+        TArray<uint8> NewFileBytes;
+        if (!UNumbskullSerializationBPLibrary::EncodeFile(NewHeader, NewPayload, NewFileBytes, &BulkSection))
+        {
+            OutResult.Message = TEXT("Couldn't encode file");
+            return;
+        }
+
+        // Never replace a save with something that doesn't read back
+        FNumbskullFileHeader CheckHeader;
+        TArray<uint8> CheckPayload;
+        if (!UNumbskullSerializationBPLibrary::DecodeFile(NewFileBytes, false, CheckHeader, CheckPayload) || CheckPayload != NewPayload)
+        {
+            OutResult.Message = TEXT("Rewritten file didn't read back");
+            return;
+        }
+
+        OutResult.SizeAfter = NewFileBytes.Num();
+        OutResult.Version = NewHeader.Version;
+        OutResult.Compression = DescribeCompression(NewHeader, NewHeader.HasFlag(ENumbskullFileFlags::Compressed));
+
+        if (!InOptions.bDryRun)
+        {
+            const FString TempFileName = InFileName + TEXT(".tmp");
+
+            if (!UNumbskullSerializationBPLibrary::SaveBytesToDisk(TempFileName, NewFileBytes)
+                || !IFileManager::Get().Move(*InFileName, *TempFileName, true, true))
+            {
+                IFileManager::Get().Delete(*TempFileName, false, false, true);
+                OutResult.Message = TEXT("Couldn't replace file");
+                return;
+            }
+        }
+
+        OutResult.bSuccess = true;
+        OutResult.bRewritten = true;
+        OutResult.Message = InOptions.bDryRun ? TEXT("Would rewrite") : TEXT("Rewritten");
+    }
+
+    bool ParseOptions(const FString& Params, FSaveToolOptions& OutOptions)
+    {
+        const UNumbskullSerializationSettings* Settings = GetDefault<UNumbskullSerializationSettings>();
+
+        FString Mode = TEXT("Verify");
+        FParse::Value(*Params, TEXT("Mode="), Mode);
+
+        if (Mode == TEXT("Verify"))
+        {
+            OutOptions.Mode = ESaveToolMode::Verify;
+        }
+        else if (Mode == TEXT("Recompress"))
+        {
+            OutOptions.Mode = ESaveToolMode::Recompress;
+        }
+        else if (Mode == TEXT("Upgrade"))
+        {
+            OutOptions.Mode = ESaveToolMode::Upgrade;
+        }
+        else if (Mode == TEXT("Train"))
+        {
+            OutOptions.Mode = ESaveToolMode::Train;
+        }
+        else
+        {
+            UE_LOG(Serializer, Error, TEXT("Unknown mode %s. Use Verify, Recompress, Upgrade or Train"), *Mode);
+            return false;
+        }
+
+        FString Dictionary = Settings->CompressionDictionary;
+        FParse::Value(*Params, TEXT("Dictionary="), Dictionary);
+
+        if (OutOptions.Mode == ESaveToolMode::Train)
+        {
+            FParse::Value(*Params, TEXT("DictSize="), OutOptions.DictionarySize);
+            OutOptions.DictionaryName = Dictionary;
+
+            if (Dictionary.IsEmpty() || Dictionary == TEXT("None"))
+            {
+                UE_LOG(Serializer, Error, TEXT("Pass a name for the dictionary with -Dictionary="));
+                return false;
+            }
+            if (OutOptions.DictionarySize <= 0 || OutOptions.DictionarySize > FNumbskullCompressionDictionary::MaxSize)
+            {
+                UE_LOG(Serializer, Error, TEXT("Dictionary size must be between 1 and %d bytes"), FNumbskullCompressionDictionary::MaxSize);
+                return false;
+            }
+        }
+
+        FString Codec = Settings->CompressionFormat.ToString();
+        FParse::Value(*Params, TEXT("Codec="), Codec);
+
+        OutOptions.bCompress = Codec != TEXT("None");
+        OutOptions.CompressionFormat = OutOptions.bCompress ? FName(*Codec) : NAME_Zlib;
+
+        if (OutOptions.bCompress && !FCompression::IsFormatValid(OutOptions.CompressionFormat))
+        {
+            UE_LOG(Serializer, Error, TEXT("Unknown compression format %s"), *Codec);
+            return false;
+        }
+
+        ENumbskullCompressionBias Bias = Settings->CompressionBias;
+
+        FString BiasName;
+        if (FParse::Value(*Params, TEXT("Bias="), BiasName))
+        {
+            const UEnum* BiasEnum = StaticEnum<ENumbskullCompressionBias>();
+            const int64 BiasValue = BiasEnum->GetValueByNameString(BiasName);
+
+            if (BiasValue == INDEX_NONE)
+            {
+                UE_LOG(Serializer, Error, TEXT("Unknown compression bias %s. Use Default, Speed or Size"), *BiasName);
+                return false;
+            }
+
+            Bias = static_cast<ENumbskullCompressionBias>(BiasValue);
+        }
+
+        OutOptions.CompressionFlags = UNumbskullSerializationSettings::GetCompressionFlags(Bias);
+
+        if (OutOptions.Mode == ESaveToolMode::Recompress && OutOptions.bCompress && !Dictionary.IsEmpty() && Dictionary != TEXT("None"))
+        {
+            const TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> Found = FNumbskullCompressionDictionary::FindByName(Dictionary);
+
+            if (!Found.IsValid())
+            {
+                UE_LOG(Serializer, Error, TEXT("Unknown compression dictionary %s. Dictionaries are in {%s}"), *Dictionary, *FNumbskullCompressionDictionary::GetDirectory());
+                return false;
+            }
+
+            // Dictionaries are only supported by Zlib
+            OutOptions.CompressionFormat = NAME_Zlib;
+            OutOptions.DictionaryId = Found->Id;
+        }
+        OutOptions.bDryRun = FParse::Param(*Params, TEXT("DryRun"));
+        OutOptions.bForce = FParse::Param(*Params, TEXT("Force"));
+
+        return true;
+    }
+
+    /**
+     * Trains a compression dictionary on the payloads of the files, as they'd be written now, then saves it and reports
+     * how much better than plain Zlib it compresses them.
+     */
+    int32 TrainDictionary(const TArray<FString>& InFiles, const FSaveToolOptions& InOptions, FReencodeFunction InReencode)
+    {
+        FNumbskullFileHeader LatestHeader = FNumbskullFileHeader::FromSettings();
+
+        TArray<TArray<uint8>> Samples;
+        Samples.SetNum(InFiles.Num());
+
+        ParallelFor(InFiles.Num(), [&](int32 Index)
+        {
+            TArray<uint8> FileBytes;
+            FNumbskullFileHeader Header;
+            TArray<uint8> Payload;
+
+            if (!UNumbskullSerializationBPLibrary::LoadBytesFromDisk(InFiles[Index], FileBytes)
+                || !UNumbskullSerializationBPLibrary::DecodeFile(FileBytes, IsLegacyCompressed(FileBytes), Header, Payload)
+                || !InReencode(Header, Payload, &LatestHeader, Samples[Index]))
+            {
+                UE_LOG(Serializer, Warning, TEXT("{%s}: Couldn't decode, not using it to train"), *InFiles[Index]);
+                Samples[Index].Reset();
+            }
+        });
+
+        TArray<uint8> DictionaryBytes;
+        if (!FNumbskullCompressionDictionary::Train(Samples, InOptions.DictionarySize, DictionaryBytes))
+        {
+            return 1;
+        }
+
+        FNumbskullCompressionDictionary Trained;
+        Trained.Name = InOptions.DictionaryName;
+        Trained.Id = FNumbskullCompressionDictionary::MakeId(DictionaryBytes);
+        Trained.Bytes = DictionaryBytes;
+
+        int64 RawBytes = 0;
+        int64 ZlibBytes = 0;
+        int64 DictionaryCompressedBytes = 0;
+        double ZlibSeconds = 0.0;
+        double DictionarySeconds = 0.0;
+
+        for (const TArray<uint8>& Sample : Samples)
+        {
+            if (Sample.Num() == 0)
+            {
+                continue;
+            }
+
+            TArray<uint8> Compressed;
+
+            double StartTime = FPlatformTime::Seconds();
+            UNumbskullSerializationBPLibrary::CompressBytes(Sample, Compressed, NAME_Zlib, InOptions.CompressionFlags);
+            ZlibSeconds += FPlatformTime::Seconds() - StartTime;
+            ZlibBytes += Compressed.Num();
+
+            StartTime = FPlatformTime::Seconds();
+            Trained.Compress(Sample, Compressed, InOptions.CompressionFlags);
+            DictionarySeconds += FPlatformTime::Seconds() - StartTime;
+            DictionaryCompressedBytes += Compressed.Num();
+
+            RawBytes += Sample.Num();
+        }
+
+        UE_LOG(Serializer, Display, TEXT("Trained %d byte dictionary %08X on %.2f MB"), DictionaryBytes.Num(), Trained.Id, RawBytes / (1024.0 * 1024.0));
+        UE_LOG(Serializer, Display, TEXT("Zlib: %lld bytes (%.2fx) in %.2fms"), ZlibBytes, RawBytes / FMath::Max<double>(ZlibBytes, 1.0), ZlibSeconds * 1000.0);
+        UE_LOG(Serializer, Display, TEXT("Zlib with dictionary: %lld bytes (%.2fx) in %.2fms"), DictionaryCompressedBytes, RawBytes / FMath::Max<double>(DictionaryCompressedBytes, 1.0), DictionarySeconds * 1000.0);
+
+        if (InOptions.bDryRun)
+        {
+            return 0;
+        }
+
+        return FNumbskullCompressionDictionary::Save(InOptions.DictionaryName, DictionaryBytes).IsValid() ? 0 : 1;
+    }
+
+    void WriteReport(const FString& InReportFileName, const TArray<FString>& InFiles, const TArray<FSaveToolResult>& InResults)
+    {
+        TArray<FString> Lines;
+        Lines.Reserve(InFiles.Num() + 1);
+        Lines.Add(TEXT("File,Success,Result,Version,Compression,SizeBefore,SizeAfter,PayloadSize,Milliseconds"));
+
+        for (int32 Index = 0; Index < InFiles.Num(); ++Index)
+        {
+            const FSaveToolResult& Result = InResults[Index];
+            Lines.Add(FString::Printf(TEXT("\"%s\",%d,%s,%u,%s,%lld,%lld,%lld,%.3f"),
+                *InFiles[Index], Result.bSuccess ? 1 : 0, *Result.Message, Result.Version, *Result.Compression,
+                Result.SizeBefore, Result.SizeAfter, Result.PayloadSize, Result.Seconds * 1000.0));
+        }
+
+        if (!FFileHelper::SaveStringArrayToFile(Lines, *InReportFileName))
+        {
+            UE_LOG(Serializer, Error, TEXT("Couldn't write report {%s}"), *InReportFileName);
+        }
+    }
+}
+
+UNumbskullSaveToolCommandlet::UNumbskullSaveToolCommandlet()
+{
+    IsClient = false;
+    IsEditor = false;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+int32 UNumbskullSaveToolCommandlet::Main(const FString& Params)
+{
+    FString Directory;
+    if (!FParse::Value(*Params, TEXT("Dir="), Directory) || !IFileManager::Get().DirectoryExists(*Directory))
+    {
+        UE_LOG(Serializer, Error, TEXT("Pass an existing directory with -Dir="));
+        return 1;
+    }
+
+    FString Type = TEXT("ObjectData");
+    FParse::Value(*Params, TEXT("Type="), Type);
+
+    const FReencodeFunction ReencodeFunction = FindReencodeFunction(Type);
+    if (!ReencodeFunction)
+    {
+        UE_LOG(Serializer, Error, TEXT("Unknown type %s. Use ObjectData, ActorData, ActorProxy or ActorProxyBatch"), *Type);
+        return 1;
+    }
+
+    FSaveToolOptions Options;
+    if (!ParseOptions(Params, Options))
+    {
+        return 1;
+    }
+
+    FString Filter = TEXT("*");
+    FParse::Value(*Params, TEXT("Filter="), Filter);
+
+    const bool bVerbose = FParse::Param(*Params, TEXT("Verbose"));
+
+    TArray<FString> Files;
+    IFileManager::Get().FindFilesRecursive(Files, *Directory, *Filter, true, false);
+
+    // Leftovers from an interrupted run
+    Files.RemoveAll([](const FString& File) { return File.EndsWith(TEXT(".tmp")); });
+
+    UE_LOG(Serializer, Display, TEXT("Processing %d files in {%s} as %s"), Files.Num(), *Directory, *Type);
+
+    // The library logs every read and write, which would drown out the results
+    const ELogVerbosity::Type PreviousVerbosity = Serializer.GetVerbosity();
+    if (!bVerbose)
+    {
+        Serializer.SetVerbosity(ELogVerbosity::Warning);
+    }
+
+    if (Options.Mode == ESaveToolMode::Train)
+    {
+        const int32 Result = TrainDictionary(Files, Options, ReencodeFunction);
+        Serializer.SetVerbosity(PreviousVerbosity);
+        return Result;
+    }
+
+    TArray<FSaveToolResult> Results;
+    Results.SetNum(Files.Num());
+
+    const double StartTime = FPlatformTime::Seconds();
+
+    ParallelFor(Files.Num(), [&](int32 Index)
+    {
+        ProcessFile(Files[Index], Options, ReencodeFunction, Results[Index]);
+    });
+
+    const double Seconds = FMath::Max(FPlatformTime::Seconds() - StartTime, SMALL_NUMBER);
+
+    Serializer.SetVerbosity(PreviousVerbosity);
+
+    int32 NumFailed = 0;
+    int32 NumRewritten = 0;
+    int64 BytesBefore = 0;
+    int64 BytesAfter = 0;
+
+    for (int32 Index = 0; Index < Files.Num(); ++Index)
+    {
+        const FSaveToolResult& Result = Results[Index];
+
+        NumFailed += Result.bSuccess ? 0 : 1;
+        NumRewritten += Result.bRewritten ? 1 : 0;
+        BytesBefore += Result.SizeBefore;
+        BytesAfter += Result.SizeAfter;
+
+        if (!Result.bSuccess)
+        {
+            UE_LOG(Serializer, Error, TEXT("{%s}: %s"), *Files[Index], *Result.Message);
+        }
+        else if (bVerbose)
+        {
+            UE_LOG(Serializer, Display, TEXT("{%s}: %s. Version %u, %s, %lld -> %lld bytes (%lld raw), %.2fms"),
+                *Files[Index], *Result.Message, Result.Version, *Result.Compression,
+                Result.SizeBefore, Result.SizeAfter, Result.PayloadSize, Result.Seconds * 1000.0);
+        }
+    }
+
+    FString ReportFileName;
+    if (FParse::Value(*Params, TEXT("Report="), ReportFileName))
+    {
+        WriteReport(ReportFileName, Files, Results);
+    }
+
+    const double MegaBytesBefore = BytesBefore / (1024.0 * 1024.0);
+    const double MegaBytesAfter = BytesAfter / (1024.0 * 1024.0);
+
+    UE_LOG(Serializer, Display, TEXT("%d files, %d failed, %d %s in %.2fs"),
+        Files.Num(), NumFailed, NumRewritten, Options.bDryRun ? TEXT("would be rewritten") : TEXT("rewritten"), Seconds);
+    UE_LOG(Serializer, Display, TEXT("Throughput: %.1f files/s, %.2f MB/s"), Files.Num() / Seconds, MegaBytesBefore / Seconds);
+    UE_LOG(Serializer, Display, TEXT("Size: %.2f MB -> %.2f MB"), MegaBytesBefore, MegaBytesAfter);
+
+    return NumFailed == 0 ? 0 : 1;
+}
@@ -4,16 +4,33 @@
 
 // Interfaces
 #include "PostLoadListener.h"
+#include "NewGameListener.h"
+
+// File Format
+#include "NumbskullFileHeader.h"
+#include "NumbskullTransformCodec.h"
+#include "NumbskullSerializationSettings.h"
 
 // Serialization Objects
 #include "Serialization/BufferArchive.h"
 #include "Serialization/MemoryWriter.h"
 #include "Serialization/MemoryReader.h"
+#include "Serialization/BufferReader.h"
+
+// Load Cache
+#include "NumbskullLoadCache.h"
 
 // UObject Serialization
-#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "NumbskullArchive.h"
+#include "NumbskullVarInt.h"
+#include "NumbskullBulkData.h"
+#include "NumbskullReferenceTable.h"
+#include "NumbskullStructArray.h"
+#include "NewGameSnapshot.h"
+#include "NumbskullSlotRotation.h"
 
 // Compressed Serialization
+#include "NumbskullCompressionDictionary.h"
 #include "Serialization/ArchiveSaveCompressedProxy.h"
 #include "Serialization/ArchiveLoadCompressedProxy.h"
 #include "Misc/CompressionFlags.h"
@@ -24,10 +41,280 @@
 #include "GameFramework/Controller.h"
 #include "GameFramework/Pawn.h"
 #include "Runtime/Engine/Public/EngineGlobals.h"
+#include "EngineUtils.h"
+#include "Components/ActorComponent.h"
 #include "Misc/FileHelper.h"
+#include "HAL/FileManager.h"
+#include "Async/ParallelFor.h"
 
 DEFINE_LOG_CATEGORY(Serializer);
 
+namespace
+{
+    /** Bulk data of the storage types that have it*/
+    template <typename RecordType>
+    FNumbskullBulkData* GetBulkData(RecordType& InRecord) { return nullptr; }
+    
+    FNumbskullBulkData* GetBulkData(FActorData& InRecord) { return &InRecord.BulkData; }
+    
+    FNumbskullBulkData* GetBulkData(FActorProxy& InRecord) { return &InRecord.BulkData; }
+    
+    /**
+     * Saves bytes through a temporary file that's flushed and renamed over the file. The temporary file's stat is taken
+     * before the rename, which keeps it, so it describes exactly the bytes written even if something replaces them after.
+     */
+    bool SaveBytesReplacing(const FString& InFileName, const TArray<uint8>& InBytes, FFileStatData& OutStatData)
+    {
+        if (InBytes.Num() == 0)
+        {
+            UE_LOG(Serializer, Warning, TEXT("No bytes to save to disk"));
+            return false;
+        }
+        
+        // Whatever was cached for this file is about to be out of date, and records still reading from it need their bulk data
+        FNumbskullLoadCache::Get().Invalidate(InFileName);
+        FNumbskullBulkData::DetachFile(InFileName);
+        
+        // Never written in place, which would also change a slot backup that's hard linked to the file
+        const FString TempFileName = InFileName + TEXT(".tmp");
+        
+        if (FNumbskullSlotRotation::WriteFileFlushed(TempFileName, InBytes))
+        {
+            OutStatData = IFileManager::Get().GetStatData(*TempFileName);
+            
+            if (FNumbskullSlotRotation::ReplaceFile(TempFileName, InFileName))
+            {
+                UE_LOG(Serializer, Log, TEXT("Save Data To {%s} Successful"), *InFileName);
+                return true;
+            }
+        }
+        
+        IFileManager::Get().Delete(*TempFileName, false, false, true);
+        UE_LOG(Serializer, Error, TEXT("Couldn't save to {%s}"), *InFileName);
+        return false;
+    }
+    
+    /** Loads a file up to the end of its payload, leaving out any bulk data section*/
+    bool LoadFileWithoutBulkData(const FString& InFileName, TArray<uint8>& OutBytes)
+    {
+        TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*InFileName));
+        
+        if (!Reader)
+        {
+            UE_LOG(Serializer, Error, TEXT("Load Failed. Couldn't read from file {%s}"), *InFileName);
+            return false;
+        }
+        
+        int64 Size = Reader->TotalSize();
+        
+        FNumbskullFileHeader Header;
+        if (FNumbskullFileHeader::Read(*Reader, Header) && Header.HasBulkData())
+        {
+            Size = FMath::Min(Size, Reader->Tell() + Header.PayloadSize);
+        }
+        
+        if (Size <= 0 || Size > MAX_int32)
+        {
+            UE_LOG(Serializer, Log, TEXT("Load Data From {%s} Failed. No bytes found"), *InFileName);
+            return false;
+        }
+        
+        OutBytes.SetNumUninitialized(static_cast<int32>(Size));
+        Reader->Seek(0);
+        Reader->Serialize(OutBytes.GetData(), Size);
+        
+        if (!Reader->Close())
+        {
+            UE_LOG(Serializer, Error, TEXT("Load Failed. Couldn't read from file {%s}"), *InFileName);
+            return false;
+        }
+        
+        UE_LOG(Serializer, Log, TEXT("Load Data From {%s} Successful"), *InFileName);
+        
+        return true;
+    }
+    
+    /**
+     * Writes a storage type to disk with a file header describing its format.
+     */
+    template <typename RecordType>
+    bool SaveRecordToDisk(const FString& InFileName, RecordType& InRecord, bool bCompress)
+    {
+        FNumbskullFileHeader Header = FNumbskullFileHeader::FromSettings();
+        
+        if (bCompress)
+        {
+            Header.Flags |= ENumbskullFileFlags::Compressed;
+        }
+        
+        FBufferArchive Payload;
+        InRecord.SerializeVersioned(Payload, Header);
+        
+        TArray<uint8> BulkSection;
+        const FNumbskullBulkData* BulkData = GetBulkData(InRecord);
+        
+        if (BulkData && !BulkData->GetSection(BulkSection))
+        {
+            return false;
+        }
+        
+        TArray<uint8> FileBytes;
+        if (!UNumbskullSerializationBPLibrary::EncodeFile(Header, Payload, FileBytes, &BulkSection))
+        {
+            return false;
+        }
+        
+        FFileStatData StatData;
+        
+        if (!SaveBytesReplacing(InFileName, FileBytes, StatData))
+        {
+            return false;
+        }
+        
+        // The next load of this file is likely, and we already have its decoded payload
+        if (FNumbskullLoadCache::IsEnabled())
+        {
+            FNumbskullLoadCache::Get().Add(InFileName, false, Header, FNumbskullPayload(MoveTemp(static_cast<TArray<uint8>&>(Payload))), StatData);
+        }
+        
+        return true;
+    }
+    
+    /**
+     * Reads a storage type from disk, decoding it with the format recorded in its header.
+     *
+     * bLegacyCompressed is only used for files saved before the header was added.
+     */
+    template <typename RecordType>
+    bool LoadRecordFromDisk(const FString& InFileName, RecordType& OutRecord, bool bLegacyCompressed)
+    {
+        FNumbskullFileHeader Header;
+        FNumbskullPayload Payload;
+        
+        const bool bUseCache = FNumbskullLoadCache::IsEnabled();
+        const bool bCacheHit = bUseCache && FNumbskullLoadCache::Get().Find(InFileName, bLegacyCompressed, Header, Payload);
+        
+        // Taken before the read, so if the file changes during it the cached entry is already out of date rather than wrong
+        FFileStatData StatData;
+        
+        if (!bCacheHit)
+        {
+            if (bUseCache)
+            {
+                StatData = IFileManager::Get().GetStatData(*InFileName);
+            }
+            
+            TArray<uint8> FileBytes;
+            
+            // Bulk data is read straight into its destination when the record is applied
+            if (!LoadFileWithoutBulkData(InFileName, FileBytes))
+            {
+                return false;
+            }
+            
+            TArray<uint8> DecodedPayload;
+            
+            if (!UNumbskullSerializationBPLibrary::DecodeFile(FileBytes, bLegacyCompressed, Header, DecodedPayload))
+            {
+                UE_LOG(Serializer, Error, TEXT("Couldn't decode file {%s}"), *InFileName);
+                return false;
+            }
+            
+            Payload = MoveTemp(DecodedPayload);
+        }
+        
+        FMemoryReader FromBinary = FMemoryReader(Payload.Get(), true);
+        FromBinary.Seek(0);
+        
+        RecordType Record;
+        Record.SerializeVersioned(FromBinary, Header);
+        
+        if (FromBinary.IsError())
+        {
+            UE_LOG(Serializer, Error, TEXT("File {%s} is corrupt"), *InFileName);
+            return false;
+        }
+        
+        FNumbskullBulkData* BulkData = GetBulkData(Record);
+        
+        if (BulkData && Header.HasBulkData() && !BulkData->BindFile(InFileName, Header.BulkDataOffset, Header.BulkDataSize))
+        {
+            return false;
+        }
+        
+        if (bUseCache && !bCacheHit)
+        {
+            FNumbskullLoadCache::Get().Add(InFileName, bLegacyCompressed, Header, Payload, StatData);
+        }
+        
+        OutRecord = Record;
+        
+        return true;
+    }
+    
+    /**
+     * Reads many files of a storage type at once, spread over the task graph's workers so reads overlap and decode in parallel.
+     *
+     * Records come back in the order of the file names; a file that fails leaves an empty record behind.
+     */
+    template <typename RecordType>
+    bool LoadRecordsFromDisk(const TArray<FString>& InFileNames, TArray<RecordType>& OutRecords, TArray<bool>& OutLoaded, bool bLegacyCompressed)
+    {
+        OutRecords.Reset();
+        OutRecords.SetNum(InFileNames.Num());
+        
+        OutLoaded.Reset();
+        OutLoaded.SetNumZeroed(InFileNames.Num());
+        
+        // As many files are in flight as there are workers, plus the calling thread, which helps until every file is done
+        ParallelFor(InFileNames.Num(), [&](int32 Index)
+        {
+            OutLoaded[Index] = LoadRecordFromDisk(InFileNames[Index], OutRecords[Index], bLegacyCompressed);
+        });
+        
+        int32 NumFailed = 0;
+        
+        for (int32 Index = 0; Index < InFileNames.Num(); ++Index)
+        {
+            if (!OutLoaded[Index])
+            {
+                UE_LOG(Serializer, Warning, TEXT("Batch couldn't load {%s}"), *InFileNames[Index]);
+                ++NumFailed;
+            }
+        }
+        
+        return NumFailed == 0;
+    }
+    
+    /** Actors in the world that listen for new games, and their components that do*/
+    void GetNewGameListeners(UWorld* InWorld, TArray<UObject*>& OutListeners)
+    {
+        for (TActorIterator<AActor> It(InWorld); It; ++It)
+        {
+            AActor* Actor = *It;
+            
+            if (Actor->GetClass()->ImplementsInterface(UNewGameListener::StaticClass()))
+            {
+                OutListeners.Add(Actor);
+            }
+            
+            for (UActorComponent* Component : Actor->GetComponents())
+            {
+                if (Component && Component->GetClass()->ImplementsInterface(UNewGameListener::StaticClass()))
+                {
+                    OutListeners.Add(Component);
+                }
+            }
+        }
+    }
+    
+    /** Path of an object that's the same in play in editor, standalone and packaged games*/
+    FString GetNewGamePath(const UObject* InObject)
+    {
+        return UWorld::RemovePIEPrefix(InObject->GetPathName());
+    }
+}
+
 UNumbskullSerializationBPLibrary::UNumbskullSerializationBPLibrary(const FObjectInitializer &ObjectInitializer)
 : Super(ObjectInitializer)
 {
@@ -39,49 +326,89 @@ UNumbskullSerializationBPLibrary::UNumbskullSerializationBPLibrary(const FObject
 
 bool UNumbskullSerializationBPLibrary::Serialize(TArray<uint8>& OutSerializedData, UObject* InObject)
 {
-    FMemoryWriter Writer(OutSerializedData, true);
-    FObjectAndNameAsStringProxyArchive Archive(Writer, true);
+    return Serialize(OutSerializedData, InObject, nullptr);
+}
+
+bool UNumbskullSerializationBPLibrary::Serialize(TArray<uint8>& OutSerializedData, UObject* InObject, FNumbskullReferenceWriter* InReferenceWriter)
+{
+    FNumbskullVarIntWriter Writer(OutSerializedData, GetDefault<UNumbskullSerializationSettings>()->bVarIntEncoding);
+    FNumbskullArchive Archive(Writer, true);
+    Archive.SetReferenceWriter(InReferenceWriter);
     Writer.SetIsSaving(true);
     InObject->Serialize(Archive);
+    Writer.Finish();
     return true;
 }
 
 bool UNumbskullSerializationBPLibrary::ApplySerialization(const TArray<uint8>& SerializedData, UObject* InObject)
 {
-    if (!InObject || InObject->IsPendingKill() || SerializedData.Num() <= 0)
+    return ApplySerialization(SerializedData.GetData(), SerializedData.Num(), InObject);
+}
+
+bool UNumbskullSerializationBPLibrary::ApplySerialization(const uint8* SerializedData, int64 NumBytes, UObject* InObject, const FNumbskullBulkData* InBulkData)
+{
+    if (!ApplySerializationDeferred(SerializedData, NumBytes, InObject, nullptr, InBulkData))
+    {
+        return false;
+    }
+    
+    NotifyPostLoad(InObject);
+    
+    return true;
+}
+
+bool UNumbskullSerializationBPLibrary::ApplySerializationDeferred(const uint8* SerializedData, int64 NumBytes, UObject* InObject, FNumbskullReferenceReader* InReferenceReader, const FNumbskullBulkData* InBulkData)
+{
+    if (!InObject || InObject->IsPendingKill() || NumBytes <= 0)
     {
         UE_LOG(Serializer, Warning, TEXT("Couldn't apply serialized data on the object. Either it's null, being destroyed or there's no data"));
         return false;
     }
     
-    FMemoryReader ActorReader(SerializedData, true);
-    FObjectAndNameAsStringProxyArchive Archive(ActorReader, true);
+    // Compact data is decoded in one pass up front, then read like any other
+    TArray<uint8> DecodedData;
+    if (FNumbskullVarInt::IsEncoded(SerializedData, NumBytes))
+    {
+        if (!FNumbskullVarInt::Decode(SerializedData, NumBytes, DecodedData))
+        {
+            UE_LOG(Serializer, Error, TEXT("Couldn't decode compact serialized data"));
+            return false;
+        }
+        
+        SerializedData = DecodedData.GetData();
+        NumBytes = DecodedData.Num();
+    }
+    
+    // Reads in place so slices of larger buffers don't need copying
+    FBufferReader ActorReader(const_cast<uint8*>(SerializedData), NumBytes, false, true);
+    FNumbskullArchive Archive(ActorReader, true);
+    Archive.SetReferenceReader(InReferenceReader);
+    Archive.SetBulkDataReader(InBulkData);
     ActorReader.SetIsLoading(true);
     
     InObject->Serialize(Archive);
     
-    if (InObject->GetClass()->ImplementsInterface(UPostLoadListener::StaticClass()))
+    if (Archive.IsError() || ActorReader.IsError())
     {
-        IPostLoadListener::Execute_PostLoad(InObject);
+        UE_LOG(Serializer, Error, TEXT("Couldn't apply serialized data on {%s}. The data is corrupt or its bulk data couldn't be read"), *InObject->GetName());
+        return false;
     }
     
     return true;
 }
 
-bool UNumbskullSerializationBPLibrary::SaveBytesToDisk(const FString& InFileName, const TArray<uint8>& InBytes)
+void UNumbskullSerializationBPLibrary::NotifyPostLoad(UObject* InObject)
 {
-    if (InBytes.Num() == 0)
-    {
-        UE_LOG(Serializer, Warning, TEXT("No bytes to save to disk"));
-        return false;
-    }
-    
-    if (FFileHelper::SaveArrayToFile(InBytes, *InFileName))
+    if (InObject && InObject->GetClass()->ImplementsInterface(UPostLoadListener::StaticClass()))
     {
-        UE_LOG(Serializer, Log, TEXT("Save Data To {%s} Successful"), *InFileName);
-        return true;
+        IPostLoadListener::Execute_PostLoad(InObject);
     }
-    return false;
+}
+
+bool UNumbskullSerializationBPLibrary::SaveBytesToDisk(const FString& InFileName, const TArray<uint8>& InBytes)
+{
+    FFileStatData StatData;
+    return SaveBytesReplacing(InFileName, InBytes, StatData);
 }
 
 bool UNumbskullSerializationBPLibrary::LoadBytesFromDisk(const FString& InFileName, TArray<uint8>& OutBytes)
@@ -115,13 +442,150 @@ bool UNumbskullSerializationBPLibrary::SaveArchiveToDisk(const FString& InFileNa
 bool UNumbskullSerializationBPLibrary::SaveArchiveToDiskCompressed(const FString& InFileName, FBufferArchive InArchive)
 {
     TArray<uint8> CompressedData;
-    FArchiveSaveCompressedProxy Compressor = FArchiveSaveCompressedProxy(CompressedData, NAME_Zlib);
+    CompressBytes(InArchive, CompressedData);
+    
+    return SaveBytesToDisk(InFileName, CompressedData);
+}
+
+void UNumbskullSerializationBPLibrary::CompressBytes(const TArray<uint8>& InBytes, TArray<uint8>& OutCompressedBytes, FName InFormat, uint32 InFlags)
+{
+    FArchiveSaveCompressedProxy Compressor = FArchiveSaveCompressedProxy(OutCompressedBytes, InFormat, static_cast<ECompressionFlags>(InFlags));
     
-    Compressor << InArchive;
+    // Same layout as serializing the array, without copying it first
+    int32 NumBytes = InBytes.Num();
+    Compressor << NumBytes;
+    Compressor.Serialize(const_cast<uint8*>(InBytes.GetData()), NumBytes);
     
     Compressor.Flush();
+}
+
+bool UNumbskullSerializationBPLibrary::DecompressBytes(const TArray<uint8>& InCompressedBytes, TArray<uint8>& OutBytes, FName InFormat)
+{
+    FArchiveLoadCompressedProxy Decompressor =
+    FArchiveLoadCompressedProxy(InCompressedBytes, InFormat);
     
-    return SaveBytesToDisk(InFileName, CompressedData);
+    if(Decompressor.GetError())
+    {
+        UE_LOG(Serializer, Error, TEXT("FArchiveLoadCompressedProxy>> ERROR : File Was Not Compressed"));
+        return false;
+    }
+    
+    Decompressor << OutBytes;
+    
+    return !Decompressor.GetError();
+}
+
+bool UNumbskullSerializationBPLibrary::EncodeFile(FNumbskullFileHeader& InHeader, const TArray<uint8>& InPayload, TArray<uint8>& OutFileBytes, const TArray<uint8>* InBulkSection)
+{
+    const bool bHasBulkData = InBulkSection && InBulkSection->Num() > 0;
+    
+    if (bHasBulkData && InHeader.Version < ENumbskullFileVersion::AddedBulkData)
+    {
+        UE_LOG(Serializer, Error, TEXT("File version %u can't store bulk data"), InHeader.Version);
+        return false;
+    }
+    
+    InHeader.PayloadSize = 0;
+    InHeader.BulkDataOffset = 0;
+    InHeader.BulkDataSize = 0;
+    
+    FMemoryWriter Writer(OutFileBytes, true);
+    Writer << InHeader;
+    
+    if (Writer.IsError())
+    {
+        return false;
+    }
+    
+    const int64 HeaderSize = OutFileBytes.Num();
+    
+    if (InHeader.HasFlag(ENumbskullFileFlags::Compressed) && InHeader.DictionaryId != 0)
+    {
+        const TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> Dictionary = FNumbskullCompressionDictionary::FindById(InHeader.DictionaryId);
+        
+        TArray<uint8> CompressedData;
+        if (!Dictionary.IsValid() || !Dictionary->Compress(InPayload, CompressedData, InHeader.CompressionFlags))
+        {
+            UE_LOG(Serializer, Error, TEXT("Couldn't compress with dictionary %08X"), InHeader.DictionaryId);
+            return false;
+        }
+        OutFileBytes.Append(CompressedData);
+    }
+    else if (InHeader.HasFlag(ENumbskullFileFlags::Compressed))
+    {
+        TArray<uint8> CompressedData;
+        CompressBytes(InPayload, CompressedData, InHeader.CompressionFormat, InHeader.CompressionFlags);
+        OutFileBytes.Append(CompressedData);
+    }
+    else
+    {
+        OutFileBytes.Append(InPayload);
+    }
+    
+    if (bHasBulkData)
+    {
+        InHeader.PayloadSize = OutFileBytes.Num() - HeaderSize;
+        InHeader.BulkDataOffset = Align(static_cast<int64>(OutFileBytes.Num()), FNumbskullBulkData::SectionAlignment);
+        InHeader.BulkDataSize = InBulkSection->Num();
+        
+        OutFileBytes.SetNumZeroed(static_cast<int32>(InHeader.BulkDataOffset));
+        OutFileBytes.Append(*InBulkSection);
+        
+        // Same size as before, only the values have changed
+        Writer.Seek(0);
+        Writer << InHeader;
+    }
+    
+    return true;
+}
+
+bool UNumbskullSerializationBPLibrary::DecodeFile(const TArray<uint8>& InFileBytes, bool bLegacyCompressed, FNumbskullFileHeader& OutHeader, TArray<uint8>& OutPayload)
+{
+    FMemoryReader Reader(InFileBytes, true);
+    
+    if (!FNumbskullFileHeader::Read(Reader, OutHeader))
+    {
+        return false;
+    }
+    
+    const int64 PayloadOffset = Reader.Tell();
+    const bool bCompressed = OutHeader.IsLegacy() ? bLegacyCompressed : OutHeader.HasFlag(ENumbskullFileFlags::Compressed);
+    
+    // Any bulk data section after the payload is read separately
+    const int64 PayloadSize = OutHeader.HasBulkData() ? OutHeader.PayloadSize : InFileBytes.Num() - PayloadOffset;
+    
+    if (PayloadOffset + PayloadSize > InFileBytes.Num())
+    {
+        UE_LOG(Serializer, Error, TEXT("File is shorter than its header says"));
+        return false;
+    }
+    
+    if (!bCompressed)
+    {
+        OutPayload = TArray<uint8>(InFileBytes.GetData() + PayloadOffset, PayloadSize);
+        return true;
+    }
+    
+    if (PayloadOffset == 0)
+    {
+        return DecompressBytes(InFileBytes, OutPayload);
+    }
+    
+    if (OutHeader.DictionaryId != 0)
+    {
+        const TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> Dictionary = FNumbskullCompressionDictionary::FindById(OutHeader.DictionaryId);
+        
+        if (!Dictionary.IsValid())
+        {
+            UE_LOG(Serializer, Error, TEXT("File was compressed with dictionary %08X, which isn't in {%s}"), OutHeader.DictionaryId, *FNumbskullCompressionDictionary::GetDirectory());
+            return false;
+        }
+        
+        return Dictionary->Decompress(InFileBytes.GetData() + PayloadOffset, PayloadSize, OutPayload);
+    }
+    
+    const TArray<uint8> CompressedData(InFileBytes.GetData() + PayloadOffset, PayloadSize);
+    return DecompressBytes(CompressedData, OutPayload, OutHeader.CompressionFormat);
 }
 
 bool UNumbskullSerializationBPLibrary::DeleteFile(const FString& FilePath)
@@ -135,6 +599,9 @@ bool UNumbskullSerializationBPLibrary::DeleteFile(const FString& FilePath)
         return false;
     }
 
+    FNumbskullLoadCache::Get().Invalidate(FilePath);
+    FNumbskullBulkData::DetachFile(FilePath);
+
     // Delete the text file
     if (!FileManager.Delete(*FilePath))
     {
@@ -155,33 +622,21 @@ bool UNumbskullSerializationBPLibrary::SaveActor(AActor* InActorToSave, FActorPr
 {
     if (ensure(InActorToSave))
     {
-        // Pawns forget or override new controllers upon level loads
-        // To avoid this, unpossess before saving
-        APawn* Pawn = Cast<APawn>(InActorToSave);
-        AController* Controller = Pawn ? Pawn->Controller : nullptr;
-        
-        if (Pawn && Controller)
-        {
-            UE_LOG(Serializer, Log, TEXT("Unpossessing pawn before saving"));
-            Pawn->Controller->UnPossess();
-        }
-        
         FActorProxy ActorProxy;
         ActorProxy.ActorName = InActorToSave->GetFName();
         ActorProxy.ActorClass = InActorToSave->GetClass()->GetPathName();
         ActorProxy.ActorTransform = InActorToSave->GetTransform();
+        ActorProxy.PossessedBy = GetPossessedBy(InActorToSave);
         
-        Serialize(ActorProxy.ActorData, InActorToSave);
-        
-        OutActorProxy = ActorProxy;
+        SerializeActor(ActorProxy.ActorData.GetMutable(), InActorToSave, nullptr, &ActorProxy.BulkData);
         
-        // If we are only saving the level, we need to repossess the pawns
-        if (Pawn && Controller)
+        if (GetDefault<UNumbskullSerializationSettings>()->bWritePropertyIndexes)
         {
-            UE_LOG(Serializer, Log, TEXT("Saved and repossessing pawn"));
-            Controller->Possess(Pawn);
+            ActorProxy.PropertyIndex.Build(ActorProxy.ActorData, { 0 });
         }
         
+        OutActorProxy = ActorProxy;
+        
         check(!ActorProxy.ActorClass.IsEmpty());
         
         return true;
@@ -190,6 +645,83 @@ bool UNumbskullSerializationBPLibrary::SaveActor(AActor* InActorToSave, FActorPr
     return false;
 }
 
+bool UNumbskullSerializationBPLibrary::SerializeActor(TArray<uint8>& OutSerializedData, AActor* InActor, FNumbskullReferenceWriter* InReferenceWriter, FNumbskullBulkData* InBulkData)
+{
+    FNumbskullVarIntWriter Writer(OutSerializedData, GetDefault<UNumbskullSerializationSettings>()->bVarIntEncoding);
+    FNumbskullArchive Archive(Writer, true);
+    Archive.SetReferenceWriter(InReferenceWriter);
+    Archive.SetBulkDataWriter(InBulkData);
+    Writer.SetIsSaving(true);
+    
+    // Pawns forget or override new controllers upon level loads if their controller is saved.
+    // Rather than unpossessing (which fires possession events), leave the controller out of the data.
+    // The controller is recorded separately in PossessedBy and possesses the pawn again on load.
+    APawn* Pawn = Cast<APawn>(InActor);
+    AController* Controller = Pawn ? Pawn->Controller : nullptr;
+    
+    if (Pawn && Controller)
+    {
+        static const FProperty* ControllerProperty = FindFProperty<FProperty>(APawn::StaticClass(), TEXT("Controller"));
+        static const FProperty* PlayerStateProperty = FindFProperty<FProperty>(APawn::StaticClass(), TEXT("PlayerState"));
+        static const FProperty* OwnerProperty = FindFProperty<FProperty>(AActor::StaticClass(), TEXT("Owner"));
+        
+        Archive.SkipProperty(ControllerProperty);
+        Archive.SkipProperty(PlayerStateProperty);
+        
+        // Possessing sets the controller as the owner, unpossessing clears it
+        if (Pawn->GetOwner() == Controller)
+        {
+            Archive.SkipProperty(OwnerProperty);
+        }
+    }
+    
+    InActor->Serialize(Archive);
+    Writer.Finish();
+    
+    return true;
+}
+
+FString UNumbskullSerializationBPLibrary::GetPossessedBy(AActor* InActor)
+{
+    APawn* Pawn = Cast<APawn>(InActor);
+    AController* Controller = Pawn ? Pawn->Controller : nullptr;
+    
+    return Controller ? Controller->GetPathName() : FString();
+}
+
+void UNumbskullSerializationBPLibrary::RestorePossession(AActor* InLoadedActor, const FString& InPossessedBy)
+{
+    APawn* Pawn = Cast<APawn>(InLoadedActor);
+    
+    if (!Pawn || InPossessedBy.IsEmpty())
+    {
+        return;
+    }
+    
+    // Pawns that spawned their own controller (auto possess AI) keep it
+    if (Pawn->Controller)
+    {
+        return;
+    }
+    
+    AController* Controller = FindObject<AController>(nullptr, *InPossessedBy);
+    
+    if (!Controller || Controller->IsPendingKill() || Controller->GetWorld() != Pawn->GetWorld())
+    {
+        UE_LOG(Serializer, Log, TEXT("Controller {%s} no longer exists. Pawn {%s} loaded unpossessed"), *InPossessedBy, *Pawn->GetName());
+        return;
+    }
+    
+    if (Controller->GetPawn())
+    {
+        UE_LOG(Serializer, Log, TEXT("Controller {%s} already possesses a pawn. Pawn {%s} loaded unpossessed"), *InPossessedBy, *Pawn->GetName());
+        return;
+    }
+    
+    UE_LOG(Serializer, Log, TEXT("Repossessing loaded pawn"));
+    Controller->Possess(Pawn);
+}
+
 bool UNumbskullSerializationBPLibrary::LoadActor(const UObject* WorldContextObject, const FActorProxy& InActorProxy, AActor*& OutLoadedActor)
 {
     check(WorldContextObject);
@@ -200,21 +732,11 @@ bool UNumbskullSerializationBPLibrary::LoadActor(const UObject* WorldContextObje
     check(!InActorProxy.ActorClass.IsEmpty());
     check(InActorProxy.ActorData.Num() > 0);
     
-    FActorSpawnParameters SpawnParams;
-    SpawnParams.Name = InActorProxy.ActorName;
-    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
-    SpawnParams.OverrideLevel = World->PersistentLevel;
-    SpawnParams.NameMode = FActorSpawnParameters::ESpawnActorNameMode::Requested;
-    UClass* SpawnClass = FindObject<UClass>(ANY_PACKAGE, *InActorProxy.ActorClass);
-    
-    if (!SpawnClass)
-    {
-        SpawnClass = StaticLoadClass(AActor::StaticClass(), nullptr, *InActorProxy.ActorClass);
-    }
+    UClass* SpawnClass = FindActorClass(InActorProxy.ActorClass);
     
     if (SpawnClass)
     {
-        AActor* SpawnedActor = World->SpawnActor(SpawnClass, &InActorProxy.ActorTransform, SpawnParams);
+        AActor* SpawnedActor = SpawnActorForLoad(World, SpawnClass, InActorProxy.ActorName, InActorProxy.ActorTransform);
         
         if (!SpawnedActor)
         {
@@ -222,7 +744,9 @@ bool UNumbskullSerializationBPLibrary::LoadActor(const UObject* WorldContextObje
             return false;
         }
         
-        ApplySerialization(InActorProxy.ActorData, SpawnedActor);
+        ApplySerialization(InActorProxy.ActorData.GetData(), InActorProxy.ActorData.Num(), SpawnedActor, &InActorProxy.BulkData);
+        
+        RestorePossession(SpawnedActor, InActorProxy.PossessedBy);
         
         OutLoadedActor = SpawnedActor;
         return true;
@@ -231,71 +755,237 @@ bool UNumbskullSerializationBPLibrary::LoadActor(const UObject* WorldContextObje
     return false;
 }
 
-bool UNumbskullSerializationBPLibrary::SaveActorProxyToDisk(const FString& InFileName, FActorProxy InActorProxy)
+UClass* UNumbskullSerializationBPLibrary::FindActorClass(const FString& InActorClass)
+{
+    UClass* ActorClass = FindObject<UClass>(ANY_PACKAGE, *InActorClass);
+    
+    if (!ActorClass)
+    {
+        ActorClass = StaticLoadClass(AActor::StaticClass(), nullptr, *InActorClass);
+    }
+    
+    return ActorClass;
+}
+
+AActor* UNumbskullSerializationBPLibrary::SpawnActorForLoad(UWorld* InWorld, UClass* InActorClass, FName InActorName, const FTransform& InActorTransform)
 {
-    FBufferArchive BinaryData;
-    BinaryData << InActorProxy;
+    FActorSpawnParameters SpawnParams;
+    SpawnParams.Name = InActorName;
+    SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+    SpawnParams.OverrideLevel = InWorld->PersistentLevel;
+    SpawnParams.NameMode = FActorSpawnParameters::ESpawnActorNameMode::Requested;
     
-    return SaveArchiveToDisk(InFileName, BinaryData);
+    return InWorld->SpawnActor(InActorClass, &InActorTransform, SpawnParams);
+}
+
+bool UNumbskullSerializationBPLibrary::SaveActorProxyToDisk(const FString& InFileName, FActorProxy InActorProxy)
+{
+    return SaveRecordToDisk(InFileName, InActorProxy, false);
 }
 
 bool UNumbskullSerializationBPLibrary::SaveActorProxyToDiskCompressed(const FString& InFileName, FActorProxy InActorProxy)
 {
-    FBufferArchive BinaryData;
-    BinaryData << InActorProxy;
+    return SaveRecordToDisk(InFileName, InActorProxy, true);
+}
+
+bool UNumbskullSerializationBPLibrary::LoadActorProxyFromDisk(const FString& InFileName, FActorProxy& OutActorProxy)
+{
+    return LoadRecordFromDisk(InFileName, OutActorProxy, false);
+}
+
+bool UNumbskullSerializationBPLibrary::LoadActorProxyFromDiskCompressed(const FString& InFileName, FActorProxy& OutActorProxy)
+{
+    return LoadRecordFromDisk(InFileName, OutActorProxy, true);
+}
+
+//
+// ACTOR PROXY BATCHES
+//
+
+bool UNumbskullSerializationBPLibrary::SaveActors(const TArray<AActor*>& InActorsToSave, FActorProxyBatch& OutActorProxyBatch)
+{
+    if (InActorsToSave.Num() == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("No actors to save"));
+        return false;
+    }
+    
+    // Snapshot indices have to match batch indices, so drop null actors up front
+    TArray<UObject*> SnapshotObjects;
+    SnapshotObjects.Reserve(InActorsToSave.Num());
+    
+    for (AActor* Actor : InActorsToSave)
+    {
+        if (Actor)
+        {
+            SnapshotObjects.Add(Actor);
+        }
+        else
+        {
+            UE_LOG(Serializer, Warning, TEXT("Skipping null actor in batch"));
+        }
+    }
+    
+    FActorProxyBatch Batch;
+    Batch.Reserve(SnapshotObjects.Num());
+    
+    FNumbskullReferenceWriter ReferenceWriter(Batch.References, SnapshotObjects);
+    
+    // Reused between actors to avoid an allocation each
+    TArray<uint8> ActorData;
+    
+    for (UObject* Object : SnapshotObjects)
+    {
+        AActor* Actor = CastChecked<AActor>(Object);
+        
+        ActorData.Reset();
+        SerializeActor(ActorData, Actor, &ReferenceWriter);
+        
+        Batch.Add(Actor->GetClass()->GetPathName(), Actor->GetFName(), Actor->GetTransform(), ActorData.GetData(), ActorData.Num(), GetPossessedBy(Actor));
+    }
+    
+    OutActorProxyBatch = MoveTemp(Batch);
+    
+    return true;
+}
+
+bool UNumbskullSerializationBPLibrary::LoadActors(const UObject* WorldContextObject, const FActorProxyBatch& InActorProxyBatch, TArray<AActor*>& OutLoadedActors)
+{
+    check(WorldContextObject);
+    
+    UWorld* const World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+    
+    check(World);
+    
+    if (!InActorProxyBatch.IsValid())
+    {
+        UE_LOG(Serializer, Error, TEXT("Actor proxy batch is malformed. Can't load actors"));
+        return false;
+    }
+    
+    // Each class is only looked up once, rather than once per actor
+    TArray<UClass*> SpawnClasses;
+    SpawnClasses.Reserve(InActorProxyBatch.Classes.Num());
+    
+    for (const FString& ActorClass : InActorProxyBatch.Classes)
+    {
+        UClass* SpawnClass = FindActorClass(ActorClass);
+        
+        if (!SpawnClass)
+        {
+            UE_LOG(Serializer, Warning, TEXT("Couldn't find class {%s}. Its actors won't be spawned"), *ActorClass);
+        }
+        
+        SpawnClasses.Add(SpawnClass);
+    }
+    
+    TArray<AActor*> LoadedActors;
+    LoadedActors.Reserve(InActorProxyBatch.Num());
+    
+    bool bAllLoaded = true;
+    
+    // Every actor is spawned before any data is applied, so references between them resolve as they're read
+    for (int32 Index = 0; Index < InActorProxyBatch.Num(); ++Index)
+    {
+        UClass* SpawnClass = SpawnClasses[InActorProxyBatch.ClassIndices[Index]];
+        AActor* SpawnedActor = SpawnClass ? SpawnActorForLoad(World, SpawnClass, InActorProxyBatch.Names[Index], InActorProxyBatch.Transforms[Index]) : nullptr;
+        
+        bAllLoaded &= SpawnedActor != nullptr;
+        
+        // Keep indices lined up with the batch, even for actors that failed
+        LoadedActors.Add(SpawnedActor);
+    }
+    
+    // Batches saved without a reference table store paths inline and resolve them as they go
+    FNumbskullReferenceReader ReferenceReader(InActorProxyBatch.References, TArray<UObject*>(LoadedActors));
+    FNumbskullReferenceReader* ReferenceReaderPtr = InActorProxyBatch.References.bEnabled ? &ReferenceReader : nullptr;
+    
+    for (int32 Index = 0; Index < LoadedActors.Num(); ++Index)
+    {
+        if (LoadedActors[Index] && !ApplySerializationDeferred(InActorProxyBatch.GetData(Index), InActorProxyBatch.GetDataSize(Index), LoadedActors[Index], ReferenceReaderPtr))
+        {
+            bAllLoaded = false;
+        }
+    }
+    
+    for (int32 Index = 0; Index < LoadedActors.Num(); ++Index)
+    {
+        NotifyPostLoad(LoadedActors[Index]);
+        RestorePossession(LoadedActors[Index], InActorProxyBatch.PossessedBy[Index]);
+    }
+    
+    OutLoadedActors = MoveTemp(LoadedActors);
     
-    return SaveArchiveToDiskCompressed(InFileName, BinaryData);
+    return bAllLoaded;
 }
 
-bool UNumbskullSerializationBPLibrary::LoadActorProxyFromDisk(const FString& InFileName, FActorProxy& OutActorProxy)
+bool UNumbskullSerializationBPLibrary::MakeActorProxyBatch(const TArray<FActorProxy>& InActorProxies, FActorProxyBatch& OutActorProxyBatch)
 {
-    TArray<uint8> Bytes;
+    FActorProxyBatch Batch;
+    Batch.Reserve(InActorProxies.Num());
     
-    if (!LoadBytesFromDisk(InFileName, Bytes))
+    for (const FActorProxy& ActorProxy : InActorProxies)
     {
-        return false;
+        if (!ActorProxy.BulkData.IsEmpty())
+        {
+            UE_LOG(Serializer, Warning, TEXT("Actor proxy %s has bulk data, which batches don't store. Save it on its own instead"), *ActorProxy.ActorName.ToString());
+        }
+        
+        Batch.Add(ActorProxy);
     }
     
-    FMemoryReader FromBinary = FMemoryReader(Bytes, true);
-    FromBinary.Seek(0);
-    
-    FActorProxy ActorProxy;
-    FromBinary << ActorProxy;
-    
-    OutActorProxy = ActorProxy;
+    OutActorProxyBatch = MoveTemp(Batch);
     
     return true;
 }
 
-bool UNumbskullSerializationBPLibrary::LoadActorProxyFromDiskCompressed(const FString& InFileName, FActorProxy& OutActorProxy)
-{    
-    TArray<uint8> Bytes;
-    
-    LoadBytesFromDisk(InFileName, Bytes);
-    
-    FArchiveLoadCompressedProxy Decompressor =
-    FArchiveLoadCompressedProxy(Bytes, NAME_Zlib);
-    
-    if(Decompressor.GetError())
+bool UNumbskullSerializationBPLibrary::BreakActorProxyBatch(const FActorProxyBatch& InActorProxyBatch, TArray<FActorProxy>& OutActorProxies)
+{
+    if (!InActorProxyBatch.IsValid())
     {
-        UE_LOG(Serializer, Error, TEXT("FArchiveLoadCompressedProxy>> ERROR : File Was Not Compressed"));
+        UE_LOG(Serializer, Error, TEXT("Actor proxy batch is malformed"));
         return false;
     }
     
-    FBufferArchive DecompressedBinaryArray;
-    Decompressor << DecompressedBinaryArray;
+    if (InActorProxyBatch.References.bEnabled)
+    {
+        UE_LOG(Serializer, Error, TEXT("Actor proxy batch stores references in a reference table and can't be split into actor proxies. Load it with LoadActors"));
+        return false;
+    }
     
-    FMemoryReader FromBinary = FMemoryReader(DecompressedBinaryArray, true);
-    FromBinary.Seek(0);
+    TArray<FActorProxy> ActorProxies;
+    ActorProxies.SetNum(InActorProxyBatch.Num());
     
-    FActorProxy ActorProxy;
-    FromBinary << ActorProxy;
+    for (int32 Index = 0; Index < InActorProxyBatch.Num(); ++Index)
+    {
+        InActorProxyBatch.GetActorProxy(Index, ActorProxies[Index]);
+    }
     
-    OutActorProxy = ActorProxy;
+    OutActorProxies = MoveTemp(ActorProxies);
     
     return true;
 }
 
+bool UNumbskullSerializationBPLibrary::SaveActorProxyBatchToDisk(const FString& InFileName, FActorProxyBatch InActorProxyBatch)
+{
+    return SaveRecordToDisk(InFileName, InActorProxyBatch, false);
+}
+
+bool UNumbskullSerializationBPLibrary::LoadActorProxyBatchFromDisk(const FString& InFileName, FActorProxyBatch& OutActorProxyBatch)
+{
+    return LoadRecordFromDisk(InFileName, OutActorProxyBatch, false);
+}
+
+bool UNumbskullSerializationBPLibrary::SaveActorProxyBatchToDiskCompressed(const FString& InFileName, FActorProxyBatch InActorProxyBatch)
+{
+    return SaveRecordToDisk(InFileName, InActorProxyBatch, true);
+}
+
+bool UNumbskullSerializationBPLibrary::LoadActorProxyBatchFromDiskCompressed(const FString& InFileName, FActorProxyBatch& OutActorProxyBatch)
+{
+    return LoadRecordFromDisk(InFileName, OutActorProxyBatch, true);
+}
+
 //
 // UOBJECTS
 //
@@ -310,7 +1000,12 @@ bool UNumbskullSerializationBPLibrary::SaveObject(UObject* InObject, FObjectData
     
     FObjectData ObjectData;
     
-    Serialize(ObjectData.Data, InObject);
+    Serialize(ObjectData.Data.GetMutable(), InObject);
+    
+    if (GetDefault<UNumbskullSerializationSettings>()->bWritePropertyIndexes)
+    {
+        ObjectData.PropertyIndex.Build(ObjectData.Data, { 0 });
+    }
     
     OutObjectData = ObjectData;
     
@@ -323,6 +1018,11 @@ bool UNumbskullSerializationBPLibrary::LoadObject(UObject* InObject, FObjectData
 }
 
 bool UNumbskullSerializationBPLibrary::SaveObjects(const TArray<UObject*>& InObjects, FObjectData& OutObjectData)
+{
+    return SaveObjects(InObjects, OutObjectData, GetDefault<UNumbskullSerializationSettings>()->bWritePropertyIndexes);
+}
+
+bool UNumbskullSerializationBPLibrary::SaveObjects(const TArray<UObject*>& InObjects, FObjectData& OutObjectData, bool bBuildPropertyIndex)
 {
     if (InObjects.Num() == 0)
     {
@@ -332,19 +1032,40 @@ bool UNumbskullSerializationBPLibrary::SaveObjects(const TArray<UObject*>& InObj
     
     FObjectData ObjectData;
     
+    // References between the saved objects are stored by index so they survive renames
+    TUniquePtr<FNumbskullReferenceWriter> ReferenceWriter;
+    if (GetDefault<UNumbskullSerializationSettings>()->bUseReferenceTables)
+    {
+        ReferenceWriter = MakeUnique<FNumbskullReferenceWriter>(ObjectData.References, InObjects);
+    }
+    
     // We can't use the serialize method as it'd override the bytes, rather than adding to it
-    FMemoryWriter Writer(ObjectData.Data, true);
-    FObjectAndNameAsStringProxyArchive Archive(Writer, true);
+    FNumbskullVarIntWriter Writer(ObjectData.Data.GetMutable(), GetDefault<UNumbskullSerializationSettings>()->bVarIntEncoding);
+    FNumbskullArchive Archive(Writer, true);
+    Archive.SetReferenceWriter(ReferenceWriter.Get());
     Archive.SetIsSaving(true);
     
+    TArray<int32> ObjectOffsets;
+    ObjectOffsets.Reserve(InObjects.Num());
+    
     for (UObject* Object : InObjects)
     {
+        ObjectOffsets.Add(Object ? static_cast<int32>(Writer.Tell()) : INDEX_NONE);
+        
         if (Object)
         {
             Object->Serialize(Archive);
         }
     }
     
+    // Offsets are in the data as written, so index it before it's encoded
+    if (bBuildPropertyIndex)
+    {
+        ObjectData.PropertyIndex.Build(ObjectData.Data, ObjectOffsets);
+    }
+    
+    Writer.Finish();
+    
     OutObjectData = ObjectData;
     
     return true;
@@ -364,8 +1085,18 @@ bool UNumbskullSerializationBPLibrary::LoadObjects(const TArray<UObject*>& InObj
         return false;
     }
     
-    FMemoryReader ActorReader (InObjectData.Data, true);
-    FObjectAndNameAsStringProxyArchive Archive(ActorReader, true);
+    FNumbskullReferenceReader ReferenceReader(InObjectData.References, InObjects);
+    
+    TArray<uint8> DecodedData;
+    if (FNumbskullVarInt::IsEncoded(InObjectData.Data) && !FNumbskullVarInt::Decode(InObjectData.Data.GetData(), InObjectData.Data.Num(), DecodedData))
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't decode compact serialized data"));
+        return false;
+    }
+    
+    FMemoryReader ActorReader (DecodedData.Num() > 0 ? DecodedData : InObjectData.Data.Get(), true);
+    FNumbskullArchive Archive(ActorReader, true);
+    Archive.SetReferenceReader(InObjectData.References.bEnabled ? &ReferenceReader : nullptr);
     ActorReader.SetIsLoading(true);
     
     for (UObject* Object : InObjects)
@@ -373,80 +1104,41 @@ bool UNumbskullSerializationBPLibrary::LoadObjects(const TArray<UObject*>& InObj
         if (Object)
         {
             Object->Serialize(Archive);
-            
-            if (Object->GetClass()->ImplementsInterface(UPostLoadListener::StaticClass()))
-            {
-                IPostLoadListener::Execute_PostLoad(Object);
-            }
         }
     }
     
+    for (UObject* Object : InObjects)
+    {
+        NotifyPostLoad(Object);
+    }
+    
+    if (Archive.IsError() || ActorReader.IsError())
+    {
+        UE_LOG(Serializer, Error, TEXT("Object data is corrupt. Some objects may not have loaded"));
+        return false;
+    }
+    
     return true;
 }
 
 bool UNumbskullSerializationBPLibrary::SaveObjectDataToDisk(const FString& InFileName, FObjectData InObjectData)
 {
-    FBufferArchive BinaryData;
-    BinaryData << InObjectData;
-    
-    return SaveArchiveToDisk(InFileName, BinaryData);
+    return SaveRecordToDisk(InFileName, InObjectData, false);
 }
 
 bool UNumbskullSerializationBPLibrary::LoadObjectDataFromDisk(const FString& InFileName, FObjectData& OutObjectData)
 {
-    TArray<uint8> Bytes;
-    
-    if (!LoadBytesFromDisk(InFileName, Bytes))
-    {
-        return false;
-    }
-    
-    FMemoryReader FromBinary = FMemoryReader(Bytes, true);
-    FromBinary.Seek(0);
-    
-    FObjectData ObjectData;
-    FromBinary << ObjectData;
-    
-    OutObjectData = ObjectData;
-    
-    return true;
+    return LoadRecordFromDisk(InFileName, OutObjectData, false);
 }
 
 bool UNumbskullSerializationBPLibrary::SaveObjectDataToDiskCompressed(const FString& InFileName, FObjectData InObjectData)
 {
-    FBufferArchive BinaryData;
-    BinaryData << InObjectData;
-    
-    return SaveArchiveToDiskCompressed(InFileName, BinaryData);
+    return SaveRecordToDisk(InFileName, InObjectData, true);
 }
 
 bool UNumbskullSerializationBPLibrary::LoadObjectDataFromDiskCompressed(const FString& InFileName, FObjectData& OutObjectData)
 {
-    TArray<uint8> Bytes;
-    
-    LoadBytesFromDisk(InFileName, Bytes);
-    
-    FArchiveLoadCompressedProxy Decompressor =
-    FArchiveLoadCompressedProxy(Bytes, NAME_Zlib);
-    
-    if(Decompressor.GetError())
-    {
-        UE_LOG(Serializer, Error, TEXT("FArchiveLoadCompressedProxy>> ERROR : File Was Not Compressed"));
-        return false;
-    }
-    
-    FBufferArchive DecompressedBinaryArray;
-    Decompressor << DecompressedBinaryArray;
-    
-    FMemoryReader FromBinary = FMemoryReader(DecompressedBinaryArray, true);
-    FromBinary.Seek(0);
-    
-    FObjectData ObjectData;
-    FromBinary << ObjectData;
-    
-    OutObjectData = ObjectData;
-    
-    return true;
+    return LoadRecordFromDisk(InFileName, OutObjectData, true);
 }
 
 //
@@ -457,7 +1149,7 @@ bool UNumbskullSerializationBPLibrary::SaveActorData(AActor* InActorToSave, FAct
 {
     FActorData ActorData;
     
-    Serialize(ActorData.Data, InActorToSave);
+    SerializeActor(ActorData.Data.GetMutable(), InActorToSave, nullptr, &ActorData.BulkData);
     ActorData.Transform = InActorToSave->GetTransform();
     
     OutActorData = ActorData;
@@ -467,7 +1159,7 @@ bool UNumbskullSerializationBPLibrary::SaveActorData(AActor* InActorToSave, FAct
 
 bool UNumbskullSerializationBPLibrary::LoadActorData(AActor* InActorToLoad, const FActorData& InActorData)
 {
-    if (ApplySerialization(InActorData.Data, InActorToLoad))
+    if (ApplySerialization(InActorData.Data.GetData(), InActorData.Data.Num(), InActorToLoad, &InActorData.BulkData))
     {
         InActorToLoad->SetActorTransform(InActorData.Transform);
         return true;
@@ -477,65 +1169,278 @@ bool UNumbskullSerializationBPLibrary::LoadActorData(AActor* InActorToLoad, cons
 
 bool UNumbskullSerializationBPLibrary::SaveActorDataToDisk(const FString& InFileName, FActorData InActorData)
 {
-    FBufferArchive BinaryData;
-    BinaryData << InActorData;
-    
-    return SaveArchiveToDisk(InFileName, BinaryData);
+    return SaveRecordToDisk(InFileName, InActorData, false);
 }
 
 bool UNumbskullSerializationBPLibrary::LoadActorDataFromDisk(const FString& InFileName, FActorData& OutActorData)
 {
-    TArray<uint8> Bytes;
+    return LoadRecordFromDisk(InFileName, OutActorData, false);
+}
+
+bool UNumbskullSerializationBPLibrary::SaveActorDataToDiskCompressed(const FString& InFileName, FActorData InActorData)
+{
+    return SaveRecordToDisk(InFileName, InActorData, true);
+}
+
+bool UNumbskullSerializationBPLibrary::LoadActorDataFromDiskCompressed(const FString& InFileName, FActorData& OutActorData)
+{
+    return LoadRecordFromDisk(InFileName, OutActorData, true);
+}
+
+//
+// PAYLOADS
+//
+
+TArray<uint8> UNumbskullSerializationBPLibrary::GetPayloadBytes(const FNumbskullPayload& InPayload)
+{
+    return InPayload.Get();
+}
+
+int32 UNumbskullSerializationBPLibrary::GetPayloadSize(const FNumbskullPayload& InPayload)
+{
+    return InPayload.Num();
+}
+
+FNumbskullPayload UNumbskullSerializationBPLibrary::MakePayload(const TArray<uint8>& InBytes)
+{
+    return FNumbskullPayload(InBytes);
+}
+
+//
+// LOAD CACHE
+//
+
+FNumbskullLoadCacheStats UNumbskullSerializationBPLibrary::GetLoadCacheStats()
+{
+    return FNumbskullLoadCache::Get().GetStats();
+}
+
+void UNumbskullSerializationBPLibrary::ResetLoadCacheStats()
+{
+    FNumbskullLoadCache::Get().ResetStats();
+}
+
+void UNumbskullSerializationBPLibrary::ClearLoadCache()
+{
+    FNumbskullLoadCache::Get().Empty();
+}
+
+//
+// READING PROPERTIES
+//
+
+bool UNumbskullSerializationBPLibrary::ReadObjectDataProperties(const FObjectData& InObjectData, UClass* InClass, const TArray<FName>& InPropertyNames, TMap<FName, FString>& OutValues, int32 InObjectIndex)
+{
+    return InObjectData.PropertyIndex.ReadPropertiesAsText(InObjectData.Data, InObjectData.References, InObjectIndex, InClass, InPropertyNames, OutValues);
+}
+
+bool UNumbskullSerializationBPLibrary::ReadActorProxyProperties(const FActorProxy& InActorProxy, const TArray<FName>& InPropertyNames, TMap<FName, FString>& OutValues)
+{
+    UClass* ActorClass = FindActorClass(InActorProxy.ActorClass);
+    
+    if (!ActorClass)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Couldn't read properties because the class couldn't be found"));
+        return false;
+    }
+    
+    // Actor proxies store references as paths
+    return InActorProxy.PropertyIndex.ReadPropertiesAsText(InActorProxy.ActorData, FNumbskullReferenceTable(), 0, ActorClass, InPropertyNames, OutValues);
+}
+
+//
+// BATCH LOADING
+//
+
+bool UNumbskullSerializationBPLibrary::LoadObjectDataBatchFromDisk(const TArray<FString>& InFileNames, TArray<FObjectData>& OutObjectData, TArray<bool>& OutLoaded, bool bCompressed)
+{
+    return LoadRecordsFromDisk(InFileNames, OutObjectData, OutLoaded, bCompressed);
+}
+
+bool UNumbskullSerializationBPLibrary::LoadActorDataBatchFromDisk(const TArray<FString>& InFileNames, TArray<FActorData>& OutActorData, TArray<bool>& OutLoaded, bool bCompressed)
+{
+    return LoadRecordsFromDisk(InFileNames, OutActorData, OutLoaded, bCompressed);
+}
+
+bool UNumbskullSerializationBPLibrary::LoadActorProxyBatchFromDisk(const TArray<FString>& InFileNames, TArray<FActorProxy>& OutActorProxies, TArray<bool>& OutLoaded, bool bCompressed)
+{
+    return LoadRecordsFromDisk(InFileNames, OutActorProxies, OutLoaded, bCompressed);
+}
+
+//
+// STRUCT ARRAYS
+//
+
+bool UNumbskullSerializationBPLibrary::SaveStructArray(const UScriptStruct* InStruct, const void* InElements, int32 InNum, FObjectData& OutObjectData)
+{
+    return FNumbskullStructArray::Save(InStruct, InElements, InNum, OutObjectData);
+}
+
+bool UNumbskullSerializationBPLibrary::LoadStructArray(const FObjectData& InObjectData, const UScriptStruct* InStruct, void* OutElements, int32 InCapacity, int32& OutNum)
+{
+    return FNumbskullStructArray::Load(InObjectData, InStruct, OutElements, InCapacity, OutNum);
+}
+
+bool UNumbskullSerializationBPLibrary::GetStructArrayNum(const FObjectData& InObjectData, int32& OutNum)
+{
+    return FNumbskullStructArray::GetNum(InObjectData, OutNum);
+}
+
+//
+// NEW GAME
+//
+
+bool UNumbskullSerializationBPLibrary::StartNewGame(const UObject* WorldContextObject)
+{
+    UWorld* const World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
     
-    if (!LoadBytesFromDisk(InFileName, Bytes))
+    if (!World)
     {
         return false;
     }
     
-    FMemoryReader FromBinary = FMemoryReader(Bytes, true);
-    FromBinary.Seek(0);
+    TArray<UObject*> Listeners;
+    GetNewGameListeners(World, Listeners);
     
-    FActorData ActorData;
-    FromBinary << ActorData;
+    FNewGameSnapshot Snapshot;
+    const FString FileName = FNewGameSnapshot::GetFileName(GetNewGamePath(World->GetOutermost()));
+    
+    TMap<FString, const FNewGameSnapshotObject*> BakedObjects;
+    
+    if (IFileManager::Get().FileExists(*FileName) && LoadRecordFromDisk(FileName, Snapshot, false))
+    {
+        for (const FNewGameSnapshotObject& Object : Snapshot.Objects)
+        {
+            BakedObjects.Add(Object.ObjectPath, &Object);
+        }
+    }
+    
+    // Baked state goes first, so setup that still runs sees the rest of the new game
+    TArray<UObject*> UnbakedListeners;
+    
+    for (UObject* Listener : Listeners)
+    {
+        const FNewGameSnapshotObject* const* Object = BakedObjects.Find(GetNewGamePath(Listener));
         
-    OutActorData = ActorData;
+        const bool bBaked = Object
+            && (*Object)->ClassPath == Listener->GetClass()->GetPathName()
+            && INewGameListener::Execute_CanBakeNewGame(Listener)
+            && ApplySerialization((*Object)->Data.GetData(), (*Object)->Data.Num(), Listener);
+        
+        if (!bBaked)
+        {
+            UnbakedListeners.Add(Listener);
+        }
+    }
+    
+    for (UObject* Listener : UnbakedListeners)
+    {
+        INewGameListener::Execute_OnNewGame(Listener);
+    }
+    
+    UE_LOG(Serializer, Log, TEXT("New game applied baked state to %d of %d listeners"), Listeners.Num() - UnbakedListeners.Num(), Listeners.Num());
     
     return true;
 }
 
-bool UNumbskullSerializationBPLibrary::SaveActorDataToDiskCompressed(const FString& InFileName, FActorData InActorData)
+bool UNumbskullSerializationBPLibrary::BakeNewGame(const UObject* WorldContextObject)
 {
-    FBufferArchive BinaryData;
-    BinaryData << InActorData;
+    UWorld* const World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
     
-    return SaveArchiveToDiskCompressed(InFileName, BinaryData);
-}
-
-bool UNumbskullSerializationBPLibrary::LoadActorDataFromDiskCompressed(const FString& InFileName, FActorData& OutActorData)
-{
-    TArray<uint8> Bytes;
+    if (!World)
+    {
+        return false;
+    }
+    
+    // References to other objects would be saved with the play in editor prefix and not found in a packaged game
+    if (World->IsPlayInEditor())
+    {
+        UE_LOG(Serializer, Error, TEXT("New games can't be baked in play in editor. Run the map as a standalone game"));
+        return false;
+    }
     
-    LoadBytesFromDisk(InFileName, Bytes);
+    TArray<UObject*> Listeners;
+    GetNewGameListeners(World, Listeners);
     
-    FArchiveLoadCompressedProxy Decompressor =
-    FArchiveLoadCompressedProxy(Bytes, NAME_Zlib);
+    Listeners.RemoveAll([](const UObject* Listener) { return !INewGameListener::Execute_CanBakeNewGame(Listener); });
     
-    if(Decompressor.GetError())
+    for (UObject* Listener : Listeners)
     {
-        UE_LOG(Serializer, Error, TEXT("FArchiveLoadCompressedProxy>> ERROR : File Was Not Compressed"));
-        return false;
+        INewGameListener::Execute_OnNewGame(Listener);
     }
     
-    FBufferArchive DecompressedBinaryArray;
-    Decompressor << DecompressedBinaryArray;
+    FNewGameSnapshot Snapshot;
+    Snapshot.MapName = GetNewGamePath(World->GetOutermost());
     
-    FMemoryReader FromBinary = FMemoryReader(DecompressedBinaryArray, true);
-    FromBinary.Seek(0);
+    // Captured once every listener has been set up, since setting one up can change another
+    for (UObject* Listener : Listeners)
+    {
+        FNewGameSnapshotObject& Object = Snapshot.Objects.AddDefaulted_GetRef();
+        Object.ObjectPath = GetNewGamePath(Listener);
+        Object.ClassPath = Listener->GetClass()->GetPathName();
+        
+        TArray<uint8> Bytes;
+        if (!Serialize(Bytes, Listener))
+        {
+            UE_LOG(Serializer, Error, TEXT("Couldn't bake the new game of {%s}"), *Object.ObjectPath);
+            return false;
+        }
+        
+        Object.Data = MoveTemp(Bytes);
+    }
     
-    FActorData ActorData;
-    FromBinary << ActorData;
+    if (Snapshot.Objects.Num() == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Nothing to bake. No new game listener in {%s} can be baked"), *Snapshot.MapName);
+        return false;
+    }
     
-    OutActorData = ActorData;
+    const FString FileName = FNewGameSnapshot::GetFileName(Snapshot.MapName);
+    
+    if (!SaveRecordToDisk(FileName, Snapshot, true))
+    {
+        return false;
+    }
+    
+    UE_LOG(Serializer, Display, TEXT("Baked the new game of %d listeners in {%s} to {%s}"), Snapshot.Objects.Num(), *Snapshot.MapName, *FileName);
     
     return true;
 }
+
+//
+// SIZE REPORTS
+//
+
+bool UNumbskullSerializationBPLibrary::GetObjectsSizeReport(const TArray<UObject*>& InObjects, FNumbskullSizeReport& OutReport)
+{
+    return FNumbskullSizeReport::FromObjects(InObjects, OutReport);
+}
+
+bool UNumbskullSerializationBPLibrary::GetSaveFileSizeReport(const FString& InFileName, ENumbskullStorageType InType, FNumbskullSizeReport& OutReport)
+{
+    return FNumbskullSizeReport::FromFile(InFileName, InType, OutReport);
+}
+
+bool UNumbskullSerializationBPLibrary::SaveSizeReportToCsv(const FNumbskullSizeReport& InReport, const FString& InFileName)
+{
+    return InReport.SaveToCsv(InFileName);
+}
+
+//
+// SLOT ROTATION
+//
+
+bool UNumbskullSerializationBPLibrary::SaveBytesToSlot(const FString& InFileName, const TArray<uint8>& InBytes, int32 InNumBackups)
+{
+    return FNumbskullSlotRotation::Save(InFileName, InBytes, InNumBackups);
+}
+
+bool UNumbskullSerializationBPLibrary::RestoreSlotBackup(const FString& InFileName, int32 InVersion)
+{
+    return FNumbskullSlotRotation::Restore(InFileName, InVersion);
+}
+
+void UNumbskullSerializationBPLibrary::GetSlotBackupVersions(const FString& InFileName, TArray<int32>& OutVersions)
+{
+    OutVersions = FNumbskullSlotRotation::GetBackupVersions(InFileName);
+}
@@ -0,0 +1,18 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullSerializationSettings.h"
+
+#include "Misc/CompressionFlags.h"
+
+uint32 UNumbskullSerializationSettings::GetCompressionFlags(ENumbskullCompressionBias InBias)
+{
+    switch (InBias)
+    {
+    case ENumbskullCompressionBias::Speed:
+        return COMPRESS_BiasSpeed;
+    case ENumbskullCompressionBias::Size:
+        return COMPRESS_BiasMemory;
+    default:
+        return COMPRESS_None;
+    }
+}
@@ -0,0 +1,111 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullSerializerBenchmark.h"
+#include "NumbskullArchive.h"
+#include "NumbskullNativeSerializer.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+NUMBSKULL_SERIALIZER_FIELDS(FNumbskullBenchmarkStats,
+    NUMBSKULL_FIELD(FNumbskullBenchmarkStats, Level),
+    NUMBSKULL_FIELD(FNumbskullBenchmarkStats, Health),
+    NUMBSKULL_FIELD(FNumbskullBenchmarkStats, Mana),
+    NUMBSKULL_FIELD(FNumbskullBenchmarkStats, Strength),
+    NUMBSKULL_FIELD(FNumbskullBenchmarkStats, Agility),
+    NUMBSKULL_FIELD(FNumbskullBenchmarkStats, Intellect),
+    NUMBSKULL_FIELD(FNumbskullBenchmarkStats, Title),
+    NUMBSKULL_FIELD(FNumbskullBenchmarkStats, Modifiers))
+
+namespace
+{
+    /**
+     * Numbskull.NativeSerializerBenchmark [NumElements]
+     *
+     * Writes and reads back an array of stat blocks through the library's archive with tagged properties, as objects are
+     * serialized, and then with TNumbskullSerializer.
+     */
+    void RunNativeSerializerBenchmark(const TArray<FString>& Args)
+    {
+        const int32 NumElements = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+
+        FRandomStream Random(NumElements);
+        TArray<FNumbskullBenchmarkStats> Stats;
+        Stats.SetNum(NumElements);
+
+        for (FNumbskullBenchmarkStats& Element : Stats)
+        {
+            Element.Level = Random.RandRange(1, 60);
+            Element.Health = Random.RandRange(100, 5000);
+            Element.Mana = Random.RandRange(0, 2000);
+            Element.Strength = Random.FRandRange(1.0f, 100.0f);
+            Element.Agility = Random.FRandRange(1.0f, 100.0f);
+            Element.Intellect = Random.FRandRange(1.0f, 100.0f);
+            Element.Title = FString::Printf(TEXT("Title%d"), Random.RandRange(0, 31));
+
+            for (int32 Index = Random.RandRange(0, 4); Index > 0; --Index)
+            {
+                Element.Modifiers.Add(Random.RandRange(0, 255));
+            }
+        }
+
+        UScriptStruct* Struct = FNumbskullBenchmarkStats::StaticStruct();
+
+        // Reflection, through the same archive objects are saved with
+        TArray<uint8> TaggedBytes;
+        double StartTime = FPlatformTime::Seconds();
+        {
+            FMemoryWriter Writer(TaggedBytes, true);
+            FNumbskullArchive Archive(Writer);
+
+            for (FNumbskullBenchmarkStats& Element : Stats)
+            {
+                Struct->SerializeItem(Archive, &Element, nullptr);
+            }
+        }
+        const double TaggedWriteSeconds = FPlatformTime::Seconds() - StartTime;
+
+        TArray<FNumbskullBenchmarkStats> TaggedLoaded;
+        TaggedLoaded.SetNum(NumElements);
+        StartTime = FPlatformTime::Seconds();
+        {
+            FMemoryReader Reader(TaggedBytes, true);
+            FNumbskullArchive Archive(Reader);
+
+            for (FNumbskullBenchmarkStats& Element : TaggedLoaded)
+            {
+                Struct->SerializeItem(Archive, &Element, nullptr);
+            }
+        }
+        const double TaggedReadSeconds = FPlatformTime::Seconds() - StartTime;
+
+        // Native
+        FObjectData NativeData;
+        StartTime = FPlatformTime::Seconds();
+        TNumbskullSerializer<FNumbskullBenchmarkStats>::SaveArray(Stats, NativeData);
+        const double NativeWriteSeconds = FPlatformTime::Seconds() - StartTime;
+
+        TArray<FNumbskullBenchmarkStats> NativeLoaded;
+        StartTime = FPlatformTime::Seconds();
+        const bool bNativeLoaded = TNumbskullSerializer<FNumbskullBenchmarkStats>::LoadArray(NativeData, NativeLoaded);
+        const double NativeReadSeconds = FPlatformTime::Seconds() - StartTime;
+
+        bool bMatches = bNativeLoaded && NativeLoaded.Num() == NumElements;
+        for (int32 Index = 0; bMatches && Index < NumElements; ++Index)
+        {
+            bMatches = Struct->CompareScriptStruct(&Stats[Index], &NativeLoaded[Index], 0) && Struct->CompareScriptStruct(&Stats[Index], &TaggedLoaded[Index], 0);
+        }
+
+        UE_LOG(Serializer, Display, TEXT("Native serializer benchmark: %d stat blocks, results %s"), NumElements, bMatches ? TEXT("match") : TEXT("DON'T MATCH"));
+        UE_LOG(Serializer, Display, TEXT("Reflection: %d bytes, %.2fms to write, %.2fms to read"), TaggedBytes.Num(), TaggedWriteSeconds * 1000.0, TaggedReadSeconds * 1000.0);
+        UE_LOG(Serializer, Display, TEXT("Native: %d bytes, %.2fms to write, %.2fms to read"), NativeData.Data.Num(), NativeWriteSeconds * 1000.0, NativeReadSeconds * 1000.0);
+        UE_LOG(Serializer, Display, TEXT("Native is %.1fx faster to write and %.1fx faster to read"),
+            TaggedWriteSeconds / FMath::Max(NativeWriteSeconds, SMALL_NUMBER), TaggedReadSeconds / FMath::Max(NativeReadSeconds, SMALL_NUMBER));
+    }
+
+    FAutoConsoleCommand NativeSerializerBenchmarkCommand(
+        TEXT("Numbskull.NativeSerializerBenchmark"),
+        TEXT("Compares serializing stat blocks through reflection with TNumbskullSerializer. Arguments: [NumElements=100000]"),
+        FConsoleCommandWithArgsDelegate::CreateStatic(&RunNativeSerializerBenchmark));
+}
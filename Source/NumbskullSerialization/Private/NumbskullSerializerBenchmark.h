@@ -0,0 +1,39 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NumbskullSerializerBenchmark.generated.h"
+
+/**
+ * A stat block, roughly what games save per character. Serialized through reflection and TNumbskullSerializer to compare them.
+ */
+USTRUCT()
+struct FNumbskullBenchmarkStats
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    int32 Level = 0;
+
+    UPROPERTY()
+    int32 Health = 0;
+
+    UPROPERTY()
+    int32 Mana = 0;
+
+    UPROPERTY()
+    float Strength = 0.0f;
+
+    UPROPERTY()
+    float Agility = 0.0f;
+
+    UPROPERTY()
+    float Intellect = 0.0f;
+
+    UPROPERTY()
+    FString Title;
+
+    UPROPERTY()
+    TArray<int32> Modifiers;
+};
@@ -0,0 +1,589 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullSizeReport.h"
+#include "ActorData.h"
+#include "ActorProxy.h"
+#include "ActorProxyBatch.h"
+#include "ObjectData.h"
+#include "NumbskullArchive.h"
+#include "NumbskullFileHeader.h"
+#include "NumbskullSerializationBPLibrary.h"
+#include "NumbskullVarInt.h"
+#include "Serializable.h"
+
+#include "Async/ParallelFor.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/BufferReader.h"
+#include "Serialization/MemoryReader.h"
+#include "UObject/PropertyTag.h"
+
+namespace
+{
+    const TCHAR* NativeRowName = TEXT("(native)");
+    const TCHAR* UnparsedRowName = TEXT("(unparsed)");
+    const TCHAR* UnknownClassName = TEXT("(unknown)");
+    const TCHAR* MetadataClassName = TEXT("(metadata)");
+
+    const TCHAR* GetKindName(ENumbskullSizeReportKind InKind)
+    {
+        switch (InKind)
+        {
+        case ENumbskullSizeReportKind::Class:
+            return TEXT("Class");
+        case ENumbskullSizeReportKind::Object:
+            return TEXT("Object");
+        case ENumbskullSizeReportKind::Property:
+            return TEXT("Property");
+        }
+        return TEXT("");
+    }
+
+    /** A row and the bytes charged to it, compressed once everything has been charged*/
+    struct FSizedRow
+    {
+        FNumbskullSizeReportRow Row;
+
+        TArray<uint8> Bytes;
+    };
+
+    /**
+     * Charges serialized objects to rows, one object at a time.
+     */
+    class FSizeReportBuilder
+    {
+    public:
+
+        FSizeReportBuilder(FName InCompressionFormat, uint32 InCompressionFlags)
+            : CompressionFormat(InCompressionFormat)
+            , CompressionFlags(InCompressionFlags)
+        {
+        }
+
+        /** Charges an object's data, decoding it first if it's compact*/
+        void AddObject(const FString& InName, const FString& InClass, const uint8* InData, int32 InNumBytes)
+        {
+            if (InNumBytes <= 0)
+            {
+                return;
+            }
+
+            TArray<uint8> DecodedData;
+            bool bDecoded = true;
+
+            if (FNumbskullVarInt::IsEncoded(InData, InNumBytes))
+            {
+                bDecoded = FNumbskullVarInt::Decode(InData, InNumBytes, DecodedData);
+
+                if (bDecoded)
+                {
+                    InData = DecodedData.GetData();
+                    InNumBytes = DecodedData.Num();
+                }
+                else
+                {
+                    UE_LOG(Serializer, Warning, TEXT("Couldn't decode compact serialized data of %s"), *InName);
+                }
+            }
+
+            AllBytes.Append(InData, InNumBytes);
+            AddBytes(ENumbskullSizeReportKind::Object, InName, InClass, InData, InNumBytes);
+            AddBytes(ENumbskullSizeReportKind::Class, InClass, InClass, InData, InNumBytes);
+
+            if (bDecoded)
+            {
+                AddProperties(InClass, InData, InNumBytes);
+            }
+            else
+            {
+                AddBytes(ENumbskullSizeReportKind::Property, UnparsedRowName, InClass, InData, InNumBytes);
+            }
+        }
+
+        /** Charges bytes that aren't part of any object, such as the rest of a record*/
+        void AddMetadata(int64 InNumBytes)
+        {
+            if (InNumBytes > 0)
+            {
+                FSizedRow& Row = FindOrAddRow(ENumbskullSizeReportKind::Class, MetadataClassName, MetadataClassName);
+                Row.Row.Count = 1;
+                Row.Row.RawBytes += InNumBytes;
+                MetadataBytes += InNumBytes;
+            }
+        }
+
+        void Finish(FNumbskullSizeReport& OutReport)
+        {
+            const bool bCompress = !CompressionFormat.IsNone();
+
+            // Every row compresses on its own. Metadata keeps no bytes and is counted as it is
+            ParallelFor(Rows.Num(), [&](int32 Index)
+            {
+                FSizedRow& Row = Rows[Index];
+                Row.Row.CompressedBytes = bCompress && Row.Bytes.Num() > 0 ? Compress(Row.Bytes) : Row.Row.RawBytes;
+            });
+
+            OutReport.Rows.Reset(Rows.Num());
+            for (FSizedRow& Row : Rows)
+            {
+                OutReport.Rows.Add(Row.Row);
+            }
+
+            OutReport.Rows.Sort([](const FNumbskullSizeReportRow& A, const FNumbskullSizeReportRow& B)
+            {
+                return A.RawBytes != B.RawBytes ? A.RawBytes > B.RawBytes : A.Name < B.Name;
+            });
+
+            OutReport.TotalRawBytes = AllBytes.Num() + MetadataBytes;
+            OutReport.TotalCompressedBytes = (bCompress ? Compress(AllBytes) : AllBytes.Num()) + MetadataBytes;
+            OutReport.CompressionFormat = CompressionFormat;
+        }
+
+    private:
+
+        /** Splits an object's data at its property tags, as FNumbskullPropertyIndex does*/
+        void AddProperties(const FString& InClass, const uint8* InData, int32 InNumBytes)
+        {
+            FBufferReader Reader(const_cast<uint8*>(InData), InNumBytes, false);
+            FNumbskullArchive Archive(Reader, false);
+
+            int64 PropertiesEnd = 0;
+            bool bTerminated = false;
+
+            while (true)
+            {
+                const int64 TagOffset = Reader.Tell();
+
+                FPropertyTag Tag;
+                Archive << Tag;
+
+                if (Archive.IsError())
+                {
+                    break;
+                }
+
+                if (Tag.Name.IsNone())
+                {
+                    bTerminated = true;
+                    break;
+                }
+
+                const int64 ValueEnd = Reader.Tell() + Tag.Size;
+                if (Tag.Size < 0 || ValueEnd > InNumBytes)
+                {
+                    break;
+                }
+
+                AddBytes(ENumbskullSizeReportKind::Property, Tag.Name.ToString(), InClass, InData + TagOffset, static_cast<int32>(ValueEnd - TagOffset));
+
+                PropertiesEnd = ValueEnd;
+                Reader.Seek(ValueEnd);
+            }
+
+            // The terminating tag and anything written after it
+            if (PropertiesEnd < InNumBytes)
+            {
+                AddBytes(ENumbskullSizeReportKind::Property, bTerminated ? NativeRowName : UnparsedRowName, InClass, InData + PropertiesEnd, InNumBytes - static_cast<int32>(PropertiesEnd));
+            }
+        }
+
+        void AddBytes(ENumbskullSizeReportKind InKind, const FString& InName, const FString& InClass, const uint8* InData, int32 InNumBytes)
+        {
+            FSizedRow& Row = FindOrAddRow(InKind, InName, InClass);
+            Row.Row.Count++;
+            Row.Row.RawBytes += InNumBytes;
+            Row.Bytes.Append(InData, InNumBytes);
+        }
+
+        FSizedRow& FindOrAddRow(ENumbskullSizeReportKind InKind, const FString& InName, const FString& InClass)
+        {
+            // Objects get a row each, even when names repeat
+            if (InKind != ENumbskullSizeReportKind::Object)
+            {
+                const FString Key = FString::Printf(TEXT("%s|%s|%s"), GetKindName(InKind), *InClass, *InName);
+
+                if (const int32* Index = RowLookup.Find(Key))
+                {
+                    return Rows[*Index];
+                }
+
+                RowLookup.Add(Key, Rows.Num());
+            }
+
+            FSizedRow& Row = Rows.AddDefaulted_GetRef();
+            Row.Row.Kind = InKind;
+            Row.Row.Name = InName;
+            Row.Row.Class = InClass;
+            return Row;
+        }
+
+        int64 Compress(const TArray<uint8>& InBytes) const
+        {
+            if (InBytes.Num() == 0)
+            {
+                return 0;
+            }
+
+            TArray<uint8> CompressedBytes;
+            UNumbskullSerializationBPLibrary::CompressBytes(InBytes, CompressedBytes, CompressionFormat, CompressionFlags);
+            return CompressedBytes.Num();
+        }
+
+        FName CompressionFormat;
+
+        uint32 CompressionFlags = 0;
+
+        TArray<FSizedRow> Rows;
+
+        TMap<FString, int32> RowLookup;
+
+        /** Every object's data, to compress together for the total*/
+        TArray<uint8> AllBytes;
+
+        int64 MetadataBytes = 0;
+    };
+
+    /** Reads a record out of a decoded payload, failing if there are bytes left over*/
+    template <typename RecordType>
+    bool ReadRecord(const FNumbskullFileHeader& InHeader, const TArray<uint8>& InPayload, RecordType& OutRecord)
+    {
+        FMemoryReader Reader(InPayload, true);
+        OutRecord.SerializeVersioned(Reader, InHeader);
+
+        return !Reader.IsError() && Reader.Tell() == Reader.TotalSize();
+    }
+
+    /** Charges the objects of object data, split where the property index says each one starts*/
+    void AddObjectData(FSizeReportBuilder& InBuilder, const FObjectData& InObjectData)
+    {
+        const FNumbskullPropertyIndex& Index = InObjectData.PropertyIndex;
+
+        TArray<uint8> DecodedData;
+        const TArray<uint8>* Data = &InObjectData.Data.Get();
+
+        if (Index.IsValid() && FNumbskullVarInt::IsEncoded(*Data))
+        {
+            if (!FNumbskullVarInt::Decode(Data->GetData(), Data->Num(), DecodedData))
+            {
+                InBuilder.AddObject(UnparsedRowName, UnknownClassName, Data->GetData(), Data->Num());
+                return;
+            }
+
+            Data = &DecodedData;
+        }
+
+        // Objects that serialized no properties can't be told apart from the one before
+        TArray<TPair<int32, int32>> Starts;
+        for (int32 Object = 0; Object < Index.NumObjects(); ++Object)
+        {
+            const int32 FirstProperty = Index.ObjectStarts[Object];
+            const int32 NextFirstProperty = Index.ObjectStarts.IsValidIndex(Object + 1) ? Index.ObjectStarts[Object + 1] : Index.Properties.Num();
+
+            if (FirstProperty < NextFirstProperty)
+            {
+                Starts.Emplace(Object, Index.Properties[FirstProperty].TagOffset);
+            }
+        }
+
+        if (Starts.Num() == 0)
+        {
+            InBuilder.AddObject(TEXT("Object 0"), UnknownClassName, Data->GetData(), Data->Num());
+            return;
+        }
+
+        // Anything before the first indexed object belongs to it
+        Starts[0].Value = 0;
+
+        for (int32 Start = 0; Start < Starts.Num(); ++Start)
+        {
+            const int32 Offset = Starts[Start].Value;
+            const int32 End = Starts.IsValidIndex(Start + 1) ? Starts[Start + 1].Value : Data->Num();
+
+            InBuilder.AddObject(FString::Printf(TEXT("Object %d"), Starts[Start].Key), UnknownClassName, Data->GetData() + Offset, End - Offset);
+        }
+    }
+
+    bool AddFile(FSizeReportBuilder& InBuilder, ENumbskullStorageType InType, const FNumbskullFileHeader& InHeader, const TArray<uint8>& InPayload)
+    {
+        int64 ObjectBytes = 0;
+
+        switch (InType)
+        {
+        case ENumbskullStorageType::ObjectData:
+        {
+            FObjectData ObjectData;
+            if (!ReadRecord(InHeader, InPayload, ObjectData))
+            {
+                return false;
+            }
+
+            AddObjectData(InBuilder, ObjectData);
+            ObjectBytes = ObjectData.Data.Num();
+            break;
+        }
+        case ENumbskullStorageType::ActorData:
+        {
+            FActorData ActorData;
+            if (!ReadRecord(InHeader, InPayload, ActorData))
+            {
+                return false;
+            }
+
+            InBuilder.AddObject(TEXT("Actor"), UnknownClassName, ActorData.Data.GetData(), ActorData.Data.Num());
+            ObjectBytes = ActorData.Data.Num();
+            break;
+        }
+        case ENumbskullStorageType::ActorProxy:
+        {
+            FActorProxy ActorProxy;
+            if (!ReadRecord(InHeader, InPayload, ActorProxy))
+            {
+                return false;
+            }
+
+            InBuilder.AddObject(ActorProxy.ActorName.ToString(), ActorProxy.ActorClass, ActorProxy.ActorData.GetData(), ActorProxy.ActorData.Num());
+            ObjectBytes = ActorProxy.ActorData.Num();
+            break;
+        }
+        case ENumbskullStorageType::ActorProxyBatch:
+        {
+            FActorProxyBatch Batch;
+            if (!ReadRecord(InHeader, InPayload, Batch) || !Batch.IsValid())
+            {
+                return false;
+            }
+
+            for (int32 Index = 0; Index < Batch.Num(); ++Index)
+            {
+                InBuilder.AddObject(Batch.Names[Index].ToString(), Batch.Classes[Batch.ClassIndices[Index]], Batch.GetData(Index), Batch.GetDataSize(Index));
+            }
+
+            ObjectBytes = Batch.Payload.Num();
+            break;
+        }
+        default:
+            return false;
+        }
+
+        InBuilder.AddMetadata(InPayload.Num() - ObjectBytes);
+        return true;
+    }
+}
+
+bool FNumbskullSizeReport::FromObjects(const TArray<UObject*>& InObjects, FNumbskullSizeReport& OutReport)
+{
+    OutReport = FNumbskullSizeReport();
+
+    const FNumbskullFileHeader Header = FNumbskullFileHeader::FromSettings();
+    FSizeReportBuilder Builder(Header.CompressionFormat, Header.CompressionFlags);
+
+    int32 NumObjects = 0;
+
+    for (UObject* Object : InObjects)
+    {
+        if (!Object || Object->IsPendingKill())
+        {
+            continue;
+        }
+
+        TArray<uint8> SerializedData;
+
+        if (AActor* Actor = Cast<AActor>(Object))
+        {
+            UNumbskullSerializationBPLibrary::SerializeActor(SerializedData, Actor);
+        }
+        else
+        {
+            UNumbskullSerializationBPLibrary::Serialize(SerializedData, Object);
+        }
+
+        Builder.AddObject(Object->GetName(), Object->GetClass()->GetPathName(), SerializedData.GetData(), SerializedData.Num());
+        ++NumObjects;
+    }
+
+    if (NumObjects == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("No objects to report the size of"));
+        return false;
+    }
+
+    Builder.Finish(OutReport);
+    return true;
+}
+
+bool FNumbskullSizeReport::FromFile(const FString& InFileName, ENumbskullStorageType InType, FNumbskullSizeReport& OutReport, bool bLegacyCompressed)
+{
+    OutReport = FNumbskullSizeReport();
+
+    TArray<uint8> FileBytes;
+    if (!UNumbskullSerializationBPLibrary::LoadBytesFromDisk(InFileName, FileBytes))
+    {
+        return false;
+    }
+
+    FNumbskullFileHeader Header;
+    TArray<uint8> Payload;
+
+    if (!UNumbskullSerializationBPLibrary::DecodeFile(FileBytes, bLegacyCompressed, Header, Payload))
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't decode file {%s}"), *InFileName);
+        return false;
+    }
+
+    // Uncompressed files are measured with the format they'd be compressed with now
+    const bool bCompressed = Header.IsLegacy() ? bLegacyCompressed : Header.HasFlag(ENumbskullFileFlags::Compressed);
+    const FNumbskullFileHeader Settings = FNumbskullFileHeader::FromSettings();
+
+    FSizeReportBuilder Builder(bCompressed ? Header.CompressionFormat : Settings.CompressionFormat, bCompressed ? Header.CompressionFlags : Settings.CompressionFlags);
+
+    if (!AddFile(Builder, InType, Header, Payload))
+    {
+        UE_LOG(Serializer, Error, TEXT("File {%s} isn't %s"), *InFileName, *StaticEnum<ENumbskullStorageType>()->GetNameStringByValue(static_cast<int64>(InType)));
+        return false;
+    }
+
+    Builder.Finish(OutReport);
+    OutReport.FileBytes = FileBytes.Num();
+    return true;
+}
+
+FString FNumbskullSizeReport::ToCsv() const
+{
+    TArray<FString> Lines;
+    Lines.Reserve(Rows.Num() + 1);
+    Lines.Add(TEXT("Kind,Name,Class,Count,RawBytes,CompressedBytes"));
+
+    for (const FNumbskullSizeReportRow& Row : Rows)
+    {
+        Lines.Add(FString::Printf(TEXT("%s,\"%s\",\"%s\",%d,%lld,%lld"),
+            GetKindName(Row.Kind), *Row.Name.Replace(TEXT("\""), TEXT("\"\"")), *Row.Class.Replace(TEXT("\""), TEXT("\"\"")),
+            Row.Count, Row.RawBytes, Row.CompressedBytes));
+    }
+
+    return FString::Join(Lines, TEXT("\n")) + TEXT("\n");
+}
+
+bool FNumbskullSizeReport::SaveToCsv(const FString& InFileName) const
+{
+    if (!FFileHelper::SaveStringToFile(ToCsv(), *InFileName))
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't write size report {%s}"), *InFileName);
+        return false;
+    }
+
+    return true;
+}
+
+void FNumbskullSizeReport::Log(int32 InMaxRows) const
+{
+    UE_LOG(Serializer, Display, TEXT("Size report: %lld bytes raw, %lld bytes compressed with %s, %lld bytes on disk"),
+        TotalRawBytes, TotalCompressedBytes, *CompressionFormat.ToString(), FileBytes);
+
+    UE_LOG(Serializer, Display, TEXT("%-8s %12s %12s %8s  %s"), TEXT("Kind"), TEXT("Raw"), TEXT("Compressed"), TEXT("Count"), TEXT("Name"));
+
+    const int32 NumRows = InMaxRows > 0 ? FMath::Min(InMaxRows, Rows.Num()) : Rows.Num();
+
+    for (int32 Index = 0; Index < NumRows; ++Index)
+    {
+        const FNumbskullSizeReportRow& Row = Rows[Index];
+
+        // Objects and properties are only meaningful with their class
+        const FString Name = Row.Kind == ENumbskullSizeReportKind::Class ? Row.Name : FString::Printf(TEXT("%s (%s)"), *Row.Name, *Row.Class);
+
+        UE_LOG(Serializer, Display, TEXT("%-8s %12lld %12lld %8d  %s"), GetKindName(Row.Kind), Row.RawBytes, Row.CompressedBytes, Row.Count, *Name);
+    }
+
+    if (NumRows < Rows.Num())
+    {
+        UE_LOG(Serializer, Display, TEXT("... %d more rows"), Rows.Num() - NumRows);
+    }
+}
+
+namespace
+{
+    /**
+     * Numbskull.SizeReport [File] [Type] [Csv=Path]
+     *
+     * Reports the size of a save file of the given storage type (ObjectData by default), or of every serializable actor in
+     * the world as it would be saved now when no file is given.
+     */
+    void RunSizeReport(const TArray<FString>& InArgs, UWorld* InWorld)
+    {
+        FString FileName;
+        FString TypeName = TEXT("ObjectData");
+        FString CsvFileName;
+        int32 NumPositional = 0;
+
+        for (const FString& Arg : InArgs)
+        {
+            if (Arg.StartsWith(TEXT("Csv=")))
+            {
+                CsvFileName = Arg.RightChop(4);
+            }
+            else if (NumPositional++ == 0)
+            {
+                FileName = Arg;
+            }
+            else
+            {
+                TypeName = Arg;
+            }
+        }
+
+        FNumbskullSizeReport Report;
+
+        if (FileName.IsEmpty())
+        {
+            if (!InWorld)
+            {
+                UE_LOG(Serializer, Error, TEXT("There's no world to report the actors of. Pass a file instead"));
+                return;
+            }
+
+            TArray<UObject*> Actors;
+
+            for (TActorIterator<AActor> It(InWorld); It; ++It)
+            {
+                if (It->GetClass()->ImplementsInterface(USerializable::StaticClass()))
+                {
+                    Actors.Add(*It);
+                }
+            }
+
+            if (!FNumbskullSizeReport::FromObjects(Actors, Report))
+            {
+                return;
+            }
+        }
+        else
+        {
+            const UEnum* TypeEnum = StaticEnum<ENumbskullStorageType>();
+            const int64 Type = TypeEnum->GetValueByNameString(TypeName);
+
+            if (Type == INDEX_NONE)
+            {
+                UE_LOG(Serializer, Error, TEXT("Unknown type %s. Use ObjectData, ActorData, ActorProxy or ActorProxyBatch"), *TypeName);
+                return;
+            }
+
+            if (!FNumbskullSizeReport::FromFile(FileName, static_cast<ENumbskullStorageType>(Type), Report))
+            {
+                return;
+            }
+        }
+
+        Report.Log();
+
+        if (!CsvFileName.IsEmpty())
+        {
+            Report.SaveToCsv(CsvFileName);
+        }
+    }
+
+    FAutoConsoleCommandWithWorldAndArgs SizeReportCommand(
+        TEXT("Numbskull.SizeReport"),
+        TEXT("Reports the bytes of a save by class, object and property. Arguments: [File] [Type=ObjectData] [Csv=Path]. Without a file, reports every serializable actor in the world"),
+        FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunSizeReport));
+}
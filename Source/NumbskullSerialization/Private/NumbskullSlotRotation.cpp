@@ -0,0 +1,326 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullSlotRotation.h"
+#include "NumbskullSerializationBPLibrary.h"
+#include "NumbskullLoadCache.h"
+#include "NumbskullBulkData.h"
+
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Paths.h"
+
+#if PLATFORM_LINUX || PLATFORM_MAC
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+#if PLATFORM_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+// Kernel headers older than 4.5 don't have it, but the kernel running the game may still support it
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+
+#if PLATFORM_MAC
+#include <sys/clonefile.h>
+#endif
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#endif
+
+namespace
+{
+    /** Path the operating system knows a file by, for calls that don't go through the file manager*/
+    FString GetPlatformPath(const FString& InFileName, bool bForWrite)
+    {
+        return bForWrite
+            ? IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*InFileName)
+            : IFileManager::Get().ConvertToAbsolutePathForExternalAppForRead(*InFileName);
+    }
+
+    /** Streams a file into a new backup, through a temporary file so a half written backup never takes its place*/
+    bool CopyToBackup(const FString& InFileName, const FString& InBackupFileName)
+    {
+        const FString TempFileName = InBackupFileName + TEXT(".tmp");
+
+        if (IFileManager::Get().Copy(*TempFileName, *InFileName, true, true) != COPY_OK
+            || !IFileManager::Get().Move(*InBackupFileName, *TempFileName, true, true))
+        {
+            IFileManager::Get().Delete(*TempFileName, false, false, true);
+            return false;
+        }
+
+        return true;
+    }
+}
+
+bool FNumbskullSlotRotation::Save(const FString& InFileName, const TArray<uint8>& InBytes, int32 InNumBackups)
+{
+    if (InBytes.Num() == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("No bytes to save to slot {%s}"), *InFileName);
+        return false;
+    }
+
+    IFileManager& FileManager = IFileManager::Get();
+
+    const FString TempFileName = InFileName + TEXT(".tmp");
+    const bool bBackup = InNumBackups > 0 && FileManager.FileExists(*InFileName);
+
+    RotateBackups(InFileName, FMath::Max(InNumBackups, 0));
+
+    // Only a copy takes time, and it's made while the new data is written
+    TFuture<bool> Copy;
+
+    if (bBackup)
+    {
+        const FString BackupFileName = GetBackupFileName(InFileName, 1);
+
+        if (CloneFile(InFileName, BackupFileName))
+        {
+            UE_LOG(Serializer, Verbose, TEXT("Backed up {%s} by cloning it"), *InFileName);
+        }
+        else if (LinkFile(InFileName, BackupFileName))
+        {
+            UE_LOG(Serializer, Verbose, TEXT("Backed up {%s} by linking it"), *InFileName);
+        }
+        else
+        {
+            Copy = Async(EAsyncExecution::ThreadPool, [InFileName, BackupFileName]()
+            {
+                return CopyToBackup(InFileName, BackupFileName);
+            });
+        }
+    }
+
+    bool bWritten = WriteFileFlushed(TempFileName, InBytes);
+
+    // The slot can't be replaced until the copy has read all of it
+    if (Copy.IsValid() && !Copy.Get())
+    {
+        UE_LOG(Serializer, Warning, TEXT("Couldn't back up {%s}. Saving without a backup"), *InFileName);
+    }
+
+    if (bWritten)
+    {
+        FNumbskullBulkData::DetachFile(InFileName);
+    }
+
+    bWritten = bWritten && ReplaceFile(TempFileName, InFileName);
+
+    FNumbskullLoadCache::Get().Invalidate(TempFileName);
+    FNumbskullLoadCache::Get().Invalidate(InFileName);
+
+    if (!bWritten)
+    {
+        FileManager.Delete(*TempFileName, false, false, true);
+        UE_LOG(Serializer, Error, TEXT("Couldn't save slot {%s}"), *InFileName);
+        return false;
+    }
+
+    UE_LOG(Serializer, Log, TEXT("Save Data To Slot {%s} Successful"), *InFileName);
+    return true;
+}
+
+bool FNumbskullSlotRotation::Restore(const FString& InFileName, int32 InVersion)
+{
+    const FString BackupFileName = GetBackupFileName(InFileName, InVersion);
+
+    if (InVersion < 1 || !IFileManager::Get().FileExists(*BackupFileName))
+    {
+        UE_LOG(Serializer, Error, TEXT("Slot {%s} has no backup %d to restore"), *InFileName, InVersion);
+        return false;
+    }
+
+    // Linking would let the next in place write to the slot change the backup too
+    const FString TempFileName = InFileName + TEXT(".tmp");
+
+    FNumbskullBulkData::DetachFile(InFileName);
+
+    const bool bRestored = (CloneFile(BackupFileName, TempFileName) || IFileManager::Get().Copy(*TempFileName, *BackupFileName, true, true) == COPY_OK)
+        && ReplaceFile(TempFileName, InFileName);
+
+    FNumbskullLoadCache::Get().Invalidate(InFileName);
+
+    if (!bRestored)
+    {
+        IFileManager::Get().Delete(*TempFileName, false, false, true);
+        UE_LOG(Serializer, Error, TEXT("Couldn't restore slot {%s} from backup %d"), *InFileName, InVersion);
+        return false;
+    }
+
+    UE_LOG(Serializer, Log, TEXT("Restored slot {%s} from backup %d"), *InFileName, InVersion);
+    return true;
+}
+
+TArray<int32> FNumbskullSlotRotation::GetBackupVersions(const FString& InFileName)
+{
+    const FString Prefix = FPaths::GetCleanFilename(InFileName) + TEXT(".bak");
+
+    TArray<FString> Found;
+    IFileManager::Get().FindFiles(Found, *(InFileName + TEXT(".bak*")), true, false);
+
+    TArray<int32> Versions;
+
+    for (const FString& File : Found)
+    {
+        const FString Suffix = File.RightChop(Prefix.Len());
+
+        // Skips unfinished copies, which end in .tmp
+        if (File.StartsWith(Prefix) && Suffix.Len() > 0 && Suffix.IsNumeric())
+        {
+            const int32 Version = FCString::Atoi(*Suffix);
+
+            if (Version > 0)
+            {
+                Versions.Add(Version);
+            }
+        }
+    }
+
+    // Version 1 is the newest
+    Versions.Sort();
+    return Versions;
+}
+
+FString FNumbskullSlotRotation::GetBackupFileName(const FString& InFileName, int32 InVersion)
+{
+    return FString::Printf(TEXT("%s.bak%d"), *InFileName, InVersion);
+}
+
+void FNumbskullSlotRotation::RotateBackups(const FString& InFileName, int32 InNumBackups)
+{
+    IFileManager& FileManager = IFileManager::Get();
+
+    const TArray<int32> Versions = GetBackupVersions(InFileName);
+
+    // Oldest first, so every rename goes to a version that's already free
+    for (int32 Index = Versions.Num() - 1; Index >= 0; --Index)
+    {
+        const int32 Version = Versions[Index];
+
+        const FString BackupFileName = GetBackupFileName(InFileName, Version);
+
+        if (Version >= InNumBackups)
+        {
+            FileManager.Delete(*BackupFileName, false, false, true);
+        }
+        else if (!ReplaceFile(BackupFileName, GetBackupFileName(InFileName, Version + 1)))
+        {
+            UE_LOG(Serializer, Warning, TEXT("Couldn't rotate backup {%s}"), *BackupFileName);
+        }
+    }
+}
+
+bool FNumbskullSlotRotation::CloneFile(const FString& InFrom, const FString& InTo)
+{
+    IFileManager::Get().Delete(*InTo, false, false, true);
+
+    const FString From = GetPlatformPath(InFrom, false);
+    const FString To = GetPlatformPath(InTo, true);
+
+#if PLATFORM_LINUX
+    const int Source = open(TCHAR_TO_UTF8(*From), O_RDONLY | O_CLOEXEC);
+    if (Source < 0)
+    {
+        return false;
+    }
+
+    const int Destination = open(TCHAR_TO_UTF8(*To), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    const bool bCloned = Destination >= 0 && ioctl(Destination, FICLONE, Source) == 0;
+
+    close(Source);
+
+    if (Destination >= 0)
+    {
+        close(Destination);
+
+        // Filesystems without extent sharing refuse, and leave an empty file behind
+        if (!bCloned)
+        {
+            unlink(TCHAR_TO_UTF8(*To));
+        }
+    }
+
+    return bCloned;
+#elif PLATFORM_MAC
+    return clonefile(TCHAR_TO_UTF8(*From), TCHAR_TO_UTF8(*To), 0) == 0;
+#else
+    return false;
+#endif
+}
+
+bool FNumbskullSlotRotation::LinkFile(const FString& InFrom, const FString& InTo)
+{
+    IFileManager::Get().Delete(*InTo, false, false, true);
+
+    const FString From = GetPlatformPath(InFrom, false);
+    const FString To = GetPlatformPath(InTo, true);
+
+#if PLATFORM_LINUX || PLATFORM_MAC
+    return link(TCHAR_TO_UTF8(*From), TCHAR_TO_UTF8(*To)) == 0;
+#elif PLATFORM_WINDOWS
+    return CreateHardLinkW(*To, *From, nullptr) != 0;
+#else
+    return false;
+#endif
+}
+
+bool FNumbskullSlotRotation::ReplaceFile(const FString& InFrom, const FString& InTo)
+{
+    const FString From = GetPlatformPath(InFrom, false);
+    const FString To = GetPlatformPath(InTo, true);
+
+#if PLATFORM_LINUX || PLATFORM_MAC
+    if (rename(TCHAR_TO_UTF8(*From), TCHAR_TO_UTF8(*To)) == 0)
+    {
+        // The new name lives in the directory, which has to be flushed for the rename to survive a power cut
+        const int Directory = open(TCHAR_TO_UTF8(*FPaths::GetPath(To)), O_RDONLY | O_CLOEXEC);
+
+        if (Directory >= 0)
+        {
+            fsync(Directory);
+            close(Directory);
+        }
+
+        return true;
+    }
+#elif PLATFORM_WINDOWS
+    if (MoveFileExW(*From, *To, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0)
+    {
+        return true;
+    }
+#endif
+
+    // Deletes then moves, so there's a moment without the file
+    return IFileManager::Get().Move(*InTo, *InFrom, true, true);
+}
+
+bool FNumbskullSlotRotation::WriteFileFlushed(const FString& InFileName, const TArray<uint8>& InBytes)
+{
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(InFileName));
+
+    TUniquePtr<IFileHandle> Handle(PlatformFile.OpenWrite(*InFileName));
+
+    // A full flush waits for the disk, not just the operating system's cache
+    const bool bWritten = Handle
+        && Handle->Write(InBytes.GetData(), InBytes.Num())
+        && Handle->Flush(true);
+
+    Handle.Reset();
+
+    if (!bWritten)
+    {
+        IFileManager::Get().Delete(*InFileName, false, false, true);
+        UE_LOG(Serializer, Error, TEXT("Couldn't write {%s}"), *InFileName);
+    }
+
+    return bWritten;
+}
@@ -0,0 +1,283 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullSnapshotBuffer.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "Algo/Compare.h"
+#include "Misc/Compression.h"
+
+UNumbskullSnapshotBuffer* UNumbskullSnapshotBuffer::CreateSnapshotBuffer(UObject* Outer, int32 InMaxSnapshots, int32 InMemoryBudgetKB, int32 InKeyframeInterval)
+{
+    UNumbskullSnapshotBuffer* SnapshotBuffer = NewObject<UNumbskullSnapshotBuffer>(Outer ? Outer : GetTransientPackage());
+    SnapshotBuffer->MaxSnapshots = FMath::Max(1, InMaxSnapshots);
+    SnapshotBuffer->MemoryBudgetKB = FMath::Max(0, InMemoryBudgetKB);
+    SnapshotBuffer->KeyframeInterval = FMath::Max(0, InKeyframeInterval);
+    return SnapshotBuffer;
+}
+
+bool UNumbskullSnapshotBuffer::Capture(const TArray<UObject*>& InObjects)
+{
+    FObjectData ObjectData;
+
+    if (!UNumbskullSerializationBPLibrary::SaveObjects(InObjects, ObjectData, false))
+    {
+        return false;
+    }
+
+    if (Snapshots.Num() > 0)
+    {
+        DemoteNewest(ObjectData.Data.Get());
+    }
+
+    FStoredSnapshot Newest;
+    Newest.RawSize = ObjectData.Data.Num();
+    Newest.bKeyframe = true;
+
+    // Reference tables rarely change between snapshots of the same objects, so share them when they match
+    const TSharedPtr<const FNumbskullReferenceTable> PreviousReferences = Snapshots.Num() > 0 ? Snapshots.Last().References : nullptr;
+    if (PreviousReferences.IsValid()
+        && PreviousReferences->bEnabled == ObjectData.References.bEnabled
+        && PreviousReferences->References.Num() == ObjectData.References.References.Num()
+        && Algo::CompareByPredicate(PreviousReferences->References, ObjectData.References.References, [](const FNumbskullObjectReference& A, const FNumbskullObjectReference& B)
+           {
+               return A.SnapshotIndex == B.SnapshotIndex && A.ObjectPath == B.ObjectPath;
+           }))
+    {
+        Newest.References = PreviousReferences;
+    }
+    else
+    {
+        Newest.References = MakeShared<const FNumbskullReferenceTable>(MoveTemp(ObjectData.References));
+    }
+
+    Snapshots.Add(MoveTemp(Newest));
+    NewestData = ObjectData.Data.MoveToArray();
+
+    ++CaptureCount;
+
+    EnforceLimits();
+
+    return true;
+}
+
+bool UNumbskullSnapshotBuffer::GetSnapshot(int32 InSnapshotsAgo, FObjectData& OutObjectData) const
+{
+    if (InSnapshotsAgo < 0 || InSnapshotsAgo >= Snapshots.Num())
+    {
+        UE_LOG(Serializer, Warning, TEXT("Snapshot %d doesn't exist. There are %d snapshots"), InSnapshotsAgo, Snapshots.Num());
+        return false;
+    }
+
+    FObjectData ObjectData;
+
+    if (!Rebuild(InSnapshotsAgo, ObjectData.Data.GetMutable()))
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't rebuild snapshot %d"), InSnapshotsAgo);
+        return false;
+    }
+
+    const FStoredSnapshot& Snapshot = Snapshots[Snapshots.Num() - 1 - InSnapshotsAgo];
+    if (Snapshot.References.IsValid())
+    {
+        ObjectData.References = *Snapshot.References;
+    }
+
+    OutObjectData = MoveTemp(ObjectData);
+
+    return true;
+}
+
+bool UNumbskullSnapshotBuffer::Restore(int32 InSnapshotsAgo, const TArray<UObject*>& InObjects, bool bDiscardNewer)
+{
+    FObjectData ObjectData;
+
+    if (!GetSnapshot(InSnapshotsAgo, ObjectData))
+    {
+        return false;
+    }
+
+    if (!UNumbskullSerializationBPLibrary::LoadObjects(InObjects, ObjectData))
+    {
+        return false;
+    }
+
+    if (bDiscardNewer && InSnapshotsAgo > 0)
+    {
+        const int32 NewestIndex = Snapshots.Num() - 1 - InSnapshotsAgo;
+
+        Snapshots.SetNum(NewestIndex + 1);
+
+        FStoredSnapshot& Newest = Snapshots.Last();
+        Newest.Block.Empty();
+        Newest.BlockSize = 0;
+        Newest.bKeyframe = true;
+        Newest.bCompressed = false;
+
+        NewestData = ObjectData.Data.MoveToArray();
+
+        EnforceLimits();
+    }
+
+    return true;
+}
+
+void UNumbskullSnapshotBuffer::Reset()
+{
+    Snapshots.Empty();
+    NewestData.Empty();
+    CaptureCount = 0;
+    MemoryUsage = 0;
+}
+
+void UNumbskullSnapshotBuffer::DemoteNewest(const TArray<uint8>& InNewData)
+{
+    FStoredSnapshot& Previous = Snapshots.Last();
+
+    // The previous snapshot was capture number CaptureCount - 1
+    const bool bKeyframe = KeyframeInterval > 0 && ((CaptureCount - 1) % KeyframeInterval) == 0;
+
+    if (bKeyframe)
+    {
+        StoreBlock(Previous, NewestData);
+    }
+    else
+    {
+        TArray<uint8> Delta = NewestData;
+        XorInto(Delta, InNewData, FMath::Max(NewestData.Num(), InNewData.Num()));
+        StoreBlock(Previous, Delta);
+    }
+
+    Previous.bKeyframe = bKeyframe;
+}
+
+void UNumbskullSnapshotBuffer::EnforceLimits()
+{
+    const int64 Budget = static_cast<int64>(MemoryBudgetKB) * 1024;
+
+    MemoryUsage = NewestData.GetAllocatedSize();
+    for (const FStoredSnapshot& Snapshot : Snapshots)
+    {
+        MemoryUsage += Snapshot.GetMemoryUsage();
+    }
+
+    // Older snapshots depend on newer ones, never the other way round, so the oldest can always be dropped
+    int32 NumToRemove = 0;
+    while (Snapshots.Num() - NumToRemove > 1
+           && (Snapshots.Num() - NumToRemove > MaxSnapshots || (Budget > 0 && MemoryUsage > Budget)))
+    {
+        MemoryUsage -= Snapshots[NumToRemove].GetMemoryUsage();
+        ++NumToRemove;
+    }
+
+    if (NumToRemove > 0)
+    {
+        Snapshots.RemoveAt(0, NumToRemove, false);
+    }
+}
+
+bool UNumbskullSnapshotBuffer::Rebuild(int32 InSnapshotsAgo, TArray<uint8>& OutData) const
+{
+    const int32 LastIndex = Snapshots.Num() - 1;
+    const int32 TargetIndex = LastIndex - InSnapshotsAgo;
+
+    // Start from the nearest full copy at or after the target
+    int32 StartIndex = TargetIndex;
+    while (StartIndex < LastIndex && !Snapshots[StartIndex].bKeyframe)
+    {
+        ++StartIndex;
+    }
+
+    TArray<uint8> Data;
+
+    if (StartIndex == LastIndex)
+    {
+        Data = NewestData;
+    }
+    else if (!LoadBlock(Snapshots[StartIndex], Data))
+    {
+        return false;
+    }
+
+    TArray<uint8> Delta;
+    for (int32 Index = StartIndex - 1; Index >= TargetIndex; --Index)
+    {
+        if (!LoadBlock(Snapshots[Index], Delta))
+        {
+            return false;
+        }
+
+        XorInto(Data, Delta, Snapshots[Index].RawSize);
+    }
+
+    OutData = MoveTemp(Data);
+
+    return true;
+}
+
+void UNumbskullSnapshotBuffer::StoreBlock(FStoredSnapshot& Snapshot, const TArray<uint8>& InRaw)
+{
+    Snapshot.BlockSize = InRaw.Num();
+    Snapshot.Block.Reset();
+    Snapshot.bCompressed = false;
+
+    int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, InRaw.Num());
+    Snapshot.Block.SetNumUninitialized(CompressedSize);
+
+    if (FCompression::CompressMemory(NAME_Zlib, Snapshot.Block.GetData(), CompressedSize, InRaw.GetData(), InRaw.Num())
+        && CompressedSize < InRaw.Num())
+    {
+        Snapshot.Block.SetNum(CompressedSize, false);
+        Snapshot.bCompressed = true;
+    }
+    else
+    {
+        Snapshot.Block = InRaw;
+    }
+
+    Snapshot.Block.Shrink();
+}
+
+bool UNumbskullSnapshotBuffer::LoadBlock(const FStoredSnapshot& Snapshot, TArray<uint8>& OutRaw)
+{
+    if (!Snapshot.bCompressed)
+    {
+        OutRaw = Snapshot.Block;
+        return true;
+    }
+
+    OutRaw.SetNumUninitialized(Snapshot.BlockSize);
+    return FCompression::UncompressMemory(NAME_Zlib, OutRaw.GetData(), OutRaw.Num(), Snapshot.Block.GetData(), Snapshot.Block.Num());
+}
+
+void UNumbskullSnapshotBuffer::XorInto(TArray<uint8>& Target, const TArray<uint8>& Source, int32 InResultSize)
+{
+    const int32 CommonSize = FMath::Min(Target.Num(), Source.Num());
+
+    if (Target.Num() < Source.Num())
+    {
+        // Missing bytes count as zero, so XOR leaves the source's bytes as they are
+        Target.Append(Source.GetData() + CommonSize, Source.Num() - CommonSize);
+    }
+
+    uint8* TargetData = Target.GetData();
+    const uint8* SourceData = Source.GetData();
+
+    // Eight bytes at a time, then whatever is left
+    int32 Index = 0;
+    for (; Index + 8 <= CommonSize; Index += 8)
+    {
+        uint64 TargetWord;
+        uint64 SourceWord;
+        FMemory::Memcpy(&TargetWord, TargetData + Index, sizeof(uint64));
+        FMemory::Memcpy(&SourceWord, SourceData + Index, sizeof(uint64));
+        TargetWord ^= SourceWord;
+        FMemory::Memcpy(TargetData + Index, &TargetWord, sizeof(uint64));
+    }
+
+    for (; Index < CommonSize; ++Index)
+    {
+        TargetData[Index] ^= SourceData[Index];
+    }
+
+    Target.SetNum(InResultSize, false);
+}
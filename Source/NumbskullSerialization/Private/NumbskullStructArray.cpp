@@ -0,0 +1,378 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullStructArray.h"
+#include "NumbskullArchive.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "Misc/Crc.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/StructuredArchive.h"
+#include "UObject/UnrealType.h"
+
+namespace
+{
+    /** 'NSKS', marks data written by FNumbskullStructArray*/
+    const uint32 StructArrayMagic = 0x534B534E;
+
+    /** A run of bytes copied as they are, or a single property serialized through the archive*/
+    struct FStructStep
+    {
+        int32 Offset = 0;
+
+        int32 Size = 0;
+
+        const FProperty* Property = nullptr;
+    };
+
+    /** How the elements of a struct are serialized, worked out once per struct*/
+    struct FStructPlan
+    {
+        uint32 LayoutHash = 0;
+
+        int32 ElementSize = 0;
+
+        /** Elements are written as one block of memory and there are no steps*/
+        bool bPlainData = false;
+
+        TArray<FStructStep> Steps;
+    };
+
+    bool IsPlainDataStruct(const UScriptStruct* InStruct);
+
+    bool IsPlainDataProperty(const FProperty* InProperty)
+    {
+        if (CastField<FNumericProperty>(InProperty) || CastField<FEnumProperty>(InProperty))
+        {
+            return true;
+        }
+
+        // Bitfields share their byte with other properties
+        if (const FBoolProperty* BoolProperty = CastField<FBoolProperty>(InProperty))
+        {
+            return BoolProperty->IsNativeBool();
+        }
+
+        if (const FStructProperty* StructProperty = CastField<FStructProperty>(InProperty))
+        {
+            return IsPlainDataStruct(StructProperty->Struct);
+        }
+
+        return false;
+    }
+
+    bool IsPlainDataStruct(const UScriptStruct* InStruct)
+    {
+        // Only native structs know whether they have members that aren't properties
+        if ((InStruct->StructFlags & STRUCT_IsPlainOldData) == 0)
+        {
+            return false;
+        }
+
+        for (TFieldIterator<FProperty> It(InStruct); It; ++It)
+        {
+            if (!IsPlainDataProperty(*It))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    uint32 HashStruct(const UStruct* InStruct, uint32 InHash)
+    {
+        uint32 Hash = FCrc::StrCrc32(*InStruct->GetName(), InHash);
+
+        const int32 StructSize = InStruct->GetStructureSize();
+        Hash = FCrc::MemCrc32(&StructSize, sizeof(StructSize), Hash);
+
+        for (TFieldIterator<FProperty> It(InStruct); It; ++It)
+        {
+            const FProperty* Property = *It;
+
+            Hash = FCrc::StrCrc32(*Property->GetName(), Hash);
+            Hash = FCrc::StrCrc32(*Property->GetID().ToString(), Hash);
+
+            const int32 Layout[] = { Property->GetOffset_ForInternal(), Property->ElementSize, Property->ArrayDim, Property->HasAnyPropertyFlags(CPF_Transient) ? 1 : 0 };
+            Hash = FCrc::MemCrc32(Layout, sizeof(Layout), Hash);
+
+            if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+            {
+                Hash = HashStruct(StructProperty->Struct, Hash);
+            }
+        }
+
+        return Hash;
+    }
+
+    TSharedRef<const FStructPlan, ESPMode::ThreadSafe> MakePlan(const UScriptStruct* InStruct)
+    {
+        TSharedRef<FStructPlan, ESPMode::ThreadSafe> Plan = MakeShared<FStructPlan, ESPMode::ThreadSafe>();
+        Plan->LayoutHash = HashStruct(InStruct, 0);
+        Plan->ElementSize = InStruct->GetStructureSize();
+        Plan->bPlainData = IsPlainDataStruct(InStruct);
+
+        if (Plan->bPlainData)
+        {
+            return Plan;
+        }
+
+        for (TFieldIterator<FProperty> It(InStruct); It; ++It)
+        {
+            const FProperty* Property = *It;
+
+            if (Property->HasAnyPropertyFlags(CPF_Transient))
+            {
+                continue;
+            }
+
+            if (IsPlainDataProperty(Property))
+            {
+                const int32 Offset = Property->GetOffset_ForInternal();
+                const int32 Size = Property->ElementSize * Property->ArrayDim;
+
+                // Neighbouring plain data is copied in one go
+                FStructStep* Previous = Plan->Steps.Num() > 0 ? &Plan->Steps.Last() : nullptr;
+                if (Previous && !Previous->Property && Previous->Offset + Previous->Size == Offset)
+                {
+                    Previous->Size += Size;
+                }
+                else
+                {
+                    FStructStep& Step = Plan->Steps.AddDefaulted_GetRef();
+                    Step.Offset = Offset;
+                    Step.Size = Size;
+                }
+
+                continue;
+            }
+
+            for (int32 Index = 0; Index < Property->ArrayDim; ++Index)
+            {
+                FStructStep& Step = Plan->Steps.AddDefaulted_GetRef();
+                Step.Offset = Property->GetOffset_ForInternal() + Index * Property->ElementSize;
+                Step.Size = Property->ElementSize;
+                Step.Property = Property;
+            }
+        }
+
+        return Plan;
+    }
+
+    TSharedRef<const FStructPlan, ESPMode::ThreadSafe> GetPlan(const UScriptStruct* InStruct)
+    {
+        static FCriticalSection CriticalSection;
+        static TMap<TWeakObjectPtr<const UScriptStruct>, TSharedRef<const FStructPlan, ESPMode::ThreadSafe>> Plans;
+
+        // Blueprint structs are recompiled in place and hot reload can change a native one, so the pointer alone can't
+        // tell that the layout, and the properties a plan points to, are still the same
+        const uint32 LayoutHash = HashStruct(InStruct, 0);
+
+        FScopeLock Lock(&CriticalSection);
+
+        if (const TSharedRef<const FStructPlan, ESPMode::ThreadSafe>* Plan = Plans.Find(InStruct))
+        {
+            if ((*Plan)->LayoutHash == LayoutHash)
+            {
+                return *Plan;
+            }
+        }
+        else
+        {
+            // Structs that were destroyed can't be found again, a new one at the same address is a different weak pointer
+            for (auto It = Plans.CreateIterator(); It; ++It)
+            {
+                if (!It.Key().IsValid())
+                {
+                    It.RemoveCurrent();
+                }
+            }
+        }
+
+        return Plans.Add(InStruct, MakePlan(InStruct));
+    }
+
+    /** Runs a plan over every element, in either direction. Returns false on error*/
+    bool SerializeElements(FArchive& Ar, const FStructPlan& InPlan, uint8* InElements, int32 InNum)
+    {
+        FNumbskullArchive Archive(Ar, true);
+        FStructuredArchiveFromArchive Adapter(Archive);
+        FStructuredArchive::FStream Stream = Adapter.GetSlot().EnterStream();
+
+        for (int32 Element = 0; Element < InNum && !Archive.IsError(); ++Element)
+        {
+            uint8* ElementData = InElements + static_cast<int64>(Element) * InPlan.ElementSize;
+
+            for (const FStructStep& Step : InPlan.Steps)
+            {
+                if (Step.Property)
+                {
+                    Step.Property->SerializeItem(Stream.EnterElement(), ElementData + Step.Offset, nullptr);
+                }
+                else
+                {
+                    Stream.EnterElement().Serialize(ElementData + Step.Offset, Step.Size);
+                }
+            }
+        }
+
+        return !Archive.IsError();
+    }
+
+    /** Reads what's written before the elements*/
+    bool ReadHeader(FArchive& Ar, bool& bOutPlainData, uint32& OutLayoutHash, int32& OutNum)
+    {
+        uint32 Magic = 0;
+        uint8 bPlainData = 0;
+
+        Ar << Magic;
+        Ar << bPlainData;
+        Ar << OutLayoutHash;
+        Ar << OutNum;
+
+        if (Ar.IsError() || Magic != StructArrayMagic || OutNum < 0)
+        {
+            UE_LOG(Serializer, Error, TEXT("Object data doesn't hold a struct array"));
+            return false;
+        }
+
+        bOutPlainData = bPlainData != 0;
+        return true;
+    }
+}
+
+bool FNumbskullStructArray::IsPlainData(const UScriptStruct* InStruct)
+{
+    return InStruct && GetPlan(InStruct)->bPlainData;
+}
+
+bool FNumbskullStructArray::Save(const UScriptStruct* InStruct, const void* InElements, int32 InNum, FObjectData& OutObjectData)
+{
+    if (!InStruct || InNum < 0 || (InNum > 0 && !InElements))
+    {
+        UE_LOG(Serializer, Warning, TEXT("Couldn't save struct array. It needs a struct and elements"));
+        return false;
+    }
+
+    const TSharedRef<const FStructPlan, ESPMode::ThreadSafe> Plan = GetPlan(InStruct);
+    const int64 BlockSize = static_cast<int64>(InNum) * Plan->ElementSize;
+
+    if (Plan->bPlainData && BlockSize > MAX_int32 - 64)
+    {
+        UE_LOG(Serializer, Error, TEXT("Struct array of %s is too large to save"), *InStruct->GetName());
+        return false;
+    }
+
+    TArray<uint8> Bytes;
+    FMemoryWriter Writer(Bytes, true);
+
+    uint32 Magic = StructArrayMagic;
+    uint8 bPlainData = Plan->bPlainData ? 1 : 0;
+    uint32 LayoutHash = Plan->LayoutHash;
+    int32 Num = InNum;
+
+    Writer << Magic;
+    Writer << bPlainData;
+    Writer << LayoutHash;
+    Writer << Num;
+
+    // Elements aren't changed when saving, the archive just works in both directions
+    uint8* Elements = static_cast<uint8*>(const_cast<void*>(InElements));
+
+    if (Plan->bPlainData)
+    {
+        Bytes.Reserve(Bytes.Num() + static_cast<int32>(BlockSize));
+        Writer.Serialize(Elements, BlockSize);
+    }
+    else if (!SerializeElements(Writer, *Plan, Elements, InNum))
+    {
+        Writer.SetError();
+    }
+
+    if (Writer.IsError())
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't serialize struct array of %s"), *InStruct->GetName());
+        return false;
+    }
+
+    OutObjectData = FObjectData();
+    OutObjectData.Data = MoveTemp(Bytes);
+
+    return true;
+}
+
+bool FNumbskullStructArray::Load(const FObjectData& InObjectData, const UScriptStruct* InStruct, void* OutElements, int32 InCapacity, int32& OutNum)
+{
+    OutNum = 0;
+
+    if (!InStruct || (InCapacity > 0 && !OutElements))
+    {
+        UE_LOG(Serializer, Warning, TEXT("Couldn't load struct array. It needs a struct and elements to load into"));
+        return false;
+    }
+
+    FMemoryReader Reader(InObjectData.Data.Get(), true);
+
+    bool bPlainData = false;
+    uint32 LayoutHash = 0;
+    int32 Num = 0;
+
+    if (!ReadHeader(Reader, bPlainData, LayoutHash, Num))
+    {
+        return false;
+    }
+
+    const TSharedRef<const FStructPlan, ESPMode::ThreadSafe> Plan = GetPlan(InStruct);
+
+    if (LayoutHash != Plan->LayoutHash || bPlainData != Plan->bPlainData)
+    {
+        UE_LOG(Serializer, Error, TEXT("Struct array was saved with a different layout of %s"), *InStruct->GetName());
+        return false;
+    }
+
+    if (Num > InCapacity)
+    {
+        UE_LOG(Serializer, Error, TEXT("Struct array has %d elements but there's only room for %d"), Num, InCapacity);
+        return false;
+    }
+
+    uint8* Elements = static_cast<uint8*>(OutElements);
+
+    if (Plan->bPlainData)
+    {
+        const int64 BlockSize = static_cast<int64>(Num) * Plan->ElementSize;
+
+        if (Reader.TotalSize() - Reader.Tell() != BlockSize)
+        {
+            UE_LOG(Serializer, Error, TEXT("Struct array of %s is corrupt"), *InStruct->GetName());
+            return false;
+        }
+
+        Reader.Serialize(Elements, BlockSize);
+    }
+    else if (!SerializeElements(Reader, *Plan, Elements, Num))
+    {
+        Reader.SetError();
+    }
+
+    if (Reader.IsError() || Reader.Tell() != Reader.TotalSize())
+    {
+        UE_LOG(Serializer, Error, TEXT("Struct array of %s is corrupt"), *InStruct->GetName());
+        return false;
+    }
+
+    OutNum = Num;
+    return true;
+}
+
+bool FNumbskullStructArray::GetNum(const FObjectData& InObjectData, int32& OutNum)
+{
+    FMemoryReader Reader(InObjectData.Data.Get(), true);
+
+    bool bPlainData = false;
+    uint32 LayoutHash = 0;
+
+    return ReadHeader(Reader, bPlainData, LayoutHash, OutNum);
+}
@@ -0,0 +1,275 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullTransformCodec.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "Math/Float16.h"
+
+namespace
+{
+    // Flags packed alongside the index of the dropped rotation component
+    const uint8 RotationIndexMask = 0x03;
+    const uint8 UnitScaleFlag = 0x04;
+    const uint8 HalfScaleFlag = 0x08;
+
+    // The three smallest components of a normalized quaternion lie within +/- 1/sqrt(2)
+    const float SmallestThreeRange = 0.70710678f;
+    const float SmallestThreeSteps = 32767.0f;
+
+    const float UnitScaleTolerance = 1.e-4f;
+
+    // Half precision floats overflow to infinity above the largest and lose their relative precision below the smallest normal
+    const float MaxHalfScale = 65504.0f;
+    const float MinHalfScale = 6.1035156e-5f;
+
+    bool CanStoreHalfScale(const FVector& Scale)
+    {
+        for (int32 Axis = 0; Axis < 3; ++Axis)
+        {
+            const float Value = FMath::Abs(Scale[Axis]);
+
+            if (Value > MaxHalfScale || (Value != 0.0f && Value < MinHalfScale))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    int16 QuantizeRotationComponent(float Value)
+    {
+        const float Scaled = FMath::Clamp(Value / SmallestThreeRange, -1.0f, 1.0f) * SmallestThreeSteps;
+        return static_cast<int16>(FMath::RoundToInt(Scaled));
+    }
+
+    float DequantizeRotationComponent(int16 Value)
+    {
+        return (static_cast<float>(Value) / SmallestThreeSteps) * SmallestThreeRange;
+    }
+
+    int32 QuantizeTranslationComponent(float Value, float Precision)
+    {
+        const double Steps = FMath::RoundToDouble(static_cast<double>(Value) / Precision);
+
+        if (Steps > MAX_int32 || Steps < MIN_int32)
+        {
+            UE_LOG(Serializer, Warning, TEXT("Translation %f is out of range for a precision of %f. It will be clamped"), Value, Precision);
+        }
+
+        return static_cast<int32>(FMath::Clamp(Steps, static_cast<double>(MIN_int32), static_cast<double>(MAX_int32)));
+    }
+
+    float GetPrecision(const FNumbskullTransformFormat& Format)
+    {
+        return FMath::Max(Format.TranslationPrecision, KINDA_SMALL_NUMBER);
+    }
+}
+
+bool FNumbskullCompactTransform::HasUnitScale() const
+{
+    return (Flags & UnitScaleFlag) != 0;
+}
+
+bool FNumbskullCompactTransform::HasHalfPrecisionScale() const
+{
+    return (Flags & HalfScaleFlag) != 0;
+}
+
+void FNumbskullCompactTransform::SerializeScale(FArchive& Ar)
+{
+    if (HasUnitScale())
+    {
+        Scale = FVector::OneVector;
+    }
+    else if (HasHalfPrecisionScale())
+    {
+        FFloat16 ScaleX(Scale.X);
+        FFloat16 ScaleY(Scale.Y);
+        FFloat16 ScaleZ(Scale.Z);
+        Ar << ScaleX;
+        Ar << ScaleY;
+        Ar << ScaleZ;
+        Scale = FVector(ScaleX.GetFloat(), ScaleY.GetFloat(), ScaleZ.GetFloat());
+    }
+    else
+    {
+        Ar << Scale;
+    }
+}
+
+void FNumbskullTransformCodec::Serialize(FArchive& Ar, FTransform& Transform, const FNumbskullTransformFormat& Format)
+{
+    if (Format.Encoding == ENumbskullTransformEncoding::Compact)
+    {
+        SerializeCompact(Ar, Transform, Format);
+    }
+    else
+    {
+        Ar << Transform;
+    }
+}
+
+void FNumbskullTransformCodec::SerializeArray(FArchive& Ar, TArray<FTransform>& Transforms, const FNumbskullTransformFormat& Format)
+{
+    if (Format.Encoding != ENumbskullTransformEncoding::Compact)
+    {
+        Ar << Transforms;
+        return;
+    }
+
+    int32 Num = Transforms.Num();
+    Ar << Num;
+
+    if (Num < 0)
+    {
+        Ar.SetError();
+        return;
+    }
+
+    TArray<FNumbskullCompactTransform> Compact;
+
+    if (Ar.IsSaving())
+    {
+        Compact.Reserve(Num);
+        for (const FTransform& Transform : Transforms)
+        {
+            Compact.Add(Encode(Transform, Format));
+        }
+    }
+    else
+    {
+        Compact.SetNum(Num);
+    }
+
+    for (FNumbskullCompactTransform& Element : Compact)
+    {
+        Ar << Element.Flags;
+    }
+
+    for (FNumbskullCompactTransform& Element : Compact)
+    {
+        Ar << Element.Rotation[0] << Element.Rotation[1] << Element.Rotation[2];
+    }
+
+    for (FNumbskullCompactTransform& Element : Compact)
+    {
+        Ar << Element.Translation[0] << Element.Translation[1] << Element.Translation[2];
+    }
+
+    for (FNumbskullCompactTransform& Element : Compact)
+    {
+        Element.SerializeScale(Ar);
+    }
+
+    if (Ar.IsLoading() && !Ar.IsError())
+    {
+        Transforms.SetNumUninitialized(Num);
+        for (int32 Index = 0; Index < Num; ++Index)
+        {
+            Transforms[Index] = Decode(Compact[Index], Format);
+        }
+    }
+}
+
+void FNumbskullTransformCodec::SerializeCompact(FArchive& Ar, FTransform& Transform, const FNumbskullTransformFormat& Format)
+{
+    FNumbskullCompactTransform Compact;
+
+    if (Ar.IsSaving())
+    {
+        Compact = Encode(Transform, Format);
+    }
+
+    Ar << Compact.Flags;
+    Ar << Compact.Rotation[0] << Compact.Rotation[1] << Compact.Rotation[2];
+    Ar << Compact.Translation[0] << Compact.Translation[1] << Compact.Translation[2];
+    Compact.SerializeScale(Ar);
+
+    if (Ar.IsLoading())
+    {
+        Transform = Decode(Compact, Format);
+    }
+}
+
+FNumbskullCompactTransform FNumbskullTransformCodec::Encode(const FTransform& Transform, const FNumbskullTransformFormat& Format)
+{
+    const float Precision = GetPrecision(Format);
+    const FQuat Rotation = Transform.GetRotation().GetNormalized();
+    const FVector Translation = Transform.GetTranslation();
+
+    FNumbskullCompactTransform Compact;
+
+    const float Components[4] = { Rotation.X, Rotation.Y, Rotation.Z, Rotation.W };
+
+    uint8 LargestIndex = 0;
+    for (uint8 Index = 1; Index < 4; ++Index)
+    {
+        if (FMath::Abs(Components[Index]) > FMath::Abs(Components[LargestIndex]))
+        {
+            LargestIndex = Index;
+        }
+    }
+
+    // q and -q are the same rotation, so the dropped component can always be positive
+    const float Sign = Components[LargestIndex] < 0.0f ? -1.0f : 1.0f;
+
+    int32 Stored = 0;
+    for (uint8 Index = 0; Index < 4; ++Index)
+    {
+        if (Index != LargestIndex)
+        {
+            Compact.Rotation[Stored++] = QuantizeRotationComponent(Components[Index] * Sign);
+        }
+    }
+
+    Compact.Translation[0] = QuantizeTranslationComponent(Translation.X, Precision);
+    Compact.Translation[1] = QuantizeTranslationComponent(Translation.Y, Precision);
+    Compact.Translation[2] = QuantizeTranslationComponent(Translation.Z, Precision);
+
+    Compact.Flags = LargestIndex;
+    Compact.Scale = Transform.GetScale3D();
+
+    if (Compact.Scale.Equals(FVector::OneVector, UnitScaleTolerance))
+    {
+        Compact.Flags |= UnitScaleFlag;
+    }
+    else if (Format.bHalfPrecisionScale && CanStoreHalfScale(Compact.Scale))
+    {
+        Compact.Flags |= HalfScaleFlag;
+    }
+
+    return Compact;
+}
+
+FTransform FNumbskullTransformCodec::Decode(const FNumbskullCompactTransform& Compact, const FNumbskullTransformFormat& Format)
+{
+    const float Precision = GetPrecision(Format);
+    const uint8 LargestIndex = Compact.Flags & RotationIndexMask;
+
+    float Components[4];
+    float SumOfSquares = 0.0f;
+
+    int32 Stored = 0;
+    for (uint8 Index = 0; Index < 4; ++Index)
+    {
+        if (Index != LargestIndex)
+        {
+            Components[Index] = DequantizeRotationComponent(Compact.Rotation[Stored++]);
+            SumOfSquares += FMath::Square(Components[Index]);
+        }
+    }
+
+    Components[LargestIndex] = FMath::Sqrt(FMath::Max(0.0f, 1.0f - SumOfSquares));
+
+    FQuat Rotation(Components[0], Components[1], Components[2], Components[3]);
+    Rotation.Normalize();
+
+    // In float, step counts past 2^24 would lose whole steps before the result is even rounded
+    const FVector Translation(
+        static_cast<float>(static_cast<double>(Compact.Translation[0]) * Precision),
+        static_cast<float>(static_cast<double>(Compact.Translation[1]) * Precision),
+        static_cast<float>(static_cast<double>(Compact.Translation[2]) * Precision));
+
+    return FTransform(Rotation, Translation, Compact.HasUnitScale() ? FVector::OneVector : Compact.Scale);
+}
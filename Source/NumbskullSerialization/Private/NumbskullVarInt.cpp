@@ -0,0 +1,382 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullVarInt.h"
+
+// 'NSKV'
+const uint32 FNumbskullVarInt::Magic = 0x564B534E;
+
+namespace
+{
+    /** Top two bits of a control byte*/
+    enum EVarIntRun : uint8
+    {
+        /** Raw bytes. Length in the low six bits, or a varint in the control bytes if they're zero*/
+        RawRun = 0,
+
+        /** Varints decoding to 2, 4 or 8 byte values. Count minus one in the low six bits*/
+        Width2Run = 1,
+        Width4Run = 2,
+        Width8Run = 3,
+    };
+
+    const int32 MaxRunCount = 64;
+    const int64 MaxInlineRawLength = 63;
+
+    uint8 GetRunKind(int32 Width)
+    {
+        return Width == 2 ? Width2Run : (Width == 4 ? Width4Run : Width8Run);
+    }
+
+    uint64 ZigZag(int64 Value)
+    {
+        return (static_cast<uint64>(Value) << 1) ^ static_cast<uint64>(Value >> 63);
+    }
+
+    int64 UnZigZag(uint64 Value)
+    {
+        return static_cast<int64>(Value >> 1) ^ -static_cast<int64>(Value & 1);
+    }
+
+    int64 ReadSigned(const uint8* Data, int32 Width)
+    {
+        switch (Width)
+        {
+        case 2:
+            {
+                int16 Value;
+                FMemory::Memcpy(&Value, Data, sizeof(Value));
+                return Value;
+            }
+        case 4:
+            {
+                int32 Value;
+                FMemory::Memcpy(&Value, Data, sizeof(Value));
+                return Value;
+            }
+        default:
+            {
+                int64 Value;
+                FMemory::Memcpy(&Value, Data, sizeof(Value));
+                return Value;
+            }
+        }
+    }
+
+    int32 GetVarIntSize(uint64 Value)
+    {
+        int32 Size = 1;
+        while (Value >= 0x80)
+        {
+            Value >>= 7;
+            ++Size;
+        }
+        return Size;
+    }
+
+    void WriteVarInt(TArray<uint8>& Out, uint64 Value)
+    {
+        while (Value >= 0x80)
+        {
+            Out.Add(static_cast<uint8>(Value) | 0x80);
+            Value >>= 7;
+        }
+        Out.Add(static_cast<uint8>(Value));
+    }
+
+    bool ReadVarInt(const uint8*& Cursor, const uint8* End, uint64& OutValue)
+    {
+        OutValue = 0;
+
+        for (int32 Shift = 0; Shift < 64 && Cursor < End; Shift += 7)
+        {
+            const uint8 Byte = *Cursor++;
+            OutValue |= static_cast<uint64>(Byte & 0x7F) << Shift;
+
+            if ((Byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /** Merges consecutive runs of the same kind into as few control bytes as possible*/
+    class FControlWriter
+    {
+    public:
+
+        explicit FControlWriter(TArray<uint8>& InControl)
+        : Control(InControl)
+        {
+        }
+
+        void AddRaw(int64 Length)
+        {
+            if (Kind != RawRun)
+            {
+                Flush();
+                Kind = RawRun;
+            }
+            Count += Length;
+        }
+
+        void AddValue(uint8 InKind)
+        {
+            if (Kind != InKind || Count == MaxRunCount)
+            {
+                Flush();
+                Kind = InKind;
+            }
+            ++Count;
+        }
+
+        void Flush()
+        {
+            if (Count == 0)
+            {
+                return;
+            }
+
+            if (Kind != RawRun)
+            {
+                Control.Add(static_cast<uint8>((Kind << 6) | (Count - 1)));
+            }
+            else if (Count <= MaxInlineRawLength)
+            {
+                Control.Add(static_cast<uint8>(Count));
+            }
+            else
+            {
+                Control.Add(0);
+                WriteVarInt(Control, static_cast<uint64>(Count));
+            }
+
+            Count = 0;
+        }
+
+    private:
+
+        TArray<uint8>& Control;
+
+        uint8 Kind = RawRun;
+
+        int64 Count = 0;
+    };
+
+    /**
+     * Decodes a run of varints into fixed width values.
+     *
+     * Almost every value fits in one byte, so eight bytes are checked for continuation bits at once and, if there are
+     * none, decoded without any branching per byte.
+     */
+    template <typename IntType>
+    bool DecodeRun(const uint8*& Values, const uint8* End, uint8*& Out, int32 Count)
+    {
+        while (Count > 0)
+        {
+            if (Count >= 8 && End - Values >= 8)
+            {
+                uint64 Word;
+                FMemory::Memcpy(&Word, Values, sizeof(Word));
+
+                if ((Word & 0x8080808080808080ull) == 0)
+                {
+                    IntType Decoded[8];
+                    for (int32 Index = 0; Index < 8; ++Index)
+                    {
+                        Decoded[Index] = static_cast<IntType>(UnZigZag(Values[Index]));
+                    }
+
+                    FMemory::Memcpy(Out, Decoded, sizeof(Decoded));
+                    Values += 8;
+                    Out += sizeof(Decoded);
+                    Count -= 8;
+                    continue;
+                }
+            }
+
+            uint64 Value;
+            if (!ReadVarInt(Values, End, Value))
+            {
+                return false;
+            }
+
+            const IntType Decoded = static_cast<IntType>(UnZigZag(Value));
+            FMemory::Memcpy(Out, &Decoded, sizeof(Decoded));
+            Out += sizeof(Decoded);
+            --Count;
+        }
+
+        return true;
+    }
+}
+
+bool FNumbskullVarInt::IsEncoded(const uint8* InData, int64 InNumBytes)
+{
+    uint32 DataMagic = 0;
+    if (InData && InNumBytes >= static_cast<int64>(sizeof(DataMagic)))
+    {
+        FMemory::Memcpy(&DataMagic, InData, sizeof(DataMagic));
+    }
+    return DataMagic == Magic;
+}
+
+bool FNumbskullVarInt::Decode(const uint8* InData, int64 InNumBytes, TArray<uint8>& OutRawBytes)
+{
+    if (!IsEncoded(InData, InNumBytes))
+    {
+        return false;
+    }
+
+    const uint8* Cursor = InData + sizeof(Magic);
+    const uint8* End = InData + InNumBytes;
+
+    uint64 RawSize = 0;
+    uint64 ControlSize = 0;
+    if (!ReadVarInt(Cursor, End, RawSize) || !ReadVarInt(Cursor, End, ControlSize)
+        || RawSize > static_cast<uint64>(MAX_int32) || ControlSize > static_cast<uint64>(End - Cursor))
+    {
+        return false;
+    }
+
+    const uint8* Control = Cursor;
+    const uint8* ControlEnd = Control + ControlSize;
+    const uint8* Values = ControlEnd;
+
+    OutRawBytes.SetNumUninitialized(static_cast<int32>(RawSize));
+    uint8* Out = OutRawBytes.GetData();
+    uint8* const OutEnd = Out + RawSize;
+
+    while (Control < ControlEnd)
+    {
+        const uint8 Token = *Control++;
+        const uint8 Kind = Token >> 6;
+
+        if (Kind == RawRun)
+        {
+            uint64 Length = Token & 0x3F;
+            if (Length == 0 && !ReadVarInt(Control, ControlEnd, Length))
+            {
+                return false;
+            }
+
+            if (Length > static_cast<uint64>(End - Values) || Length > static_cast<uint64>(OutEnd - Out))
+            {
+                return false;
+            }
+
+            FMemory::Memcpy(Out, Values, Length);
+            Values += Length;
+            Out += Length;
+            continue;
+        }
+
+        const int32 Count = (Token & 0x3F) + 1;
+        const int32 Width = Kind == Width2Run ? 2 : (Kind == Width4Run ? 4 : 8);
+
+        if (static_cast<int64>(Count) * Width > OutEnd - Out)
+        {
+            return false;
+        }
+
+        const bool bDecoded = Width == 2 ? DecodeRun<int16>(Values, End, Out, Count)
+            : (Width == 4 ? DecodeRun<int32>(Values, End, Out, Count) : DecodeRun<int64>(Values, End, Out, Count));
+
+        if (!bDecoded)
+        {
+            return false;
+        }
+    }
+
+    return Out == OutEnd && Values == End;
+}
+
+FNumbskullVarIntWriter::FNumbskullVarIntWriter(TArray<uint8>& InBytes, bool bInEncode)
+: FMemoryWriter(InBytes, true)
+, OutBytes(InBytes)
+, bEncode(bInEncode)
+{
+}
+
+void FNumbskullVarIntWriter::Serialize(void* Data, int64 Num)
+{
+    checkf(!bFinished, TEXT("Can't write to a finished FNumbskullVarIntWriter"));
+
+    // Writes behind the end are patches of values already recorded, like property tag sizes
+    if (bEncode && (Num == 2 || Num == 4 || Num == 8) && Tell() == TotalSize())
+    {
+        Candidates.Add({ Tell(), static_cast<int32>(Num) });
+    }
+
+    FMemoryWriter::Serialize(Data, Num);
+}
+
+void FNumbskullVarIntWriter::Finish()
+{
+    if (bFinished)
+    {
+        return;
+    }
+
+    bFinished = true;
+
+    // Empty data stays empty so it's still recognized as having nothing to load
+    if (!bEncode || OutBytes.Num() == 0)
+    {
+        return;
+    }
+
+    const uint8* Raw = OutBytes.GetData();
+
+    TArray<uint8> Control;
+    TArray<uint8> Values;
+    Values.Reserve(OutBytes.Num());
+
+    FControlWriter ControlWriter(Control);
+    int64 Cursor = 0;
+
+    for (const FCandidate& Candidate : Candidates)
+    {
+        const uint64 Value = ZigZag(ReadSigned(Raw + Candidate.Offset, Candidate.Width));
+
+        // Values that wouldn't shrink, like most floats, stay in the raw run
+        if (GetVarIntSize(Value) >= Candidate.Width)
+        {
+            continue;
+        }
+
+        if (Candidate.Offset > Cursor)
+        {
+            const int32 Length = static_cast<int32>(Candidate.Offset - Cursor);
+            ControlWriter.AddRaw(Length);
+            Values.Append(Raw + Cursor, Length);
+        }
+
+        ControlWriter.AddValue(GetRunKind(Candidate.Width));
+        WriteVarInt(Values, Value);
+
+        Cursor = Candidate.Offset + Candidate.Width;
+    }
+
+    if (Cursor < OutBytes.Num())
+    {
+        const int32 Length = static_cast<int32>(OutBytes.Num() - Cursor);
+        ControlWriter.AddRaw(Length);
+        Values.Append(Raw + Cursor, Length);
+    }
+
+    ControlWriter.Flush();
+
+    TArray<uint8> Encoded;
+    Encoded.Reserve(sizeof(FNumbskullVarInt::Magic) + 20 + Control.Num() + Values.Num());
+    Encoded.AddUninitialized(sizeof(FNumbskullVarInt::Magic));
+    FMemory::Memcpy(Encoded.GetData(), &FNumbskullVarInt::Magic, sizeof(FNumbskullVarInt::Magic));
+    WriteVarInt(Encoded, static_cast<uint64>(OutBytes.Num()));
+    WriteVarInt(Encoded, static_cast<uint64>(Control.Num()));
+    Encoded.Append(Control);
+    Encoded.Append(Values);
+
+    OutBytes = MoveTemp(Encoded);
+    Candidates.Empty();
+}
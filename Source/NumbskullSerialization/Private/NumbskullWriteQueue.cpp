@@ -0,0 +1,229 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "NumbskullWriteQueue.h"
+#include "NumbskullSerializationBPLibrary.h"
+
+#include "HAL/RunnableThread.h"
+
+uint32 FNumbskullWriteQueue::FWriter::Run()
+{
+    while (true)
+    {
+        if (Queue.DrainAndWrite())
+        {
+            continue;
+        }
+
+        // Everything has been written
+        if (bStopping)
+        {
+            break;
+        }
+
+        Queue.SubmittedEvent->Wait();
+    }
+
+    return 0;
+}
+
+void FNumbskullWriteQueue::FWriter::Stop()
+{
+    bStopping = true;
+    Queue.SubmittedEvent->Trigger();
+}
+
+FNumbskullWriteQueue::FNumbskullWriteQueue()
+: LastTicket(0)
+, DoneTicket(0)
+, FirstFailedTicket(MAX_uint64)
+, NumSubmitted(0)
+, NumCoalesced(0)
+, NumWritten(0)
+, NumFailed(0)
+, SubmittedEvent(FPlatformProcess::GetSynchEventFromPool(false))
+, WrittenEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+    Writer = MakeUnique<FWriter>(*this);
+    Thread = FRunnableThread::Create(Writer.Get(), TEXT("NumbskullWriteQueue"), 0, TPri_BelowNormal);
+}
+
+FNumbskullWriteQueue::~FNumbskullWriteQueue()
+{
+    Writer->Stop();
+    Thread->WaitForCompletion();
+    delete Thread;
+
+    FPlatformProcess::ReturnSynchEventToPool(SubmittedEvent);
+    FPlatformProcess::ReturnSynchEventToPool(WrittenEvent);
+}
+
+uint64 FNumbskullWriteQueue::Submit(const FString& InFileName, const FObjectData& InObjectData, bool bCompressed)
+{
+    if (InFileName.IsEmpty() || InObjectData.Data.Num() == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Couldn't queue write. It needs a file name and data"));
+        return 0;
+    }
+
+    FWrite Write;
+    Write.FileName = InFileName;
+    Write.ObjectData = InObjectData;
+    Write.bCompressed = bCompressed;
+
+    return Enqueue(MoveTemp(Write));
+}
+
+uint64 FNumbskullWriteQueue::SubmitBytes(const FString& InFileName, const FNumbskullPayload& InBytes)
+{
+    if (InFileName.IsEmpty() || InBytes.Num() == 0)
+    {
+        UE_LOG(Serializer, Warning, TEXT("Couldn't queue write. It needs a file name and data"));
+        return 0;
+    }
+
+    FWrite Write;
+    Write.FileName = InFileName;
+    Write.Bytes = InBytes;
+    Write.bRawBytes = true;
+
+    return Enqueue(MoveTemp(Write));
+}
+
+uint64 FNumbskullWriteQueue::Enqueue(FWrite&& InWrite)
+{
+    // A later ticket can reach the queue first. The writer only moves DoneTicket past tickets it has seen
+    InWrite.Ticket = ++LastTicket;
+    const uint64 Ticket = InWrite.Ticket;
+
+    Pending.Enqueue(MoveTemp(InWrite));
+    ++NumSubmitted;
+
+    SubmittedEvent->Trigger();
+
+    return Ticket;
+}
+
+ENumbskullWriteResult FNumbskullWriteQueue::WaitFor(uint64 InTicket, float InTimeoutSeconds) const
+{
+    const double EndTime = FPlatformTime::Seconds() + InTimeoutSeconds;
+
+    while (!IsDone(InTicket))
+    {
+        if (InTimeoutSeconds >= 0.0f && FPlatformTime::Seconds() >= EndTime)
+        {
+            return ENumbskullWriteResult::TimedOut;
+        }
+
+        WrittenEvent->Wait(FTimespan::FromMilliseconds(10.0));
+    }
+
+    return IsWritten(InTicket) ? ENumbskullWriteResult::Written : ENumbskullWriteResult::Failed;
+}
+
+FNumbskullWriteQueueStats FNumbskullWriteQueue::GetStats() const
+{
+    FNumbskullWriteQueueStats Stats;
+    Stats.Submitted = NumSubmitted;
+    Stats.Coalesced = NumCoalesced;
+    Stats.Written = NumWritten;
+    Stats.Failed = NumFailed;
+    return Stats;
+}
+
+bool FNumbskullWriteQueue::DrainAndWrite()
+{
+    TArray<FCoalescedWrite> Batch;
+    TMap<FString, int32> BatchIndices;
+
+    FWrite Write;
+    while (Pending.Dequeue(Write))
+    {
+        // Last write wins, and keeps the place in the batch of the first
+        if (const int32* Index = BatchIndices.Find(Write.FileName))
+        {
+            FCoalescedWrite& Existing = Batch[*Index];
+            Existing.Tickets.Add(Write.Ticket);
+            Existing.Write = MoveTemp(Write);
+            ++NumCoalesced;
+            continue;
+        }
+
+        BatchIndices.Add(Write.FileName, Batch.Num());
+
+        FCoalescedWrite& Coalesced = Batch.AddDefaulted_GetRef();
+        Coalesced.Tickets.Add(Write.Ticket);
+        Coalesced.Write = MoveTemp(Write);
+    }
+
+    if (Batch.Num() == 0)
+    {
+        return false;
+    }
+
+    for (const FCoalescedWrite& Coalesced : Batch)
+    {
+        const bool bWritten = WriteFile(Coalesced.Write);
+        ++(bWritten ? NumWritten : NumFailed);
+
+        CompleteTickets(Coalesced.Tickets, bWritten);
+    }
+
+    WrittenEvent->Trigger();
+
+    return true;
+}
+
+bool FNumbskullWriteQueue::WriteFile(const FWrite& InWrite)
+{
+    // Both replace the file through a temporary one that's flushed to the disk first, so a fence means durable
+    const bool bWritten = InWrite.bRawBytes
+        ? UNumbskullSerializationBPLibrary::SaveBytesToDisk(InWrite.FileName, InWrite.Bytes.Get())
+        : InWrite.bCompressed
+            ? UNumbskullSerializationBPLibrary::SaveObjectDataToDiskCompressed(InWrite.FileName, InWrite.ObjectData)
+            : UNumbskullSerializationBPLibrary::SaveObjectDataToDisk(InWrite.FileName, InWrite.ObjectData);
+
+    if (!bWritten)
+    {
+        UE_LOG(Serializer, Error, TEXT("Couldn't write queued file {%s}"), *InWrite.FileName);
+    }
+
+    return bWritten;
+}
+
+void FNumbskullWriteQueue::CompleteTickets(const TArray<uint64>& InTickets, bool bWritten)
+{
+    // Recorded before the tickets are done, so a waiter never sees them done without the failure. Every ticket of a
+    // coalesced write fails with it, as the writes it replaced never reached the disk either
+    if (!bWritten)
+    {
+        uint64 FirstFailed = FirstFailedTicket;
+
+        for (const uint64 Ticket : InTickets)
+        {
+            FirstFailed = FMath::Min(FirstFailed, Ticket);
+        }
+
+        FirstFailedTicket = FirstFailed;
+    }
+
+    uint64 Done = DoneTicket;
+
+    for (const uint64 Ticket : InTickets)
+    {
+        if (Ticket == Done + 1)
+        {
+            ++Done;
+        }
+        else
+        {
+            CompletedOutOfOrder.Add(Ticket);
+        }
+    }
+
+    while (CompletedOutOfOrder.Remove(Done + 1) > 0)
+    {
+        ++Done;
+    }
+
+    DoneTicket = Done;
+}
@@ -0,0 +1,38 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#include "ObjectData.h"
+
+void FObjectData::SerializeStream(FArchive& Ar)
+{
+    if (Ar.IsSaving())
+    {
+        // Data saved with a reference table holds IDs instead of paths, so it's useless without the table
+        if (References.bEnabled)
+        {
+            int32 Marker = ReferenceTableMarker;
+            Ar << Marker;
+            Ar << Data;
+            Ar << References;
+        }
+        else
+        {
+            Ar << Data;
+        }
+        return;
+    }
+
+    References = FNumbskullReferenceTable();
+
+    int32 NumBytes = 0;
+    Ar << NumBytes;
+
+    if (NumBytes == ReferenceTableMarker)
+    {
+        Ar << Data;
+        Ar << References;
+        return;
+    }
+
+    // Otherwise this was the size of a plain byte array
+    Data.LoadBytes(Ar, NumBytes);
+}
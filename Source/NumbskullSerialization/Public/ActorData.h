@@ -3,6 +3,9 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "NumbskullFileHeader.h"
+#include "NumbskullPayload.h"
+#include "NumbskullBulkData.h"
 #include "ActorData.generated.h"
 
 /**
@@ -14,18 +17,39 @@ struct NUMBSKULLSERIALIZATION_API FActorData
 {
     GENERATED_BODY()
 
-    /** Binary data to read back into an object or save to disk*/
+    /** Binary data to read back into an object or save to disk. Shared between copies of the struct*/
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
-    TArray<uint8> Data;
+    FNumbskullPayload Data;
     
     /** Transform of the actor*/
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
     FTransform Transform;
     
+    /** Large arrays the actor serialized out of line. Written inline by operator<<, which has no section to put them in*/
+    UPROPERTY()
+    FNumbskullBulkData BulkData;
+    
+    /** Written by operator<< in place of the size of Data when bulk data follows it. No array has a negative size*/
+    static const int32 BulkDataMarker = -1;
+    
     friend FArchive& operator << (FArchive& Ar, FActorData& Object)
     {
-        Ar << Object.Data;
-        Ar << Object.Transform;
+        Object.SerializeStream(Ar);
         return Ar;
     }
+    
+    /** Serializes Data and Transform, followed by BulkData if there is any. Data without bulk data keeps the layout it always had*/
+    void SerializeStream(FArchive& Ar);
+
+    /** Serializes the data in the format described by a file header. Legacy headers match operator<< without bulk data*/
+    void SerializeVersioned(FArchive& Ar, const FNumbskullFileHeader& Header)
+    {
+        Ar << Data;
+        FNumbskullTransformCodec::Serialize(Ar, Transform, Header.TransformFormat);
+        
+        if (Header.Version >= ENumbskullFileVersion::AddedBulkData)
+        {
+            Ar << BulkData;
+        }
+    }
 };
@@ -3,6 +3,10 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "NumbskullFileHeader.h"
+#include "NumbskullPayload.h"
+#include "NumbskullPropertyIndex.h"
+#include "NumbskullBulkData.h"
 #include "ActorProxy.generated.h"
 
 /**
@@ -27,16 +31,58 @@ struct NUMBSKULLSERIALIZATION_API FActorProxy
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
     FTransform ActorTransform;
 
-    /** Serialized data. This gives us the details of the actor like their health, equipment etc.*/
+    /** Serialized data. This gives us the details of the actor like their health, equipment etc. Shared between copies of the struct*/
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
-    TArray<uint8> ActorData;
+    FNumbskullPayload ActorData;
+
+    /** Path of the controller possessing the actor when it was saved, if it's a pawn. Used to possess it again on load*/
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    FString PossessedBy;
+
+    /** Where each property starts in ActorData, so single properties can be read without spawning. Not written by operator<<*/
+	UPROPERTY()
+    FNumbskullPropertyIndex PropertyIndex;
+
+    /** Large arrays the actor serialized out of line. Written inline by operator<<, which has no section to put them in*/
+	UPROPERTY()
+    FNumbskullBulkData BulkData;
+    
+    /** Written by operator<< in place of the size of ActorData when PossessedBy and BulkData follow it. No array has a negative size*/
+    static const int32 ExtendedMarker = -1;
     
     friend FArchive& operator<<(FArchive& Ar, FActorProxy& ActorProxy)
     {
-        Ar << ActorProxy.ActorClass;
-        Ar << ActorProxy.ActorName;
-        Ar << ActorProxy.ActorTransform;
-        Ar << ActorProxy.ActorData;
+        ActorProxy.SerializeStream(Ar);
         return Ar;
     }
+    
+    /**
+     * Serializes the class, name, transform and data, followed by PossessedBy and BulkData if either is set. Proxies with
+     * neither keep the layout they always had.
+     */
+    void SerializeStream(FArchive& Ar);
+
+    /** Serializes the proxy in the format described by a file header. Legacy headers match operator<< without the extras*/
+    void SerializeVersioned(FArchive& Ar, const FNumbskullFileHeader& Header)
+    {
+        Ar << ActorClass;
+        Ar << ActorName;
+        FNumbskullTransformCodec::Serialize(Ar, ActorTransform, Header.TransformFormat);
+        Ar << ActorData;
+        
+        if (Header.Version >= ENumbskullFileVersion::AddedPossessedBy)
+        {
+            Ar << PossessedBy;
+        }
+        
+        if (Header.Version >= ENumbskullFileVersion::AddedPropertyIndex)
+        {
+            Ar << PropertyIndex;
+        }
+        
+        if (Header.Version >= ENumbskullFileVersion::AddedBulkData)
+        {
+            Ar << BulkData;
+        }
+    }
 };
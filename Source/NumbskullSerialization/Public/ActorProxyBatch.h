@@ -0,0 +1,102 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ActorProxy.h"
+#include "NumbskullFileHeader.h"
+#include "NumbskullPayload.h"
+#include "NumbskullReferenceTable.h"
+#include "ActorProxyBatch.generated.h"
+
+/**
+ * Stores many actor proxies as columns rather than one proxy after another.
+ *
+ * Classes are stored once and referenced by index, then names, transforms and payload offsets each sit in their own array,
+ * followed by every actor's serialized data in a single payload. Compressors see similar data together and loaders can
+ * decode every transform at once and look up each class once.
+ *
+ * Object references in the payload are written into a reference table, so actors in the batch can reference each other
+ * even when they're spawned with different names.
+ */
+USTRUCT(BlueprintType)
+struct NUMBSKULLSERIALIZATION_API FActorProxyBatch
+{
+    GENERATED_BODY()
+
+    /** Unique classes of the actors in the batch*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    TArray<FString> Classes;
+
+    /** Index into Classes for each actor*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    TArray<int32> ClassIndices;
+
+    /** Name of each actor*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    TArray<FName> Names;
+
+    /** Transform of each actor*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    TArray<FTransform> Transforms;
+
+    /** Where each actor's serialized data starts in Payload. It ends where the next actor's starts*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    TArray<int32> PayloadOffsets;
+
+    /** Path of the controller possessing each actor, if it was a possessed pawn*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    TArray<FString> PossessedBy;
+
+    /** Serialized data of every actor, one after another. Shared between copies of the batch*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    FNumbskullPayload Payload;
+
+    /** Objects referenced by the payload. References to actors in the batch are stored by index*/
+    UPROPERTY()
+    FNumbskullReferenceTable References;
+
+    /** Number of actors in the batch*/
+    int32 Num() const { return ClassIndices.Num(); }
+
+    /** Removes all actors, keeping the allocations*/
+    void Reset();
+
+    /** Preallocates space for a number of actors*/
+    void Reserve(int32 NumActors);
+
+    /** Appends an actor proxy to the batch. Not supported for batches with a reference table*/
+    void Add(const FActorProxy& InActorProxy);
+
+    /** Appends an actor described by its parts to the batch. Used to avoid building an intermediate proxy*/
+    void Add(const FString& InActorClass, FName InActorName, const FTransform& InActorTransform, const uint8* InData, int32 InNumBytes, const FString& InPossessedBy = FString());
+
+    /** Serialized data of an actor in the batch*/
+    const uint8* GetData(int32 Index) const { return Payload.GetData() + PayloadOffsets[Index]; }
+
+    /** Size of an actor's serialized data*/
+    int32 GetDataSize(int32 Index) const;
+
+    /** Rebuilds a standalone actor proxy for an actor in the batch. Only valid for batches without a reference table*/
+    void GetActorProxy(int32 Index, FActorProxy& OutActorProxy) const;
+
+    /** Checks that every column agrees with each other. Used after loading from disk*/
+    bool IsValid() const;
+
+    /** Serializes the batch in the format described by a file header*/
+    void SerializeVersioned(FArchive& Ar, const FNumbskullFileHeader& Header);
+
+    /** Writes the format version first, then everything SerializeVersioned writes at that version, including the reference table*/
+    friend FArchive& operator << (FArchive& Ar, FActorProxyBatch& Batch)
+    {
+        Batch.SerializeStream(Ar);
+        return Ar;
+    }
+
+    void SerializeStream(FArchive& Ar);
+
+private:
+
+    /** Lookup of Classes used while adding. Not serialized*/
+    TMap<FString, int32> ClassLookup;
+};
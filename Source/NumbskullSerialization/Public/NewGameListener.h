@@ -32,4 +32,16 @@ public:
 	 */
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "Numbskull|OnNewGame")
     void OnNewGame();
+
+	/**
+	 * Whether the state OnNewGame sets up is always the same, so it can be baked ahead of time.
+	 *
+	 * When a baked new game exists for the map, objects that can be baked have their baked state applied instead of
+	 * OnNewGame being called. Return false for setup that has to run every time, such as anything random or based on
+	 * the player's choices. False unless overridden.
+	 */
+	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "Numbskull|OnNewGame")
+	bool CanBakeNewGame() const;
+
+	virtual bool CanBakeNewGame_Implementation() const { return false; }
 };
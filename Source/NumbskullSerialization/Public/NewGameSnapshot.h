@@ -0,0 +1,76 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NumbskullFileHeader.h"
+#include "NumbskullPayload.h"
+#include "NewGameSnapshot.generated.h"
+
+/**
+ * The baked state of one new game listener.
+ */
+USTRUCT()
+struct NUMBSKULLSERIALIZATION_API FNewGameSnapshotObject
+{
+    GENERATED_BODY()
+
+    /** Path of the object without any play in editor prefix, which is how it's found again*/
+    UPROPERTY()
+    FString ObjectPath;
+
+    /** Path of the object's class. The baked state isn't applied to an object of another class*/
+    UPROPERTY()
+    FString ClassPath;
+
+    /** The object serialized after OnNewGame*/
+    UPROPERTY()
+    FNumbskullPayload Data;
+
+    friend FArchive& operator << (FArchive& Ar, FNewGameSnapshotObject& Object)
+    {
+        Ar << Object.ObjectPath;
+        Ar << Object.ClassPath;
+        Ar << Object.Data;
+        return Ar;
+    }
+};
+
+/**
+ * The state of a map's new game listeners straight after OnNewGame, baked ahead of time so a new game can apply it
+ * rather than setting everything up again.
+ *
+ * Baked with @see UNumbskullSerializationBPLibrary::BakeNewGame and applied by StartNewGame. Saved under
+ * Content/Numbskull/NewGame, which has to be added to the non-asset directories to copy so it's packaged.
+ */
+USTRUCT()
+struct NUMBSKULLSERIALIZATION_API FNewGameSnapshot
+{
+    GENERATED_BODY()
+
+    /** Package name of the map it was baked in*/
+    UPROPERTY()
+    FString MapName;
+
+    UPROPERTY()
+    TArray<FNewGameSnapshotObject> Objects;
+
+    friend FArchive& operator << (FArchive& Ar, FNewGameSnapshot& Snapshot)
+    {
+        Ar << Snapshot.MapName;
+        Ar << Snapshot.Objects;
+        return Ar;
+    }
+
+    /** Serializes the snapshot in the format described by a file header. Every version matches operator<<*/
+    void SerializeVersioned(FArchive& Ar, const FNumbskullFileHeader& Header)
+    {
+        Ar << *this;
+    }
+
+    /** File the snapshot of a map is saved to*/
+    static FString GetFileName(const FString& InMapName);
+
+    /** Extension of snapshot files*/
+    static const TCHAR* Extension;
+};
@@ -0,0 +1,74 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+class FNumbskullReferenceWriter;
+class FNumbskullReferenceReader;
+struct FNumbskullBulkData;
+
+/**
+ * The archive used by the library to serialize objects.
+ *
+ * Behaves like FObjectAndNameAsStringProxyArchive unless a reference writer or reader is attached, in which case
+ * object references are written as IDs into a reference table and resolved through it as they're read.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullArchive : public FObjectAndNameAsStringProxyArchive
+{
+public:
+
+    FNumbskullArchive(FArchive& InInnerArchive, bool bInLoadIfFindFails = true);
+
+    virtual ~FNumbskullArchive();
+
+    /** The library's archive serializing on this thread, if Ar is one. Lets native Serialize overrides reach it*/
+    static const FNumbskullArchive* Find(const FArchive& Ar);
+
+    /** Writes object references as IDs into the writer's table. Must outlive the archive*/
+    void SetReferenceWriter(FNumbskullReferenceWriter* InReferenceWriter) { ReferenceWriter = InReferenceWriter; }
+
+    /** Reads object references as IDs and resolves them with the reader. Must outlive the archive*/
+    void SetReferenceReader(FNumbskullReferenceReader* InReferenceReader) { ReferenceReader = InReferenceReader; }
+
+    /** Writes arrays serialized with FNumbskullBulkData::SerializeArray out of line. Must outlive the archive*/
+    void SetBulkDataWriter(FNumbskullBulkData* InBulkDataWriter) { BulkDataWriter = InBulkDataWriter; }
+
+    /** Reads arrays serialized with FNumbskullBulkData::SerializeArray from out of line. Must outlive the archive*/
+    void SetBulkDataReader(const FNumbskullBulkData* InBulkDataReader) { BulkDataReader = InBulkDataReader; }
+
+    FNumbskullBulkData* GetBulkDataWriter() const { return BulkDataWriter; }
+
+    const FNumbskullBulkData* GetBulkDataReader() const { return BulkDataReader; }
+
+    /** Leaves a property out of the serialized data, as if it was transient*/
+    void SkipProperty(const FProperty* InProperty);
+
+    virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
+
+    using FObjectAndNameAsStringProxyArchive::operator<<;
+
+    virtual FArchive& operator<<(UObject*& Obj) override;
+    virtual FArchive& operator<<(FWeakObjectPtr& Obj) override;
+
+    virtual FString GetArchiveName() const override { return TEXT("FNumbskullArchive"); }
+
+private:
+
+    /** Reads an ID and resolves it*/
+    UObject* ReadReference();
+
+    FNumbskullReferenceWriter* ReferenceWriter = nullptr;
+
+    FNumbskullReferenceReader* ReferenceReader = nullptr;
+
+    FNumbskullBulkData* BulkDataWriter = nullptr;
+
+    const FNumbskullBulkData* BulkDataReader = nullptr;
+
+    /** Archive that was serializing on this thread before this one was created*/
+    FNumbskullArchive* Previous = nullptr;
+
+    TSet<const FProperty*> SkippedProperties;
+};
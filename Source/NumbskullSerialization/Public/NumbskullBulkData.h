@@ -0,0 +1,176 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NumbskullArchive.h"
+#include "NumbskullPayload.h"
+#include "NumbskullBulkData.generated.h"
+
+/**
+ * Large arrays of an actor stored out of line from its serialized data, such as voxel chunks or fog of war grids.
+ *
+ * Arrays serialized with @see SerializeArray are appended here instead of into the middle of the data. Files write them in
+ * a page aligned section after the payload, which is never compressed and isn't read when the file is loaded. When the
+ * data is applied, each array is read straight from the file into its destination in a single read, with no per element
+ * serialization. Arrays captured in memory (not yet saved, or saved and not reloaded) are copied from memory instead.
+ *
+ * A record loaded from disk reads its arrays from the file when it's applied. When the library is about to overwrite or
+ * delete the file, every record still reading from it pulls its section into memory first, so a record can be loaded,
+ * saved over and then applied. Files changed any other way can't be read from afterwards.
+ */
+USTRUCT()
+struct NUMBSKULLSERIALIZATION_API FNumbskullBulkData
+{
+    GENERATED_BODY()
+
+    /** Alignment of the bulk data section in files*/
+    static const int64 SectionAlignment;
+
+    /** Alignment of each array in the section*/
+    static const int64 EntryAlignment;
+
+    /**
+     * Serializes an array of plain data out of line when the archive is writing or reading bulk data, inline otherwise.
+     *
+     * Call from a native Serialize override, after the super class:
+     *
+     * void AVoxelChunk::Serialize(FArchive& Ar)
+     * {
+     *     Super::Serialize(Ar);
+     *     FNumbskullBulkData::SerializeArray(Ar, Voxels);
+     * }
+     *
+     * Data written by archives other than the library's is always inline, so the same Serialize works everywhere.
+     */
+    template <typename ElementType>
+    static void SerializeArray(FArchive& Ar, TArray<ElementType>& Array)
+    {
+        static_assert(TIsPODType<ElementType>::Value, "Only arrays of plain data can be stored as bulk data");
+
+        const FNumbskullArchive* Archive = FNumbskullArchive::Find(Ar);
+
+        int32 Index = INDEX_NONE;
+        int32 Num = Array.Num();
+
+        if (Ar.IsSaving() && Archive && Archive->GetBulkDataWriter())
+        {
+            Index = Archive->GetBulkDataWriter()->Add(Array.GetData(), static_cast<int64>(Num) * sizeof(ElementType));
+        }
+
+        Ar << Index;
+        Ar << Num;
+
+        if (Ar.IsLoading())
+        {
+            if (Num < 0 || static_cast<int64>(Num) * sizeof(ElementType) > MAX_int32)
+            {
+                Ar.SetError();
+                return;
+            }
+
+            Array.SetNumUninitialized(Num);
+        }
+
+        const int64 NumBytes = static_cast<int64>(Num) * sizeof(ElementType);
+
+        if (Index == INDEX_NONE)
+        {
+            Ar.Serialize(Array.GetData(), NumBytes);
+        }
+        else if (Ar.IsLoading())
+        {
+            const FNumbskullBulkData* BulkData = Archive ? Archive->GetBulkDataReader() : nullptr;
+
+            if (!BulkData)
+            {
+                LogMissing(Index);
+            }
+
+            if (!BulkData || !BulkData->Read(Index, Array.GetData(), NumBytes))
+            {
+                Array.Reset();
+                Ar.SetError();
+            }
+        }
+    }
+
+    /**
+     * Appends bytes as a new array.
+     *
+     * @return Index of the array
+     */
+    int32 Add(const void* InData, int64 InNumBytes);
+
+    /**
+     * Copies an array into memory the size of the array.
+     *
+     * @return False if there's no such array, it's a different size or it couldn't be read from its file
+     */
+    bool Read(int32 InIndex, void* OutData, int64 InNumBytes) const;
+
+    /** Number of arrays*/
+    int32 Num() const { return Entries.Num(); }
+
+    bool IsEmpty() const { return Entries.Num() == 0; }
+
+    void Reset();
+
+    /** Gets the section as it's written to files, reading it from the file it was loaded from if need be*/
+    bool GetSection(TArray<uint8>& OutSection) const;
+
+    /** Reads the arrays from a file's bulk data section from now on, instead of memory*/
+    bool BindFile(const FString& InFileName, int64 InSectionOffset, int64 InSectionSize);
+
+    /** Reads the section of every bulk data still reading from a file into memory. Call before the file is overwritten or deleted*/
+    static void DetachFile(const FString& InFileName);
+
+    /** Where a loaded section is in its file. Shared between copies, so detaching the file reaches all of them*/
+    struct FFileSection;
+
+    /** Writes where each array is in the section. The section itself is written separately by the file*/
+    friend FArchive& operator << (FArchive& Ar, FNumbskullBulkData& BulkData);
+
+    /** Writes the arrays along with where they are, for when a record is a property of something else rather than a file*/
+    bool Serialize(FArchive& Ar);
+
+    /** Only true when both have no arrays or share the same ones*/
+    bool operator==(const FNumbskullBulkData& Other) const;
+
+private:
+
+    static void LogMissing(int32 InIndex);
+
+    struct FEntry
+    {
+        /** From the start of the section*/
+        int64 Offset = 0;
+
+        int64 Size = 0;
+
+        friend FArchive& operator << (FArchive& Ar, FEntry& Entry)
+        {
+            Ar << Entry.Offset;
+            Ar << Entry.Size;
+            return Ar;
+        }
+    };
+
+    TArray<FEntry> Entries;
+
+    /** The section laid out as it's written to files, while it's in memory. Shared between copies*/
+    FNumbskullPayload Section;
+
+    /** File holding the section, once loaded*/
+    TSharedPtr<FFileSection, ESPMode::ThreadSafe> File;
+};
+
+template<>
+struct TStructOpsTypeTraits<FNumbskullBulkData> : public TStructOpsTypeTraitsBase2<FNumbskullBulkData>
+{
+    enum
+    {
+        WithSerializer = true,
+        WithIdenticalViaEquality = true,
+    };
+};
@@ -0,0 +1,87 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * A preset dictionary for compressing small files with Zlib.
+ *
+ * Records are usually a few hundred bytes, too short for a compressor to find much repetition within them. A dictionary
+ * trained on a corpus of saves holds the byte sequences they have in common (class and property names, tag layouts), so
+ * even a tiny record compresses well against it.
+ *
+ * Dictionaries are stored as <Name>.nskdict in GetDirectory() and identified in file headers by a CRC of their bytes, so
+ * loading picks the right one no matter what it's named. They're trained with the save tool commandlet's Train mode.
+ */
+struct NUMBSKULLSERIALIZATION_API FNumbskullCompressionDictionary
+{
+    /** File name without the extension*/
+    FString Name;
+
+    /** CRC of Bytes, never zero. Recorded in the header of files compressed with the dictionary*/
+    uint32 Id = 0;
+
+    TArray<uint8> Bytes;
+
+    /** Largest useful dictionary. Zlib can't look back further than this*/
+    static const int32 MaxSize;
+
+    /** Extension of dictionary files*/
+    static const TCHAR* Extension;
+
+    /** Where dictionaries are loaded from and saved to. Add it to the directories to always package*/
+    static FString GetDirectory();
+
+    /** Identifies a dictionary's bytes*/
+    static uint32 MakeId(const TArray<uint8>& InBytes);
+
+    /**
+     * Builds a dictionary out of the byte sequences most common across a set of samples.
+     *
+     * The samples are split into as many ranges as the dictionary has segments and the segment in each range covering the
+     * most sequences shared by other samples is kept, with the most valuable segments placed last where Zlib reaches them
+     * cheapest. Around a hundred times the dictionary size in samples gives good results.
+     *
+     * @param InSamples Decoded payloads of existing saves.
+     * @param InMaxSize Most bytes the dictionary can have, up to MaxSize.
+     * @param OutBytes The dictionary.
+     *
+     * @return False if the samples have nothing in common
+     */
+    static bool Train(const TArray<TArray<uint8>>& InSamples, int32 InMaxSize, TArray<uint8>& OutBytes);
+
+    /**
+     * Saves a dictionary to GetDirectory() and makes it available to the registry.
+     *
+     * @return The saved dictionary, or null if it couldn't be written
+     */
+    static TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> Save(const FString& InName, const TArray<uint8>& InBytes);
+
+    /** Finds a dictionary by the Id recorded in a file header. Null if there's no such dictionary*/
+    static TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> FindById(uint32 InId);
+
+    /** Finds a dictionary by name. Null if there's no such dictionary*/
+    static TSharedPtr<const FNumbskullCompressionDictionary, ESPMode::ThreadSafe> FindByName(const FString& InName);
+
+    /** Loads the dictionaries in GetDirectory() again, for example after copying new ones in*/
+    static void Rescan();
+
+    /**
+     * Compresses bytes against the dictionary.
+     *
+     * @param InBytes Bytes to compress.
+     * @param OutCompressedBytes The uncompressed size followed by a raw deflate stream.
+     * @param InFlags ECompressionFlags. Biasing for speed or memory picks the fastest or smallest compression level.
+     *
+     * @return True if successful, false if otherwise
+     */
+    bool Compress(const TArray<uint8>& InBytes, TArray<uint8>& OutCompressedBytes, uint32 InFlags = 0) const;
+
+    /**
+     * Decompresses bytes previously compressed with @see Compress and the same dictionary.
+     *
+     * @return True if successful, false if otherwise
+     */
+    bool Decompress(const uint8* InCompressedBytes, int64 InNumBytes, TArray<uint8>& OutBytes) const;
+};
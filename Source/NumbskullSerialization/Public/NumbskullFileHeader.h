@@ -0,0 +1,115 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NumbskullTransformCodec.h"
+
+/**
+ * Versions of the Numbskull file format.
+ *
+ * Files written before the header was added have no header at all and are treated as Legacy.
+ */
+namespace ENumbskullFileVersion
+{
+    enum Type : uint32
+    {
+        /** No header. Full transforms, compression decided by the calling load method*/
+        Legacy = 0,
+
+        /** Header with flags and the transform format*/
+        AddedFileHeader,
+
+        /** Object data and actor proxy batches store object references in a reference table*/
+        AddedReferenceTable,
+
+        /** Actor proxies record the controller possessing a pawn*/
+        AddedPossessedBy,
+
+        /** Header records the compression format and flags. Older files are always Zlib*/
+        AddedCompressionFormat,
+
+        /** Object data and actor proxies store an index of their serialized properties*/
+        AddedPropertyIndex,
+
+        /** Header records the compression dictionary the payload was compressed against*/
+        AddedCompressionDictionary,
+
+        /** Actor data and actor proxies can store large arrays in a bulk data section after the payload*/
+        AddedBulkData,
+
+        // -----<new versions can be added above this line>-------------------------------------------------
+        VersionPlusOne,
+        Latest = VersionPlusOne - 1
+    };
+}
+
+/**
+ * Flags stored in the file header.
+ */
+namespace ENumbskullFileFlags
+{
+    enum Type : uint32
+    {
+        None = 0,
+
+        /** Everything after the header is compressed*/
+        Compressed = 1 << 0,
+    };
+}
+
+/**
+ * Written at the start of every file saved by the library so loaders know how to decode the rest of it.
+ */
+struct NUMBSKULLSERIALIZATION_API FNumbskullFileHeader
+{
+    /** Identifies a file with a header. Legacy files start with a string or array length so can't collide in practice*/
+    static const uint32 Magic;
+
+    /** Version of the format the file was written with*/
+    uint32 Version = ENumbskullFileVersion::Legacy;
+
+    /** Combination of ENumbskullFileFlags*/
+    uint32 Flags = ENumbskullFileFlags::None;
+
+    /** How transforms are encoded*/
+    FNumbskullTransformFormat TransformFormat;
+
+    /** Compression format of the payload when the Compressed flag is set*/
+    FName CompressionFormat = NAME_Zlib;
+
+    /** ECompressionFlags the payload was compressed with. Only needed to write the file, kept for reporting*/
+    uint32 CompressionFlags = 0;
+
+    /** @see FNumbskullCompressionDictionary::Id the payload was compressed against with Zlib, or zero for none*/
+    uint32 DictionaryId = 0;
+
+    /** Size of the payload as stored, compressed or not. Only set when there's a bulk data section after it*/
+    int64 PayloadSize = 0;
+
+    /** Where the page aligned bulk data section starts in the file, or zero if there's none*/
+    int64 BulkDataOffset = 0;
+
+    int64 BulkDataSize = 0;
+
+    /** Creates a header for a new file using the project settings*/
+    static FNumbskullFileHeader FromSettings();
+
+    /**
+     * Reads a header if the archive has one. Otherwise rewinds the archive and returns a legacy header.
+     *
+     * @param Ar Archive positioned at the start of the file.
+     * @param OutHeader The header that was read, or a legacy header.
+     *
+     * @return False if the file was written by a newer, unsupported version
+     */
+    static bool Read(FArchive& Ar, FNumbskullFileHeader& OutHeader);
+
+    bool IsLegacy() const { return Version == ENumbskullFileVersion::Legacy; }
+
+    bool HasFlag(ENumbskullFileFlags::Type Flag) const { return (Flags & Flag) != 0; }
+
+    bool HasBulkData() const { return BulkDataOffset > 0; }
+
+    friend FArchive& operator << (FArchive& Ar, FNumbskullFileHeader& Header);
+};
@@ -0,0 +1,118 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/List.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "NumbskullFileHeader.h"
+#include "NumbskullPayload.h"
+#include "NumbskullLoadCache.generated.h"
+
+/**
+ * Counters describing how well the load cache is doing.
+ */
+USTRUCT(BlueprintType)
+struct NUMBSKULLSERIALIZATION_API FNumbskullLoadCacheStats
+{
+    GENERATED_BODY()
+
+    /** Loads served from memory*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 Hits = 0;
+
+    /** Loads that read and decoded the file*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 Misses = 0;
+
+    /** Entries dropped to stay within the budget*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 Evictions = 0;
+
+    /** Decoded bytes held by the cache*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 BytesUsed = 0;
+
+    /** Files held by the cache*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int32 NumEntries = 0;
+};
+
+/**
+ * Keeps the decoded payloads of recently loaded files in memory so loading the same file again skips the read and decompression.
+ *
+ * Entries are keyed by full path and only used while the file's size and modification time still match, so files changed
+ * outside the library are read again. Saves through the library update their entry. The least recently used entries are
+ * dropped once the decoded bytes exceed the budget in the project settings. Thread safe.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullLoadCache
+{
+public:
+
+    static FNumbskullLoadCache& Get();
+
+    /** Whether the cache is turned on in the project settings*/
+    static bool IsEnabled();
+
+    /**
+     * Finds the decoded payload of a file if it hasn't changed since it was cached.
+     *
+     * @param InFileName File to look up.
+     * @param bLegacyCompressed Compression the caller expects for files without a header, as passed to DecodeFile.
+     * @param OutHeader Header of the file.
+     * @param OutPayload Decoded payload, shared with the cache.
+     *
+     * @return True on a hit, false if the file has to be loaded
+     */
+    bool Find(const FString& InFileName, bool bLegacyCompressed, FNumbskullFileHeader& OutHeader, FNumbskullPayload& OutPayload);
+
+    /**
+     * Stores the decoded payload of a file that was just loaded or saved.
+     *
+     * @param InStatData The file's size and modification time from before it was read, or of the bytes that were written.
+     *                   Taken by the caller so a change to the file while it was read makes the entry miss instead of
+     *                   serving the old bytes.
+     */
+    void Add(const FString& InFileName, bool bLegacyCompressed, const FNumbskullFileHeader& InHeader, const FNumbskullPayload& InPayload, const FFileStatData& InStatData);
+
+    /** Drops a file's entry, for example when it's overwritten or deleted*/
+    void Invalidate(const FString& InFileName);
+
+    /** Drops every entry*/
+    void Empty();
+
+    FNumbskullLoadCacheStats GetStats() const;
+
+    void ResetStats();
+
+private:
+
+    struct FEntry
+    {
+        FNumbskullFileHeader Header;
+
+        FNumbskullPayload Payload;
+
+        bool bLegacyCompressed = false;
+
+        int64 FileSize = 0;
+
+        FDateTime ModificationTime;
+
+        /** Position in the recency list*/
+        TDoubleLinkedList<FString>::TDoubleLinkedListNode* Node = nullptr;
+    };
+
+    static FString MakeKey(const FString& InFileName);
+
+    void RemoveEntry(const FString& InKey);
+
+    mutable FCriticalSection CriticalSection;
+
+    TMap<FString, FEntry> Entries;
+
+    /** Keys of the entries, most recently used first*/
+    TDoubleLinkedList<FString> Recency;
+
+    FNumbskullLoadCacheStats Stats;
+};
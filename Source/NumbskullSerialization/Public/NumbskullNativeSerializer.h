@@ -0,0 +1,350 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/Crc.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "ObjectData.h"
+
+/**
+ * Lists the fields of a native type for TNumbskullSerializer. Specialize with NUMBSKULL_SERIALIZER_FIELDS.
+ */
+template <typename Type>
+struct TNumbskullFields
+{
+    enum { bDefined = false };
+};
+
+/** A member of a type and its name, which is part of the schema hash*/
+template <typename ClassType, typename MemberType>
+struct TNumbskullField
+{
+    MemberType ClassType::* Member;
+
+    const TCHAR* Name;
+};
+
+template <typename ClassType, typename MemberType>
+constexpr TNumbskullField<ClassType, MemberType> MakeNumbskullField(MemberType ClassType::* InMember, const TCHAR* InName)
+{
+    return TNumbskullField<ClassType, MemberType>{ InMember, InName };
+}
+
+/** Fields in the order they're serialized. Visiting them unrolls into one call per field*/
+template <typename... FieldTypes>
+struct TNumbskullFieldList;
+
+template <>
+struct TNumbskullFieldList<>
+{
+    constexpr TNumbskullFieldList() {}
+
+    template <typename VisitorType>
+    FORCEINLINE void Visit(VisitorType& Visitor) const {}
+};
+
+template <typename FirstType, typename... RestTypes>
+struct TNumbskullFieldList<FirstType, RestTypes...>
+{
+    constexpr TNumbskullFieldList(FirstType InFirst, RestTypes... InRest) : First(InFirst), Rest(InRest...) {}
+
+    template <typename VisitorType>
+    FORCEINLINE void Visit(VisitorType& Visitor) const
+    {
+        Visitor(First);
+        Rest.Visit(Visitor);
+    }
+
+    FirstType First;
+
+    TNumbskullFieldList<RestTypes...> Rest;
+};
+
+template <typename... FieldTypes>
+constexpr TNumbskullFieldList<FieldTypes...> MakeNumbskullFields(FieldTypes... InFields)
+{
+    return TNumbskullFieldList<FieldTypes...>(InFields...);
+}
+
+/** A field of Type for NUMBSKULL_SERIALIZER_FIELDS*/
+#define NUMBSKULL_FIELD(Type, Member) MakeNumbskullField(&Type::Member, TEXT(#Member))
+
+/**
+ * Declares the fields TNumbskullSerializer reads and writes for a type, in order. Use at global scope after the type:
+ *
+ * NUMBSKULL_SERIALIZER_FIELDS(FInventorySlot,
+ *     NUMBSKULL_FIELD(FInventorySlot, ItemId),
+ *     NUMBSKULL_FIELD(FInventorySlot, Count),
+ *     NUMBSKULL_FIELD(FInventorySlot, Modifiers))
+ *
+ * Fields can be anything with an operator<<, including arrays and other types with fields of their own. Types other than
+ * those also need a name for the schema hash, declared with NUMBSKULL_TYPE_NAME.
+ */
+#define NUMBSKULL_SERIALIZER_FIELDS(Type, ...) \
+    template <> \
+    struct TNumbskullFields<Type> \
+    { \
+        enum { bDefined = true }; \
+        static constexpr auto Get() { return MakeNumbskullFields(__VA_ARGS__); } \
+    };
+
+/**
+ * Name of a field's type in the schema hash, so changing a field to another type of the same size fails to load. Enums
+ * without a name of their own only hash as an enum of their size.
+ */
+template <typename Type>
+struct TNumbskullTypeName
+{
+    enum { bDefined = TIsEnum<Type>::Value };
+    static const TCHAR* Get() { return TEXT("enum"); }
+};
+
+/** Names a type for the schema hash. Use at global scope, and never change the name once data is saved with it*/
+#define NUMBSKULL_TYPE_NAME(Type) \
+    template <> \
+    struct TNumbskullTypeName<Type> \
+    { \
+        enum { bDefined = true }; \
+        static const TCHAR* Get() { return TEXT(#Type); } \
+    };
+
+NUMBSKULL_TYPE_NAME(bool)
+NUMBSKULL_TYPE_NAME(int8)
+NUMBSKULL_TYPE_NAME(int16)
+NUMBSKULL_TYPE_NAME(int32)
+NUMBSKULL_TYPE_NAME(int64)
+NUMBSKULL_TYPE_NAME(uint8)
+NUMBSKULL_TYPE_NAME(uint16)
+NUMBSKULL_TYPE_NAME(uint32)
+NUMBSKULL_TYPE_NAME(uint64)
+NUMBSKULL_TYPE_NAME(float)
+NUMBSKULL_TYPE_NAME(double)
+NUMBSKULL_TYPE_NAME(FText)
+NUMBSKULL_TYPE_NAME(FGuid)
+NUMBSKULL_TYPE_NAME(FDateTime)
+NUMBSKULL_TYPE_NAME(FTimespan)
+NUMBSKULL_TYPE_NAME(FVector)
+NUMBSKULL_TYPE_NAME(FVector2D)
+NUMBSKULL_TYPE_NAME(FVector4)
+NUMBSKULL_TYPE_NAME(FIntPoint)
+NUMBSKULL_TYPE_NAME(FIntVector)
+NUMBSKULL_TYPE_NAME(FRotator)
+NUMBSKULL_TYPE_NAME(FQuat)
+NUMBSKULL_TYPE_NAME(FTransform)
+NUMBSKULL_TYPE_NAME(FColor)
+NUMBSKULL_TYPE_NAME(FLinearColor)
+
+/** What a field's type contributes to the schema hash*/
+template <typename Type, bool bHasFields = TNumbskullFields<Type>::bDefined>
+struct TNumbskullTypeHash
+{
+    static uint32 Get()
+    {
+        static_assert(TNumbskullTypeName<Type>::bDefined, "Name the field's type for the schema hash with NUMBSKULL_TYPE_NAME");
+        return FCrc::StrCrc32(TNumbskullTypeName<Type>::Get(), sizeof(Type));
+    }
+};
+
+template <typename Type>
+struct TNumbskullTypeHash<Type, true>
+{
+    static uint32 Get();
+};
+
+template <typename ElementType, typename AllocatorType>
+struct TNumbskullTypeHash<TArray<ElementType, AllocatorType>, false>
+{
+    static uint32 Get() { return FCrc::StrCrc32(TEXT("TArray"), TNumbskullTypeHash<ElementType>::Get()); }
+};
+
+template <>
+struct TNumbskullTypeHash<FString, false>
+{
+    static uint32 Get() { return FCrc::StrCrc32(TEXT("FString")); }
+};
+
+template <>
+struct TNumbskullTypeHash<FName, false>
+{
+    static uint32 Get() { return FCrc::StrCrc32(TEXT("FName")); }
+};
+
+/**
+ * Serializes native types field by field with straight line code, instead of through reflection and tagged properties.
+ *
+ * Much faster than the tagged path for small, hot types such as inventory slots and stat blocks, but there's no tolerance
+ * for change: data only loads into the fields it was saved with. Save and Load prefix the data with a schema hash of the
+ * field names and types so a mismatch fails cleanly, and operator<< is defined for every type with fields so they can be
+ * serialized from a native Serialize override or nested in each other without the hash:
+ *
+ * void AMerchant::Serialize(FArchive& Ar)
+ * {
+ *     Super::Serialize(Ar);
+ *     TNumbskullSerializer<FInventorySlot>::SerializeArrayChecked(Ar, Stock);
+ * }
+ */
+template <typename Type>
+struct TNumbskullSerializer
+{
+    static_assert(TNumbskullFields<Type>::bDefined, "Declare the fields of the type with NUMBSKULL_SERIALIZER_FIELDS");
+
+    /** Reads or writes every field*/
+    static FORCEINLINE void Serialize(FArchive& Ar, Type& Value)
+    {
+        FSerializeVisitor Visitor{ Ar, Value };
+        TNumbskullFields<Type>::Get().Visit(Visitor);
+    }
+
+    /** Hash of the field names and types, in order*/
+    static uint32 GetSchemaHash()
+    {
+        static const uint32 SchemaHash = MakeSchemaHash();
+        return SchemaHash;
+    }
+
+    /** Serializes a value after its schema hash. Sets an error when loading data with a different schema*/
+    static void SerializeChecked(FArchive& Ar, Type& Value)
+    {
+        if (SerializeSchemaHash(Ar))
+        {
+            Serialize(Ar, Value);
+        }
+    }
+
+    /** Serializes an array after the schema hash of its elements. Sets an error when loading data with a different schema*/
+    template <typename AllocatorType>
+    static void SerializeArrayChecked(FArchive& Ar, TArray<Type, AllocatorType>& Values)
+    {
+        if (!SerializeSchemaHash(Ar))
+        {
+            return;
+        }
+
+        int32 Num = Values.Num();
+        Ar << Num;
+
+        if (Ar.IsLoading())
+        {
+            // Every element takes at least a byte, so a count larger than what's left is corrupt
+            if (Num < 0 || (Ar.TotalSize() >= 0 && Num > Ar.TotalSize() - Ar.Tell()))
+            {
+                Ar.SetError();
+                return;
+            }
+
+            Values.SetNum(Num, false);
+        }
+
+        for (int32 Index = 0; Index < Num && !Ar.IsError(); ++Index)
+        {
+            Serialize(Ar, Values[Index]);
+        }
+    }
+
+    /** Serializes a value into object data*/
+    static bool Save(const Type& InValue, FObjectData& OutObjectData)
+    {
+        TArray<uint8> Bytes;
+        FMemoryWriter Writer(Bytes, true);
+        SerializeChecked(Writer, const_cast<Type&>(InValue));
+
+        OutObjectData = FObjectData();
+        OutObjectData.Data = MoveTemp(Bytes);
+        return !Writer.IsError();
+    }
+
+    /** Loads a value saved with Save. Fails if the type's fields have changed since*/
+    static bool Load(const FObjectData& InObjectData, Type& OutValue)
+    {
+        FMemoryReader Reader(InObjectData.Data.Get(), true);
+        SerializeChecked(Reader, OutValue);
+        return !Reader.IsError() && Reader.AtEnd();
+    }
+
+    /** Serializes an array into object data*/
+    template <typename AllocatorType>
+    static bool SaveArray(const TArray<Type, AllocatorType>& InValues, FObjectData& OutObjectData)
+    {
+        TArray<uint8> Bytes;
+        FMemoryWriter Writer(Bytes, true);
+        SerializeArrayChecked(Writer, const_cast<TArray<Type, AllocatorType>&>(InValues));
+
+        OutObjectData = FObjectData();
+        OutObjectData.Data = MoveTemp(Bytes);
+        return !Writer.IsError();
+    }
+
+    /** Loads an array saved with SaveArray, keeping its allocation. Fails if the type's fields have changed since*/
+    template <typename AllocatorType>
+    static bool LoadArray(const FObjectData& InObjectData, TArray<Type, AllocatorType>& OutValues)
+    {
+        FMemoryReader Reader(InObjectData.Data.Get(), true);
+        SerializeArrayChecked(Reader, OutValues);
+        return !Reader.IsError() && Reader.AtEnd();
+    }
+
+private:
+
+    struct FSerializeVisitor
+    {
+        FArchive& Ar;
+
+        Type& Value;
+
+        template <typename ClassType, typename MemberType>
+        FORCEINLINE void operator()(const TNumbskullField<ClassType, MemberType>& Field)
+        {
+            Ar << (Value.*Field.Member);
+        }
+    };
+
+    struct FHashVisitor
+    {
+        uint32 Hash;
+
+        template <typename ClassType, typename MemberType>
+        void operator()(const TNumbskullField<ClassType, MemberType>& Field)
+        {
+            const uint32 TypeHash = TNumbskullTypeHash<MemberType>::Get();
+            Hash = FCrc::StrCrc32(Field.Name, Hash);
+            Hash = FCrc::MemCrc32(&TypeHash, sizeof(TypeHash), Hash);
+        }
+    };
+
+    static uint32 MakeSchemaHash()
+    {
+        FHashVisitor Visitor{ 0 };
+        TNumbskullFields<Type>::Get().Visit(Visitor);
+        return Visitor.Hash;
+    }
+
+    static bool SerializeSchemaHash(FArchive& Ar)
+    {
+        uint32 SchemaHash = GetSchemaHash();
+        Ar << SchemaHash;
+
+        if (Ar.IsLoading() && SchemaHash != GetSchemaHash())
+        {
+            Ar.SetError();
+            return false;
+        }
+
+        return !Ar.IsError();
+    }
+};
+
+template <typename Type>
+uint32 TNumbskullTypeHash<Type, true>::Get()
+{
+    return TNumbskullSerializer<Type>::GetSchemaHash();
+}
+
+/** Serializes any type with fields declared by NUMBSKULL_SERIALIZER_FIELDS, without a schema hash*/
+template <typename Type>
+FORCEINLINE typename TEnableIf<TNumbskullFields<Type>::bDefined, FArchive&>::Type operator<<(FArchive& Ar, Type& Value)
+{
+    TNumbskullSerializer<Type>::Serialize(Ar, Value);
+    return Ar;
+}
@@ -0,0 +1,89 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/StructuredArchive.h"
+#include "NumbskullPayload.generated.h"
+
+struct FPropertyTag;
+
+/**
+ * Serialized bytes shared between every copy of a storage type.
+ *
+ * Copying a payload (for example when Blueprint passes FObjectData by value) only bumps a reference count instead of
+ * copying the bytes. The bytes are immutable while shared; GetMutable copies them first if another payload still holds them.
+ *
+ * Reads like a const TArray<uint8> and serializes exactly like one, so files and operator<< streams keep their layout.
+ * Properties saved while these were TArray<uint8> load into a payload through SerializeFromMismatchedTag. Code that
+ * changed the array in place has to go through GetMutable now, and Blueprint reads the bytes with GetPayloadBytes.
+ */
+USTRUCT(BlueprintType)
+struct NUMBSKULLSERIALIZATION_API FNumbskullPayload
+{
+    GENERATED_BODY()
+
+    FNumbskullPayload() = default;
+    FNumbskullPayload(const TArray<uint8>& InBytes);
+    FNumbskullPayload(TArray<uint8>&& InBytes);
+
+    FNumbskullPayload& operator=(const TArray<uint8>& InBytes);
+    FNumbskullPayload& operator=(TArray<uint8>&& InBytes);
+
+    /** The bytes. Empty if there are none*/
+    const TArray<uint8>& Get() const;
+
+    operator const TArray<uint8>&() const { return Get(); }
+
+    /** The bytes, ready to change. Copies them first if they're shared with another payload*/
+    TArray<uint8>& GetMutable();
+
+    /** Takes the bytes out of the payload, without copying them if nothing else shares them*/
+    TArray<uint8> MoveToArray();
+
+    const uint8* GetData() const { return Get().GetData(); }
+
+    int32 Num() const { return Get().Num(); }
+
+    const uint8& operator[](int32 Index) const { return Get()[Index]; }
+
+    /** Range for support, read only*/
+    auto begin() const { return Get().begin(); }
+    auto end() const { return Get().end(); }
+
+    /** Whether no other payload shares the bytes*/
+    bool IsUnique() const { return !Buffer.IsValid() || Buffer.IsUnique(); }
+
+    void Reset() { Buffer.Reset(); }
+
+    bool Serialize(FArchive& Ar);
+
+    /** Loads bytes whose count was already read, for streams that check the count for a marker first. Sets an error if it's corrupt*/
+    void LoadBytes(FArchive& Ar, int32 InNumBytes);
+
+    /** Loads properties saved as a TArray<uint8>, before storage types held payloads*/
+    bool SerializeFromMismatchedTag(const FPropertyTag& Tag, FStructuredArchive::FSlot Slot);
+
+    bool operator==(const FNumbskullPayload& Other) const;
+
+    friend FArchive& operator << (FArchive& Ar, FNumbskullPayload& Payload)
+    {
+        Payload.Serialize(Ar);
+        return Ar;
+    }
+
+private:
+
+    TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Buffer;
+};
+
+template<>
+struct TStructOpsTypeTraits<FNumbskullPayload> : public TStructOpsTypeTraitsBase2<FNumbskullPayload>
+{
+    enum
+    {
+        WithSerializer = true,
+        WithIdenticalViaEquality = true,
+        WithStructuredSerializeFromMismatchedTag = true,
+    };
+};
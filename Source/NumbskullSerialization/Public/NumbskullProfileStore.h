@@ -0,0 +1,211 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "ObjectData.h"
+
+/**
+ * How a profile store lays out and writes its files.
+ */
+struct NUMBSKULLSERIALIZATION_API FNumbskullProfileStoreConfig
+{
+    /** Directory the shard directories are created in*/
+    FString RootDirectory;
+
+    /** Directories profiles are spread across, so no single directory holds thousands of files*/
+    int32 NumShards = 256;
+
+    /** How long a profile waits before it's written. Saves of the same profile in this time replace each other*/
+    float CoalesceSeconds = 5.0f;
+
+    /** Background threads writing profiles. Each profile is always written by the same thread*/
+    int32 NumWriters = 2;
+
+    /** Most profiles waiting to be written before saving blocks (or TrySave fails) until some are written*/
+    int32 MaxQueuedProfiles = 4096;
+
+    /** Whether profiles are written compressed*/
+    bool bCompress = true;
+};
+
+/**
+ * Counters describing what a profile store has done.
+ */
+struct NUMBSKULLSERIALIZATION_API FNumbskullProfileStoreStats
+{
+    /** Calls to Save or TrySave that were accepted*/
+    int64 Saves = 0;
+
+    /** Saves that replaced a profile still waiting to be written*/
+    int64 Coalesced = 0;
+
+    /** Saves that had to wait for room in the queue, or TrySaves that failed for lack of it*/
+    int64 Blocked = 0;
+
+    /** Profile files written*/
+    int64 Written = 0;
+
+    /** Profile files that failed to write*/
+    int64 Failed = 0;
+
+    /** Profiles waiting to be written or being written*/
+    int32 Queued = 0;
+};
+
+/**
+ * Persists many player profiles, such as on a dedicated server, without writing files on the game thread.
+ *
+ * Saving a profile only queues it. After CoalesceSeconds a pool of background writers writes it to a shard directory
+ * picked from a hash of its ID; saves of the same profile before then replace the queued one, so the last save wins and
+ * a profile checkpointed every few seconds is only written once per window. The queue is bounded: once it's full, writers
+ * stop waiting out the window and Save blocks until there's room, which keeps memory in check when saves outpace the disk.
+ *
+ * Loading sees queued saves before they're written. Files are replaced through a temporary file that's flushed to the disk
+ * first, so a crash or power cut mid-write leaves the previous save intact. Thread safe. Queued profiles are written when the store is destroyed.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullProfileStore
+{
+public:
+
+    explicit FNumbskullProfileStore(const FNumbskullProfileStoreConfig& InConfig);
+
+    ~FNumbskullProfileStore();
+
+    /**
+     * Queues a profile to be written, waiting for room in the queue if it's full.
+     *
+     * @param InProfileId Unique ID of the profile. Characters that aren't valid in file names are replaced.
+     * @param InObjectData The profile's data. Shares its payload rather than copying it.
+     *
+     * @return False if the ID is empty or there's no data
+     */
+    bool Save(const FString& InProfileId, const FObjectData& InObjectData);
+
+    /** Queues a profile to be written like Save, but returns false instead of waiting if the queue is full*/
+    bool TrySave(const FString& InProfileId, const FObjectData& InObjectData);
+
+    /**
+     * Loads a profile, including a save that's still queued.
+     *
+     * @return False if the profile has never been saved or couldn't be read
+     */
+    bool Load(const FString& InProfileId, FObjectData& OutObjectData) const;
+
+    /**
+     * Loads every profile in the store in parallel, such as when a server starts.
+     *
+     * @param OutProfiles Each profile by ID.
+     *
+     * @return Number of profiles that failed to load
+     */
+    int32 LoadAll(TMap<FString, FObjectData>& OutProfiles) const;
+
+    /** Writes every queued profile now and waits until they're on disk*/
+    void Flush();
+
+    /** File a profile is written to*/
+    FString GetProfileFileName(const FString& InProfileId) const;
+
+    FNumbskullProfileStoreStats GetStats() const;
+
+    /** Extension of profile files*/
+    static const TCHAR* Extension;
+
+private:
+
+    struct FQueuedProfile
+    {
+        FObjectData ObjectData;
+
+        /** When it's written unless the queue is full or flushing*/
+        double DueTime = 0.0;
+    };
+
+    /** Writes the profiles of the shards assigned to it, oldest first*/
+    class FWriter : public FRunnable
+    {
+    public:
+
+        FWriter(FNumbskullProfileStore& InStore);
+
+        virtual ~FWriter();
+
+        virtual uint32 Run() override;
+
+        virtual void Stop() override;
+
+        /** Queues or replaces a profile. Returns false if it would need a new slot and there's none*/
+        bool Enqueue(const FString& InProfileId, const FObjectData& InObjectData, bool& bOutCoalesced);
+
+        bool Find(const FString& InProfileId, FObjectData& OutObjectData) const;
+
+        /** Adds the profiles waiting or being written, which are newer than what's on disk*/
+        void GetQueued(TMap<FString, FObjectData>& OutProfiles) const;
+
+        void Wake() { WakeEvent->Trigger(); }
+
+        FRunnableThread* Thread = nullptr;
+
+    private:
+
+        /** Writes the oldest profile if it's due. Returns false with how long to wait if there's nothing to write yet*/
+        bool WriteNext(double& OutWaitSeconds);
+
+        FNumbskullProfileStore& Store;
+
+        mutable FCriticalSection CriticalSection;
+
+        TMap<FString, FQueuedProfile> Queued;
+
+        /** IDs in Queued, oldest first*/
+        TArray<FString> Order;
+
+        /** Index in Order of the oldest profile that hasn't been written*/
+        int32 OrderStart = 0;
+
+        /** Profile being written. Kept so loads still see it until it's on disk*/
+        FString WritingId;
+
+        FObjectData WritingData;
+
+        FEvent* WakeEvent = nullptr;
+
+        TAtomic<bool> bStopping;
+    };
+
+    bool SaveInternal(const FString& InProfileId, const FObjectData& InObjectData, bool bWait);
+
+    FWriter& GetWriter(const FString& InProfileId) const;
+
+    /** Shard a profile belongs to*/
+    int32 GetShard(const FString& InProfileId) const;
+
+    /** Takes a slot in the queue. False if it's full*/
+    bool ReserveSlot();
+
+    void ReleaseSlot();
+
+    /** Whether writers should write profiles before they're due*/
+    bool ShouldWriteEarly() const { return FlushRequests > 0 || NumQueued >= Config.MaxQueuedProfiles; }
+
+    bool WriteProfile(const FString& InProfileId, const FObjectData& InObjectData);
+
+    FNumbskullProfileStoreConfig Config;
+
+    TArray<TUniquePtr<FWriter>> Writers;
+
+    /** Profiles waiting or being written across all writers*/
+    TAtomic<int32> NumQueued;
+
+    /** Flushes in progress*/
+    TAtomic<int32> FlushRequests;
+
+    /** Triggered whenever a profile is written, so blocked saves and flushes can check again*/
+    FEvent* WrittenEvent = nullptr;
+
+    mutable FCriticalSection StatsCriticalSection;
+
+    FNumbskullProfileStoreStats Stats;
+};
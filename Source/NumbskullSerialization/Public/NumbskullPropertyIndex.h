@@ -0,0 +1,115 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NumbskullPropertyIndex.generated.h"
+
+struct FNumbskullReferenceTable;
+
+/**
+ * Where a property's tag starts in serialized data.
+ */
+USTRUCT()
+struct NUMBSKULLSERIALIZATION_API FNumbskullIndexedProperty
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    FName Name;
+
+    /** Element of a fixed size array property*/
+    UPROPERTY()
+    int32 ArrayIndex = 0;
+
+    /** Offset of the property's tag from the start of the serialized data*/
+    UPROPERTY()
+    int32 TagOffset = 0;
+
+    friend FArchive& operator << (FArchive& Ar, FNumbskullIndexedProperty& Property)
+    {
+        Ar << Property.Name;
+        Ar << Property.ArrayIndex;
+        Ar << Property.TagOffset;
+        return Ar;
+    }
+};
+
+/**
+ * Index of the properties written into serialized data, built when it's saved.
+ *
+ * Lets a single property be read straight out of the data without applying it to an object. Objects only serialize
+ * properties that differ from their class defaults, so a property missing from a valid index has its default value.
+ */
+USTRUCT()
+struct NUMBSKULLSERIALIZATION_API FNumbskullPropertyIndex
+{
+    GENERATED_BODY()
+
+    /** Index into Properties of each serialized object's first property. Empty if the data isn't indexed*/
+    UPROPERTY()
+    TArray<int32> ObjectStarts;
+
+    /** Every property of every object, in the order they were serialized*/
+    UPROPERTY()
+    TArray<FNumbskullIndexedProperty> Properties;
+
+    /** Whether the data was indexed when it was saved*/
+    bool IsValid() const { return ObjectStarts.Num() > 0; }
+
+    /** Number of objects in the data*/
+    int32 NumObjects() const { return ObjectStarts.Num(); }
+
+    void Reset();
+
+    /**
+     * Indexes serialized data by scanning its property tags, skipping over the values.
+     *
+     * @param InData Data written by the library's archive.
+     * @param InObjectOffsets Where each object's data starts, in the order they were serialized.
+     *
+     * @return False if the data couldn't be scanned, which leaves the index empty
+     */
+    bool Build(const TArray<uint8>& InData, const TArray<int32>& InObjectOffsets);
+
+    /** Finds a property of an object in the index. Null if it wasn't serialized*/
+    const FNumbskullIndexedProperty* Find(int32 InObjectIndex, FName InName, int32 InArrayIndex = 0) const;
+
+    /**
+     * Reads one property out of serialized data without touching a live object.
+     *
+     * Object references stored in a reference table only resolve if they're outside the data's objects.
+     *
+     * @param InData The indexed data.
+     * @param InReferences Reference table the data was saved with.
+     * @param InObjectIndex Which serialized object to read from.
+     * @param InClass Class of the object, whose defaults fill in properties that weren't serialized.
+     * @param InProperty Property to read. Must belong to the class.
+     * @param OutValue Initialized memory for one element of the property. Left as the class default if it wasn't serialized.
+     * @param InArrayIndex Element of a fixed size array property.
+     *
+     * @return True if the value was read or is the default, false if otherwise
+     */
+    bool ReadProperty(const TArray<uint8>& InData, const FNumbskullReferenceTable& InReferences, int32 InObjectIndex, UClass* InClass, const FProperty* InProperty, void* OutValue, int32 InArrayIndex = 0) const;
+
+    /**
+     * Reads properties out of serialized data as text, without touching a live object.
+     *
+     * @param InData The indexed data.
+     * @param InReferences Reference table the data was saved with.
+     * @param InObjectIndex Which serialized object to read from.
+     * @param InClass Class of the object.
+     * @param InPropertyNames Properties to read.
+     * @param OutValues Value of each property that could be read, exported as text.
+     *
+     * @return True if every property was read, false if otherwise
+     */
+    bool ReadPropertiesAsText(const TArray<uint8>& InData, const FNumbskullReferenceTable& InReferences, int32 InObjectIndex, UClass* InClass, const TArray<FName>& InPropertyNames, TMap<FName, FString>& OutValues) const;
+
+    friend FArchive& operator << (FArchive& Ar, FNumbskullPropertyIndex& Index)
+    {
+        Ar << Index.ObjectStarts;
+        Ar << Index.Properties;
+        return Ar;
+    }
+};
@@ -0,0 +1,168 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Tickable.h"
+#include "ActorProxy.h"
+#include "ActorProxyBatch.h"
+#include "NumbskullProxyManager.generated.h"
+
+/**
+ * Keeps loaded actor proxies dormant until a viewer comes near them, instead of spawning every actor straight after a load.
+ *
+ * Proxies are indexed in a uniform grid over their location. Each tick, dormant proxies within RelevanceRadius of a viewer
+ * are spawned with LoadActor, closest first and at most MaxSpawnsPerTick at a time. Spawned actors further than
+ * ReleaseRadius from every viewer are captured back into proxies with SaveActor and destroyed, re-indexed wherever they
+ * moved to. The gap between the two radii stops actors on the edge from being spawned and released every tick.
+ *
+ * Viewers are the actors added with AddViewer, plus every player's view point when bUsePlayerViewPoints is set.
+ * Actors destroyed by the game while spawned are forgotten. GetProxies captures everything, spawned or not, for saving.
+ * A proxy that fails to spawn is kept as it is and tried again after SpawnRetryDelay, waiting twice as long after each
+ * failure in a row, so it's still saved and isn't retried every tick. Proxies without a class or data are never spawned.
+ */
+UCLASS(BlueprintType)
+class NUMBSKULLSERIALIZATION_API UNumbskullProxyManager : public UObject, public FTickableGameObject
+{
+    GENERATED_BODY()
+
+public:
+
+    /**
+     * Creates a proxy manager for a world. The world keeps the manager alive until it's torn down or DestroyManager is
+     * called, so it doesn't need to be held anywhere else.
+     *
+     * @param WorldContextObject Object in the world the actors are spawned in.
+     * @param InRelevanceRadius Distance from a viewer within which proxies are spawned.
+     * @param InCellSize Size of each grid cell. Around the relevance radius works well.
+     *
+     * @return The new proxy manager
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies", meta = (WorldContext = "WorldContextObject"))
+    static UNumbskullProxyManager* CreateProxyManager(UObject* WorldContextObject, float InRelevanceRadius = 10000.0f, float InCellSize = 10000.0f);
+
+    /** Adds proxies to be spawned when a viewer comes near them*/
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies")
+    void AddProxies(const TArray<FActorProxy>& InActorProxies);
+
+    /**
+     * Adds every proxy in a batch to be spawned when a viewer comes near them.
+     *
+     * @return False if the batch couldn't be broken into proxies
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies")
+    bool AddProxyBatch(const FActorProxyBatch& InActorProxyBatch);
+
+    /**
+     * Captures every proxy, spawning actors or not, such as for saving. Spawned actors are captured with SaveActor and stay spawned.
+     *
+     * @param OutActorProxies Every proxy the manager has.
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies")
+    void GetProxies(TArray<FActorProxy>& OutActorProxies) const;
+
+    /** Destroys every spawned actor and forgets every proxy, such as before loading another save*/
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies")
+    void Reset();
+
+    /** Resets the manager and lets its world release it. The manager stops updating and mustn't be used afterwards*/
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies")
+    void DestroyManager();
+
+    /** Adds an actor whose location spawns proxies near it*/
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies")
+    void AddViewer(AActor* InViewer);
+
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies")
+    void RemoveViewer(AActor* InViewer);
+
+    /** Spawns and releases actors for the viewers' current locations. Called every tick*/
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Proxies")
+    void Update();
+
+    /** Number of proxies with a spawned actor*/
+    UFUNCTION(BlueprintPure, Category = "Numbskull|Proxies")
+    int32 GetNumSpawned() const { return SpawnedEntries.Num(); }
+
+    /** Number of proxies waiting for a viewer to come near*/
+    UFUNCTION(BlueprintPure, Category = "Numbskull|Proxies")
+    int32 GetNumDormant() const { return Entries.Num() - SpawnedEntries.Num(); }
+
+    /** Distance from a viewer within which proxies are spawned*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Numbskull|Proxies", meta = (ClampMin = "0"))
+    float RelevanceRadius = 10000.0f;
+
+    /** Distance from every viewer beyond which spawned actors are released. Kept at least RelevanceRadius*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Numbskull|Proxies", meta = (ClampMin = "0"))
+    float ReleaseRadius = 12000.0f;
+
+    /** Most actors spawned in a single tick, to spread the cost of a viewer arriving somewhere busy. Zero for no limit*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Numbskull|Proxies", meta = (ClampMin = "0"))
+    int32 MaxSpawnsPerTick = 16;
+
+    /** Seconds before a proxy that failed to spawn is tried again. Doubles with each failure in a row, up to a minute*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Numbskull|Proxies", meta = (ClampMin = "0"))
+    float SpawnRetryDelay = 5.0f;
+
+    /** Whether every player's view point is a viewer, on top of the actors added with AddViewer*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Numbskull|Proxies")
+    bool bUsePlayerViewPoints = true;
+
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual bool IsTickable() const override;
+    virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+    virtual TStatId GetStatId() const override;
+
+    virtual UWorld* GetWorld() const override;
+
+private:
+
+    struct FEntry
+    {
+        FActorProxy ActorProxy;
+
+        /** Set while the proxy is spawned*/
+        TWeakObjectPtr<AActor> Actor;
+
+        /** Grid cell the proxy is indexed in, while it's dormant*/
+        FIntPoint Cell = FIntPoint::ZeroValue;
+
+        /** Spawns that failed in a row*/
+        int32 NumFailedSpawns = 0;
+
+        /** World time before which the proxy isn't spawned, after a failed spawn*/
+        float RetryTime = 0.0f;
+    };
+
+    FIntPoint GetCell(const FVector& InLocation) const;
+
+    void AddEntry(const FActorProxy& InActorProxy);
+
+    /** Adds a dormant entry to the grid*/
+    void IndexEntry(int32 InEntry);
+
+    void UnindexEntry(int32 InEntry);
+
+    bool SpawnEntry(int32 InEntry);
+
+    /** Captures a spawned entry back into its proxy and destroys the actor*/
+    void ReleaseEntry(int32 InEntry);
+
+    void GetViewerLocations(TArray<FVector>& OutLocations) const;
+
+    /** Proxies, spawned or not. Indices stay valid as entries are removed*/
+    TSparseArray<FEntry> Entries;
+
+    /** Dormant entries in each grid cell*/
+    TMap<FIntPoint, TArray<int32>> Grid;
+
+    TSet<int32> SpawnedEntries;
+
+    TArray<TWeakObjectPtr<AActor>> Viewers;
+
+    float CellSize = 10000.0f;
+
+    TWeakObjectPtr<UWorld> World;
+};
@@ -0,0 +1,133 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+#include "NumbskullReferenceTable.generated.h"
+
+/**
+ * An object referenced from serialized data.
+ *
+ * Objects that were saved in the same snapshot (or live inside one, like components) are stored by the snapshot's ordinal,
+ * so the reference survives the object being spawned with a different name. Anything else is stored by path.
+ */
+USTRUCT()
+struct NUMBSKULLSERIALIZATION_API FNumbskullObjectReference
+{
+    GENERATED_BODY()
+
+    /** Index of the snapshot object the reference points to (or lives inside). INDEX_NONE if it's outside the snapshot*/
+    UPROPERTY()
+    int32 SnapshotIndex = INDEX_NONE;
+
+    /** Full path of the object, or its path relative to the snapshot object. Empty when it is the snapshot object itself*/
+    UPROPERTY()
+    FString ObjectPath;
+
+    friend FArchive& operator << (FArchive& Ar, FNumbskullObjectReference& Reference)
+    {
+        Ar << Reference.SnapshotIndex;
+        Ar << Reference.ObjectPath;
+        return Ar;
+    }
+};
+
+/**
+ * Every object referenced from a set of serialized data. The data stores indices into this table instead of paths.
+ */
+USTRUCT()
+struct NUMBSKULLSERIALIZATION_API FNumbskullReferenceTable
+{
+    GENERATED_BODY()
+
+    /** Whether the serialized data was written with reference IDs. Data without a table stores paths inline*/
+    UPROPERTY()
+    bool bEnabled = false;
+
+    /** Referenced objects. The ID written in the data is the index into this array*/
+    UPROPERTY()
+    TArray<FNumbskullObjectReference> References;
+
+    friend FArchive& operator << (FArchive& Ar, FNumbskullReferenceTable& Table)
+    {
+        Ar << Table.bEnabled;
+        Ar << Table.References;
+        return Ar;
+    }
+};
+
+/**
+ * IDs written in place of object references.
+ */
+namespace ENumbskullReferenceId
+{
+    enum Type : int32
+    {
+        /** Null reference*/
+        Null = -1,
+    };
+}
+
+/**
+ * Builds a reference table while saving.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullReferenceWriter
+{
+public:
+
+    /**
+     * @param InTable Table to fill. Must outlive the writer.
+     * @param InSnapshotObjects Objects being saved together, in the order they will be loaded.
+     */
+    FNumbskullReferenceWriter(FNumbskullReferenceTable& InTable, const TArray<UObject*>& InSnapshotObjects);
+
+    /** Returns the ID for an object, adding it to the table if needed*/
+    int32 GetReferenceId(UObject* InObject);
+
+private:
+
+    FNumbskullReferenceTable& Table;
+
+    TMap<UObject*, int32> SnapshotIndices;
+
+    TMap<UObject*, int32> ReferenceIds;
+};
+
+/**
+ * Resolves object references while loading. Every snapshot object must exist before any data is read, so references are
+ * written straight into the value being loaded, wherever it lives.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullReferenceReader
+{
+public:
+
+    /**
+     * @param InTable Table the data was saved with. Must outlive the reader.
+     * @param InSnapshotObjects Objects being loaded, in the order they were saved. Null for objects that weren't loaded.
+     * @param bInLoadIfFindFails Whether to load objects outside the snapshot that aren't in memory.
+     */
+    FNumbskullReferenceReader(const FNumbskullReferenceTable& InTable, const TArray<UObject*>& InSnapshotObjects, bool bInLoadIfFindFails = true);
+
+    /** Resolves a table entry, looking it up only the first time it's referenced. Null if it couldn't be resolved*/
+    UObject* ResolveId(int32 InReferenceId);
+
+    /** Number of table entries that were referenced but couldn't be resolved*/
+    int32 GetNumUnresolved() const { return NumUnresolved; }
+
+private:
+
+    UObject* ResolveReference(const FNumbskullObjectReference& InReference) const;
+
+    const FNumbskullReferenceTable& Table;
+
+    TArray<UObject*> SnapshotObjects;
+
+    bool bLoadIfFindFails;
+
+    TArray<UObject*> Resolved;
+
+    TBitArray<> IsResolved;
+
+    int32 NumUnresolved = 0;
+};
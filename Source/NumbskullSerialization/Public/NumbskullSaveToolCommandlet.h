@@ -0,0 +1,44 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "NumbskullSaveToolCommandlet.generated.h"
+
+/**
+ * Verifies, recompresses or upgrades every save file in a directory without booting the game, or trains a compression
+ * dictionary on them.
+ *
+ * Files are processed in parallel across all cores and rewritten in place through a temporary file, only after the
+ * rewritten file has been decoded again and matches. Runs headless, for example:
+ *
+ * UE4Editor-Cmd MyGame.uproject -run=NumbskullSaveTool -Dir=/saves -Type=ObjectData -Mode=Recompress -Codec=LZ4 -nullrhi
+ *
+ * -Dir=        Directory to search recursively. Required.
+ * -Filter=     Wildcard of files to process. Defaults to *
+ * -Type=       Storage type of the files: ObjectData, ActorData, ActorProxy or ActorProxyBatch. Defaults to ObjectData
+ * -Mode=       Verify, Recompress, Upgrade or Train. Defaults to Verify
+ * -Codec=      Recompress only. Compression format such as Zlib, Gzip or LZ4, or None. Defaults to the project setting
+ * -Bias=       Recompress and Train. Default, Speed or Size. Defaults to the project setting
+ * -Dictionary= Recompress: dictionary to compress against, or None. Train: name to save the dictionary as.
+ *              Defaults to the project setting
+ * -DictSize=   Train only. Most bytes the dictionary can have. Defaults to 32768
+ * -Report=     Writes per-file stats to a CSV file
+ * -DryRun      Does everything except replace the files or save the dictionary
+ * -Force       Rewrites files that are already in the requested format
+ * -Verbose     Logs stats for every file, not just failures
+ *
+ * Returns 0 if every file succeeded, 1 if otherwise.
+ */
+UCLASS()
+class NUMBSKULLSERIALIZATION_API UNumbskullSaveToolCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+
+    UNumbskullSaveToolCommandlet();
+
+    virtual int32 Main(const FString& Params) override;
+};
@@ -6,13 +6,20 @@
 
 // Storage Types
 #include "ActorProxy.h"
+#include "ActorProxyBatch.h"
 #include "ObjectData.h"
 #include "ActorData.h"
 
+#include "NumbskullLoadCache.h"
+#include "NumbskullSizeReport.h"
+
 #include "NumbskullSerializationBPLibrary.generated.h"
 
 class FBufferArchive;
 class FMemoryReader;
+struct FNumbskullFileHeader;
+class FNumbskullReferenceWriter;
+class FNumbskullReferenceReader;
 
 DECLARE_LOG_CATEGORY_EXTERN(Serializer, Log, All);
 
@@ -41,6 +48,17 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving")
     static bool Serialize(TArray<uint8>& OutSerializedData, UObject* InObject);
     
+    /**
+     * Serializes a UObject, writing its object references into a reference table.
+     *
+     * @param OutSerializedData Serialized data if serialization was successful.
+     * @param InObject Object to serialize.
+     * @param InReferenceWriter Table to write references to. Null writes references as paths.
+     *
+     * @return True if successful, false if otherwise
+     */
+    static bool Serialize(TArray<uint8>& OutSerializedData, UObject* InObject, FNumbskullReferenceWriter* InReferenceWriter);
+    
     /**
      * Applies serialized data to an object.
      *
@@ -53,7 +71,44 @@ public:
     static bool ApplySerialization(const TArray<uint8>& SerializedData, UObject* InObject);
     
     /**
-     * Saves an array of bytes to a file.
+     * Applies serialized data held in a larger buffer to an object without copying it out first.
+     *
+     * @param SerializedData Start of the serialized data.
+     * @param NumBytes Size of the serialized data.
+     * @param InObject Object to apply the serialized data to.
+     * @param InBulkData Arrays the data stores out of line, if any.
+     *
+     * @return True if the serialized data was applied successfully, false if otherwise
+     */
+    static bool ApplySerialization(const uint8* SerializedData, int64 NumBytes, UObject* InObject, const FNumbskullBulkData* InBulkData = nullptr);
+    
+    /**
+     * Applies serialized data to an object without calling PostLoad.
+     *
+     * Object references are resolved through the reference reader, so every object in the snapshot must exist before
+     * any of them is applied. Call @see NotifyPostLoad once they all are.
+     *
+     * @param SerializedData Start of the serialized data.
+     * @param NumBytes Size of the serialized data.
+     * @param InObject Object to apply the serialized data to.
+     * @param InReferenceReader Reader to resolve references with. Null if the data stores references as paths.
+     * @param InBulkData Arrays the data stores out of line, if any.
+     *
+     * @return True if the serialized data was applied successfully, false if the object couldn't take it or reading failed
+     *         part way, which leaves the object partly applied
+     */
+    static bool ApplySerializationDeferred(const uint8* SerializedData, int64 NumBytes, UObject* InObject, FNumbskullReferenceReader* InReferenceReader, const FNumbskullBulkData* InBulkData = nullptr);
+    
+    /**
+     * Calls PostLoad on an object if it implements @see IPostLoadListener.
+     *
+     * @param InObject Object that has finished loading.
+     */
+    static void NotifyPostLoad(UObject* InObject);
+    
+    /**
+     * Saves an array of bytes to a file. The bytes are written to a temporary file and flushed to the disk, then renamed
+     * over the old one, so the file is never left half written and anything hard linked to the old file keeps the old bytes.
      *
      * @param InFileName Full file name and path to save to.
      * @param InBytes Bytes to save to file.
@@ -94,6 +149,51 @@ public:
      */
     static bool SaveArchiveToDiskCompressed(const FString& InFileName, FBufferArchive InArchive);
     
+    /**
+     * Compresses an array of bytes.
+     *
+     * @param InBytes Bytes to compress.
+     * @param OutCompressedBytes The compressed bytes.
+     * @param InFormat Compression format, such as Zlib, Gzip or LZ4.
+     * @param InFlags ECompressionFlags to compress with.
+     */
+    static void CompressBytes(const TArray<uint8>& InBytes, TArray<uint8>& OutCompressedBytes, FName InFormat = NAME_Zlib, uint32 InFlags = 0);
+    
+    /**
+     * Decompresses bytes previously compressed with @see CompressBytes.
+     *
+     * @param InCompressedBytes Bytes to decompress.
+     * @param OutBytes The decompressed bytes.
+     * @param InFormat Format the bytes were compressed with.
+     *
+     * @return True if successful, false if otherwise
+     */
+    static bool DecompressBytes(const TArray<uint8>& InCompressedBytes, TArray<uint8>& OutBytes, FName InFormat = NAME_Zlib);
+    
+    /**
+     * Builds the contents of a file from a header and a payload, compressing the payload if the header asks for it.
+     *
+     * @param InHeader Header describing the format of the payload.
+     * @param InPayload Serialized storage type.
+     * @param OutFileBytes Bytes ready to save to disk.
+     * @param InBulkSection Bulk data section to write, page aligned, after the payload. Never compressed.
+     *
+     * @return True if successful, false if otherwise
+     */
+    static bool EncodeFile(FNumbskullFileHeader& InHeader, const TArray<uint8>& InPayload, TArray<uint8>& OutFileBytes, const TArray<uint8>* InBulkSection = nullptr);
+    
+    /**
+     * Splits the contents of a file into its header and decompressed payload.
+     *
+     * @param InFileBytes Bytes loaded from disk.
+     * @param bLegacyCompressed Whether to decompress files saved before headers were added.
+     * @param OutHeader The file's header, or a legacy header if it has none.
+     * @param OutPayload The decompressed payload.
+     *
+     * @return True if successful, false if otherwise
+     */
+    static bool DecodeFile(const TArray<uint8>& InFileBytes, bool bLegacyCompressed, FNumbskullFileHeader& OutHeader, TArray<uint8>& OutPayload);
+    
     static bool DeleteFile(const FString& FilePath);
     
 public:
@@ -173,6 +273,163 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxy|Compressed")
     static bool LoadActorProxyFromDiskCompressed(const FString& InFileName, FActorProxy& OutActorProxy);
     
+    /**
+     * Serializes an actor without changing its state.
+     *
+     * Possessed pawns stay possessed. Their controller, player state and controller owner are left out of the data
+     * so they don't override the controller of the pawn when it's loaded. @see RestorePossession
+     *
+     * @param OutSerializedData Serialized data of the actor.
+     * @param InActor Actor to serialize.
+     * @param InReferenceWriter Table to write references to. Null writes references as paths.
+     * @param InBulkData Where arrays serialized with FNumbskullBulkData::SerializeArray go. Null writes them inline.
+     *
+     * @return True if successful, false if otherwise
+     */
+    static bool SerializeActor(TArray<uint8>& OutSerializedData, AActor* InActor, FNumbskullReferenceWriter* InReferenceWriter = nullptr, FNumbskullBulkData* InBulkData = nullptr);
+    
+    /**
+     * Finds or loads an actor class from its path name.
+     *
+     * @param InActorClass Path name of the class, as stored in FActorProxy.
+     *
+     * @return The class, or null if it couldn't be found
+     */
+    static UClass* FindActorClass(const FString& InActorClass);
+    
+    /**
+     * Gets the path of the controller possessing a pawn, to store in FActorProxy::PossessedBy.
+     *
+     * @param InActor Actor being saved.
+     *
+     * @return Path of the controller, or empty if the actor isn't a possessed pawn
+     */
+    static FString GetPossessedBy(AActor* InActor);
+    
+    /**
+     * Has the controller that possessed a pawn when it was saved possess it again.
+     *
+     * Nothing happens if the pawn already has a controller (such as an auto possessed AI controller),
+     * the controller no longer exists or it already possesses another pawn.
+     *
+     * @param InLoadedActor Actor that has just been loaded.
+     * @param InPossessedBy Path of the controller saved in FActorProxy::PossessedBy.
+     */
+    static void RestorePossession(AActor* InLoadedActor, const FString& InPossessedBy);
+    
+    /**
+     * Spawns an actor ready to have its serialized data applied.
+     *
+     * @param InWorld World to spawn the actor in.
+     * @param InActorClass Class of the actor.
+     * @param InActorName Requested name of the actor.
+     * @param InActorTransform Transform to spawn the actor at.
+     *
+     * @return The spawned actor, or null if spawning failed
+     */
+    static AActor* SpawnActorForLoad(UWorld* InWorld, UClass* InActorClass, FName InActorName, const FTransform& InActorTransform);
+    
+public:
+    
+    //
+    // ACTOR PROXY BATCHES
+    //
+    
+    /**
+     * Saves many actors into a single columnar batch.
+     *
+     * Equivalent to calling @see SaveActor on each actor, but the result compresses better and loads faster.
+     *
+     * @param InActorsToSave Actors to save. Null actors are skipped.
+     * @param OutActorProxyBatch The resulting batch.
+     *
+     * @return True if the save was successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxyBatch")
+    static bool SaveActors(const TArray<AActor*>& InActorsToSave, FActorProxyBatch& OutActorProxyBatch);
+    
+    /**
+     * Spawns and loads every actor in a batch.
+     *
+     * Each class is looked up once and the output is sized up front.
+     *
+     * @param WorldContextObject Current world context
+     * @param InActorProxyBatch Batch to load.
+     * @param OutLoadedActors Spawned actors, in the same order as the batch. Null where an actor failed to spawn.
+     *
+     * @return True if every actor loaded, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxyBatch", meta=(WorldContext = "WorldContextObject"))
+    static bool LoadActors(const UObject* WorldContextObject, const FActorProxyBatch& InActorProxyBatch, TArray<AActor*>& OutLoadedActors);
+    
+    /**
+     * Packs individual actor proxies into a batch.
+     *
+     * @param InActorProxies Actor proxies to pack.
+     * @param OutActorProxyBatch The resulting batch.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxyBatch")
+    static bool MakeActorProxyBatch(const TArray<FActorProxy>& InActorProxies, FActorProxyBatch& OutActorProxyBatch);
+    
+    /**
+     * Unpacks a batch into individual actor proxies.
+     *
+     * Batches created by @see SaveActors store references in a table shared by the whole batch and can't be unpacked.
+     *
+     * @param InActorProxyBatch Batch to unpack.
+     * @param OutActorProxies The actor proxies in the batch.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxyBatch")
+    static bool BreakActorProxyBatch(const FActorProxyBatch& InActorProxyBatch, TArray<FActorProxy>& OutActorProxies);
+    
+    /**
+     * Saves an actor proxy batch to disk.
+     *
+     * @param InFileName Full file name and path to save to.
+     * @param InActorProxyBatch The batch to save to disk.
+     *
+     * @return True if the save to disk was successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxyBatch")
+    static bool SaveActorProxyBatchToDisk(const FString& InFileName, FActorProxyBatch InActorProxyBatch);
+    
+    /**
+     * Loads an actor proxy batch from disk.
+     *
+     * @param InFileName Full file name and path to load from.
+     * @param OutActorProxyBatch The batch loaded.
+     *
+     * @return True if the load was successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxyBatch")
+    static bool LoadActorProxyBatchFromDisk(const FString& InFileName, FActorProxyBatch& OutActorProxyBatch);
+    
+    /**
+     * Saves an actor proxy batch to disk compressed.
+     *
+     * @param InFileName Full file name and path to save to.
+     * @param InActorProxyBatch The batch to save to disk.
+     *
+     * @return True if the save to disk was successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxyBatch|Compressed")
+    static bool SaveActorProxyBatchToDiskCompressed(const FString& InFileName, FActorProxyBatch InActorProxyBatch);
+    
+    /**
+     * Loads a compressed actor proxy batch from disk.
+     *
+     * @param InFileName Full file name and path to load from.
+     * @param OutActorProxyBatch The batch loaded.
+     *
+     * @return True if the load was successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxyBatch|Compressed")
+    static bool LoadActorProxyBatchFromDiskCompressed(const FString& InFileName, FActorProxyBatch& OutActorProxyBatch);
+    
 public:
     
     //
@@ -218,6 +475,17 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ObjectData")
     static bool SaveObjects(const TArray<UObject*>& InObjects, FObjectData& OutObjectData);
     
+    /**
+     * Saves an array of objects into an FObjectData object, choosing whether to index their properties.
+     *
+     * @param InObjects Array of objects to serialize.
+     * @param OutObjectData The resultant object with binary data.
+     * @param bBuildPropertyIndex Whether to index the properties, for data that's never read with ReadObjectDataProperties.
+     *
+     * @return True if successful, false if otherwise
+     */
+    static bool SaveObjects(const TArray<UObject*>& InObjects, FObjectData& OutObjectData, bool bBuildPropertyIndex);
+    
     /**
      * Loads an array of objects from an FObjectData object.
      *
@@ -350,4 +618,304 @@ public:
      */
     UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorData")
     static bool LoadActorDataFromDiskCompressed(const FString& InFileName, FActorData& OutActorData);
+    
+    //
+    // PAYLOADS
+    //
+    
+    /**
+     * Copies a payload's bytes into an array. Payloads are shared between copies of a struct, the array isn't.
+     *
+     * @param InPayload Payload to copy.
+     *
+     * @return The payload's bytes
+     */
+    UFUNCTION(BlueprintPure, Category = "Numbskull|Payload")
+    static TArray<uint8> GetPayloadBytes(const FNumbskullPayload& InPayload);
+    
+    /**
+     * Size of a payload in bytes, without copying it.
+     *
+     * @param InPayload Payload to measure.
+     *
+     * @return Number of bytes in the payload
+     */
+    UFUNCTION(BlueprintPure, Category = "Numbskull|Payload")
+    static int32 GetPayloadSize(const FNumbskullPayload& InPayload);
+    
+    /**
+     * Wraps bytes in a payload.
+     *
+     * @param InBytes Bytes to wrap.
+     *
+     * @return A payload holding a copy of the bytes
+     */
+    UFUNCTION(BlueprintPure, Category = "Numbskull|Payload")
+    static FNumbskullPayload MakePayload(const TArray<uint8>& InBytes);
+    
+    //
+    // LOAD CACHE
+    //
+    
+    /**
+     * Counters of the load cache, enabled in the project settings.
+     *
+     * @return Hits, misses, evictions and memory used
+     */
+    UFUNCTION(BlueprintPure, Category = "Numbskull|LoadCache")
+    static FNumbskullLoadCacheStats GetLoadCacheStats();
+    
+    /** Sets the load cache's hit, miss and eviction counters back to zero*/
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|LoadCache")
+    static void ResetLoadCacheStats();
+    
+    /** Drops every file held by the load cache*/
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|LoadCache")
+    static void ClearLoadCache();
+    
+    //
+    // READING PROPERTIES
+    //
+    
+    /**
+     * Reads properties out of saved object data without loading it into an object.
+     *
+     * Uses the property index written by SaveObject and SaveObjects to skip straight to each property. Properties that
+     * weren't saved because they matched the class defaults return the default.
+     *
+     * @param InObjectData Data saved with SaveObject or SaveObjects.
+     * @param InClass Class of the saved object.
+     * @param InPropertyNames Properties to read.
+     * @param OutValues Each property that could be read, as text.
+     * @param InObjectIndex Which object to read from, for data saved with SaveObjects.
+     *
+     * @return True if every property was read, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Reading")
+    static bool ReadObjectDataProperties(const FObjectData& InObjectData, UClass* InClass, const TArray<FName>& InPropertyNames, TMap<FName, FString>& OutValues, int32 InObjectIndex = 0);
+    
+    /**
+     * Reads properties out of a saved actor proxy without spawning it.
+     *
+     * @param InActorProxy Proxy saved with SaveActor.
+     * @param InPropertyNames Properties to read.
+     * @param OutValues Each property that could be read, as text.
+     *
+     * @return True if every property was read, false if otherwise
+     * @see ReadObjectDataProperties
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Reading")
+    static bool ReadActorProxyProperties(const FActorProxy& InActorProxy, const TArray<FName>& InPropertyNames, TMap<FName, FString>& OutValues);
+    
+public:
+    
+    //
+    // BATCH LOADING
+    //
+    
+    /**
+     * Loads many object data files at once, reading and decoding them in parallel on the task graph's workers.
+     *
+     * Blocks the calling thread, usually the game thread, until every file is loaded or has failed. A file that fails
+     * doesn't stop the others from loading.
+     *
+     * @param InFileNames Full file paths to load.
+     * @param OutObjectData Loaded object data, in the same order as the file names. Empty for files that failed.
+     * @param OutLoaded Whether each file loaded.
+     * @param bCompressed Whether files saved before file headers were added are compressed. Newer files record it.
+     *
+     * @return True if every file loaded, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ObjectData")
+    static bool LoadObjectDataBatchFromDisk(const TArray<FString>& InFileNames, TArray<FObjectData>& OutObjectData, TArray<bool>& OutLoaded, bool bCompressed = false);
+    
+    /**
+     * Loads many actor data files at once, reading and decoding them in parallel. Blocks until every file is done.
+     *
+     * @see LoadObjectDataBatchFromDisk
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorData")
+    static bool LoadActorDataBatchFromDisk(const TArray<FString>& InFileNames, TArray<FActorData>& OutActorData, TArray<bool>& OutLoaded, bool bCompressed = false);
+    
+    /**
+     * Loads many actor proxy files at once, reading and decoding them in parallel. Blocks until every file is done.
+     *
+     * @see LoadObjectDataBatchFromDisk
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|ActorProxy")
+    static bool LoadActorProxyBatchFromDisk(const TArray<FString>& InFileNames, TArray<FActorProxy>& OutActorProxies, TArray<bool>& OutLoaded, bool bCompressed = false);
+    
+public:
+    
+    //
+    // STRUCT ARRAYS
+    //
+    
+    /**
+     * Serializes an array of structs into object data, without wrapping the elements in UObjects.
+     *
+     * Plain data structs are written as a single block. The data can be saved to disk like any other object data.
+     *
+     * @param InStruct Type of the elements.
+     * @param InElements The first element.
+     * @param InNum Number of elements.
+     * @param OutObjectData Replaced with the serialized array.
+     *
+     * @return True if successful, false if otherwise
+     */
+    static bool SaveStructArray(const UScriptStruct* InStruct, const void* InElements, int32 InNum, FObjectData& OutObjectData);
+    
+    /**
+     * Loads an array of structs saved with SaveStructArray into elements that are already constructed.
+     *
+     * @param InObjectData Object data holding the array.
+     * @param InStruct Type of the elements. Must have the same layout as when the array was saved.
+     * @param OutElements The first element to load into.
+     * @param InCapacity Number of elements there's room for.
+     * @param OutNum Number of elements loaded.
+     *
+     * @return True if successful, false if otherwise
+     */
+    static bool LoadStructArray(const FObjectData& InObjectData, const UScriptStruct* InStruct, void* OutElements, int32 InCapacity, int32& OutNum);
+    
+    /** Gets the number of elements in an array saved with SaveStructArray*/
+    static bool GetStructArrayNum(const FObjectData& InObjectData, int32& OutNum);
+    
+    /** Serializes an array of a USTRUCT into object data. @see SaveStructArray*/
+    template <typename StructType>
+    static bool SaveStructArray(const TArray<StructType>& InElements, FObjectData& OutObjectData)
+    {
+        return SaveStructArray(StructType::StaticStruct(), InElements.GetData(), InElements.Num(), OutObjectData);
+    }
+    
+    /** Loads an array of a USTRUCT, resizing it to fit but keeping its allocation. @see LoadStructArray*/
+    template <typename StructType>
+    static bool LoadStructArray(const FObjectData& InObjectData, TArray<StructType>& OutElements)
+    {
+        int32 Num = 0;
+        if (!GetStructArrayNum(InObjectData, Num))
+        {
+            return false;
+        }
+        
+        OutElements.SetNum(Num, false);
+        
+        if (!LoadStructArray(InObjectData, StructType::StaticStruct(), OutElements.GetData(), OutElements.Num(), Num))
+        {
+            OutElements.Reset();
+            return false;
+        }
+        
+        return true;
+    }
+    
+public:
+    
+    //
+    // NEW GAME
+    //
+    
+    /**
+     * Starts a new game in the current map, calling OnNewGame on every new game listener.
+     *
+     * If the map's new game has been baked with @see BakeNewGame, listeners that can be baked have their baked state
+     * applied instead. OnNewGame is then called on the rest, after every baked state has been applied.
+     * Listeners are the actors in the world and their components.
+     *
+     * @param WorldContextObject Current world context
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|NewGame", meta=(WorldContext = "WorldContextObject"))
+    static bool StartNewGame(const UObject* WorldContextObject);
+    
+    /**
+     * Calls OnNewGame on every new game listener in the current map that can be baked, and saves their state so
+     * @see StartNewGame can apply it rather than setting them up again.
+     *
+     * Run in a standalone game started on the map, such as with the Numbskull.BakeNewGame console command, and bake
+     * again whenever the map or the listeners change. Not available in play in editor.
+     *
+     * @param WorldContextObject Current world context
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|NewGame", meta=(WorldContext = "WorldContextObject"))
+    static bool BakeNewGame(const UObject* WorldContextObject);
+    
+    //
+    // SIZE REPORTS
+    //
+    
+    /**
+     * Reports where the bytes of objects go as they would be saved now, by class, object and top level property.
+     * Actors are serialized the way SaveActor does.
+     *
+     * @param InObjects Objects to measure.
+     * @param OutReport Rows sorted largest first, with sizes before and after compression.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Diagnostics")
+    static bool GetObjectsSizeReport(const TArray<UObject*>& InObjects, FNumbskullSizeReport& OutReport);
+    
+    /**
+     * Reports where the bytes of a save file go, by class, object and top level property, without loading it into the world.
+     * Also available as the Numbskull.SizeReport console command.
+     *
+     * @param InFileName Full file path.
+     * @param InType Storage type the file was saved as.
+     * @param OutReport Rows sorted largest first, with sizes before and after compression.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Diagnostics")
+    static bool GetSaveFileSizeReport(const FString& InFileName, ENumbskullStorageType InType, FNumbskullSizeReport& OutReport);
+    
+    /**
+     * Writes a size report as comma separated values, one row per line.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Diagnostics")
+    static bool SaveSizeReportToCsv(const FNumbskullSizeReport& InReport, const FString& InFileName);
+    
+    //
+    // SLOT ROTATION
+    //
+    
+    /**
+     * Saves bytes to a slot through a temporary file, keeping the previous versions as <Slot>.bak1 (newest) to .bakN.
+     * Backups are cloned or hard linked rather than copied where the filesystem allows it.
+     *
+     * Slots with backups should only be written with this, as writing them in place could change a hard linked backup.
+     *
+     * @param InFileName Full path of the slot.
+     * @param InBytes Bytes to save.
+     * @param InNumBackups Versions to keep besides the slot.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|Slots")
+    static bool SaveBytesToSlot(const FString& InFileName, const TArray<uint8>& InBytes, int32 InNumBackups = 3);
+    
+    /**
+     * Replaces a slot with one of its backups, such as when the slot fails to load.
+     *
+     * @param InFileName Full path of the slot.
+     * @param InVersion Which backup, where 1 is the newest.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|Slots")
+    static bool RestoreSlotBackup(const FString& InFileName, int32 InVersion = 1);
+    
+    /**
+     * Gets the versions of a slot's backups that exist, newest first.
+     *
+     * @param InFileName Full path of the slot.
+     * @param OutVersions Each backup's version, for @see RestoreSlotBackup.
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Saving|Slots")
+    static void GetSlotBackupVersions(const FString& InFileName, TArray<int32>& OutVersions);
 };
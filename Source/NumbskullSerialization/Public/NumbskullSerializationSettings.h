@@ -0,0 +1,95 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "NumbskullTransformCodec.h"
+#include "NumbskullSerializationSettings.generated.h"
+
+/**
+ * What compression should favour.
+ */
+UENUM()
+enum class ENumbskullCompressionBias : uint8
+{
+    /** The format's default balance*/
+    Default,
+
+    /** Faster compression, larger files*/
+    Speed,
+
+    /** Smaller files, slower compression*/
+    Size,
+};
+
+/**
+ * Project wide settings for the format of saved files.
+ *
+ * Found under Project Settings -> Plugins -> Numbskull Serialization.
+ * Loading always uses the format recorded in each file, so these settings can be changed without breaking existing saves.
+ */
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "Numbskull Serialization"))
+class NUMBSKULLSERIALIZATION_API UNumbskullSerializationSettings : public UDeveloperSettings
+{
+    GENERATED_BODY()
+
+public:
+
+    /** How actor proxy and actor data transforms are written to disk*/
+    UPROPERTY(config, EditAnywhere, Category = "Format")
+    FNumbskullTransformFormat TransformFormat;
+
+    /**
+     * Whether SaveObjects writes object references into a reference table instead of inline paths.
+     * References between the saved objects then survive renames, and are resolved by LoadObjects as they're read.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Format")
+    bool bUseReferenceTables = true;
+
+    /** Format used by the *Compressed save methods, such as Zlib, Gzip or LZ4. Recorded in each file*/
+    UPROPERTY(config, EditAnywhere, Category = "Compression")
+    FName CompressionFormat = NAME_Zlib;
+
+    /** What compression favours when saving*/
+    UPROPERTY(config, EditAnywhere, Category = "Compression")
+    ENumbskullCompressionBias CompressionBias = ENumbskullCompressionBias::Default;
+
+    /**
+     * Name of a dictionary trained by the save tool commandlet to compress against, which gives much better compression
+     * of small files. Overrides CompressionFormat with Zlib. Leave empty to compress without a dictionary.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Compression")
+    FString CompressionDictionary;
+
+    /**
+     * Whether SaveObject, SaveObjects and SaveActor index the properties they write, so single properties can be read
+     * from the saved data without loading it. Costs a few bytes per serialized property.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Format")
+    bool bWritePropertyIndexes = true;
+
+    /**
+     * Whether serialized object and actor data stores integers, bools, array lengths and enums as varints instead of at
+     * their full width. Usually shrinks uncompressed data considerably. Data written either way always loads.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Format")
+    bool bVarIntEncoding = false;
+
+    /**
+     * Keeps the decoded payloads of recently loaded files in memory, so loading the same file again skips the read
+     * and decompression. Files changed outside the library are detected by their size and modification time.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Load Cache")
+    bool bEnableLoadCache = false;
+
+    /** Most decoded bytes the load cache keeps, in kilobytes. The least recently loaded files are dropped first*/
+    UPROPERTY(config, EditAnywhere, Category = "Load Cache", meta = (ClampMin = "0", EditCondition = "bEnableLoadCache"))
+    int32 LoadCacheBudgetKB = 16384;
+
+    /** ECompressionFlags matching a bias*/
+    static uint32 GetCompressionFlags(ENumbskullCompressionBias InBias);
+
+    /** ECompressionFlags matching CompressionBias*/
+    uint32 GetCompressionFlags() const { return GetCompressionFlags(CompressionBias); }
+};
@@ -0,0 +1,124 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NumbskullSizeReport.generated.h"
+
+/** The library's storage types, for functions that read any of them from disk*/
+UENUM(BlueprintType)
+enum class ENumbskullStorageType : uint8
+{
+    ObjectData,
+    ActorData,
+    ActorProxy,
+    ActorProxyBatch,
+};
+
+UENUM(BlueprintType)
+enum class ENumbskullSizeReportKind : uint8
+{
+    /** Every object of a class together*/
+    Class,
+
+    /** A single object or actor*/
+    Object,
+
+    /** A top level property of a class, across every object of the class*/
+    Property,
+};
+
+/**
+ * Bytes attributed to a class, object or property.
+ */
+USTRUCT(BlueprintType)
+struct NUMBSKULLSERIALIZATION_API FNumbskullSizeReportRow
+{
+    GENERATED_BODY()
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    ENumbskullSizeReportKind Kind = ENumbskullSizeReportKind::Class;
+
+    /** Class path, object name or property name*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    FString Name;
+
+    /** Class the object or property belongs to. Same as Name for class rows*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    FString Class;
+
+    /** Objects of the class, or objects that serialized the property*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int32 Count = 0;
+
+    /** Serialized bytes before compression, including property tags*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 RawBytes = 0;
+
+    /** Bytes after compressing the row's data on its own*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 CompressedBytes = 0;
+};
+
+/**
+ * Where the bytes of a save go, by class, by object and by top level property.
+ *
+ * Every object's data is split at its property tags as the library's archive wrote them, so each property is charged for
+ * its tag and value. Whatever an object writes after its tagged properties, such as a native Serialize override, is
+ * charged to a "(native)" property, and data that couldn't be scanned to "(unparsed)". Reports read from a file also have
+ * a "(metadata)" class for the rest of the record: names, transforms, reference tables and property indexes, which is
+ * counted uncompressed.
+ *
+ * Compressed sizes compress each row's data on its own with the save's format, so they show how well a row compresses
+ * rather than adding up to the compressed total, and ignore any compression dictionary.
+ */
+USTRUCT(BlueprintType)
+struct NUMBSKULLSERIALIZATION_API FNumbskullSizeReport
+{
+    GENERATED_BODY()
+
+    /** Every row, largest first*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    TArray<FNumbskullSizeReportRow> Rows;
+
+    /** Bytes of everything that was measured before compression*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 TotalRawBytes = 0;
+
+    /** Bytes of everything that was measured, compressed together*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 TotalCompressedBytes = 0;
+
+    /** Size of the file the report was read from, or zero for live objects*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    int64 FileBytes = 0;
+
+    /** Format compressed sizes were measured with, or None if they weren't compressed*/
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
+    FName CompressionFormat;
+
+    /**
+     * Measures objects as they would be saved now. Actors are serialized the way SaveActor does.
+     *
+     * @return False if there were no objects to measure
+     */
+    static bool FromObjects(const TArray<UObject*>& InObjects, FNumbskullSizeReport& OutReport);
+
+    /**
+     * Measures a save file without loading anything into the world. Object data files only split into objects when
+     * they were saved with a property index, and don't know their classes.
+     *
+     * @param bLegacyCompressed Whether the file is compressed, only used for files saved before the header was added.
+     *
+     * @return False if the file couldn't be read as the storage type
+     */
+    static bool FromFile(const FString& InFileName, ENumbskullStorageType InType, FNumbskullSizeReport& OutReport, bool bLegacyCompressed = false);
+
+    /** The rows as comma separated values, with a header line*/
+    FString ToCsv() const;
+
+    bool SaveToCsv(const FString& InFileName) const;
+
+    /** Logs the totals and the largest rows as a table*/
+    void Log(int32 InMaxRows = 50) const;
+};
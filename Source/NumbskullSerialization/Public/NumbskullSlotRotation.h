@@ -0,0 +1,63 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Saves slots while keeping their last few versions as backups, without writing the old bytes out again.
+ *
+ * New data is written to a temporary file and flushed to the disk, then replaces the slot with a rename, so neither a
+ * crash nor a power cut mid-save leaves a torn slot. Before that, the slot is kept as <Slot>.bak1, pushing the older backups along and dropping the oldest. Where the
+ * filesystem supports it the backup is a copy on write clone (FICLONE on btrfs and XFS, clonefile on APFS) or else a hard
+ * link, both of which are instant. Only if neither works is the slot copied, on a pool thread while the new data is
+ * written, and the save waits for the copy before replacing the slot.
+ *
+ * A hard linked backup shares its bytes with the slot until the slot is replaced. The library never writes a file in
+ * place, SaveBytesToDisk included, but anything else that writes into the slot changes the newest backup too.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullSlotRotation
+{
+public:
+
+    /**
+     * Saves bytes to a slot, keeping what was there as the newest backup.
+     *
+     * @param InFileName Full path of the slot.
+     * @param InBytes Bytes to save.
+     * @param InNumBackups Versions to keep besides the slot. Any backups beyond this are deleted.
+     *
+     * @return False if the slot couldn't be written. Failing to back it up only logs a warning
+     */
+    static bool Save(const FString& InFileName, const TArray<uint8>& InBytes, int32 InNumBackups);
+
+    /**
+     * Replaces a slot with one of its backups. The backups stay as they are.
+     *
+     * @param InVersion Which backup, where 1 is the newest.
+     *
+     * @return False if the backup doesn't exist or the slot couldn't be replaced
+     */
+    static bool Restore(const FString& InFileName, int32 InVersion);
+
+    /** Versions of a slot's backups that exist, newest first*/
+    static TArray<int32> GetBackupVersions(const FString& InFileName);
+
+    static FString GetBackupFileName(const FString& InFileName, int32 InVersion);
+
+    /** Renames a file over another, atomically where the platform allows it. The rename is flushed to the disk too*/
+    static bool ReplaceFile(const FString& InFrom, const FString& InTo);
+
+    /** Writes bytes to a file and flushes them to the disk, so they survive a power cut once it returns*/
+    static bool WriteFileFlushed(const FString& InFileName, const TArray<uint8>& InBytes);
+
+private:
+
+    /** Deletes backups past the last one kept and renames the rest one version older, freeing version 1*/
+    static void RotateBackups(const FString& InFileName, int32 InNumBackups);
+
+    /** Clones a file with copy on write where the filesystem supports it*/
+    static bool CloneFile(const FString& InFrom, const FString& InTo);
+
+    static bool LinkFile(const FString& InFrom, const FString& InTo);
+};
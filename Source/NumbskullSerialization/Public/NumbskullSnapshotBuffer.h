@@ -0,0 +1,149 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "ObjectData.h"
+#include "NumbskullSnapshotBuffer.generated.h"
+
+/**
+ * Keeps a rolling history of in-memory snapshots of a set of objects, for checkpoints and rewinding.
+ *
+ * Only the newest snapshot is stored in full. Each older snapshot is stored as the XOR of itself and the next newer one,
+ * compressed. Consecutive snapshots are usually almost identical, so the XOR is mostly zeros and compresses to a tiny
+ * fraction of a full copy. Every KeyframeInterval snapshots a full compressed copy is kept instead to bound restore time.
+ *
+ * Restoring walks back from the newest snapshot (or nearest keyframe), applying deltas until it reaches the requested
+ * snapshot, then loads it with LoadObjects. The oldest snapshots are dropped when the buffer is full or over budget.
+ *
+ * The same objects, in the same order, must be passed to Capture and Restore.
+ */
+UCLASS(BlueprintType)
+class NUMBSKULLSERIALIZATION_API UNumbskullSnapshotBuffer : public UObject
+{
+    GENERATED_BODY()
+
+public:
+
+    /**
+     * Creates a snapshot buffer.
+     *
+     * @param Outer Object that owns the buffer.
+     * @param InMaxSnapshots Most snapshots to keep.
+     * @param InMemoryBudgetKB Most memory the snapshots can use, in kilobytes. Zero for no limit.
+     * @param InKeyframeInterval Keeps a full copy every this many snapshots. Zero to only keep deltas.
+     *
+     * @return The new snapshot buffer
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Snapshots", meta = (DefaultToSelf = "Outer"))
+    static UNumbskullSnapshotBuffer* CreateSnapshotBuffer(UObject* Outer, int32 InMaxSnapshots = 600, int32 InMemoryBudgetKB = 65536, int32 InKeyframeInterval = 60);
+
+    /**
+     * Captures a new snapshot of the objects, dropping the oldest snapshots if needed.
+     *
+     * @param InObjects Objects to capture.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Snapshots")
+    bool Capture(const TArray<UObject*>& InObjects);
+
+    /**
+     * Rebuilds a snapshot without applying it.
+     *
+     * @param InSnapshotsAgo Zero for the newest snapshot, one for the one before it and so on.
+     * @param OutObjectData The snapshot's data, ready for LoadObjects.
+     *
+     * @return True if the snapshot exists, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Snapshots")
+    bool GetSnapshot(int32 InSnapshotsAgo, FObjectData& OutObjectData) const;
+
+    /**
+     * Applies a snapshot to the objects.
+     *
+     * @param InSnapshotsAgo Zero for the newest snapshot, one for the one before it and so on.
+     * @param InObjects Objects to load, in the same order they were captured.
+     * @param bDiscardNewer Drops the snapshots newer than the restored one, as a rewind would.
+     *
+     * @return True if successful, false if otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Snapshots")
+    bool Restore(int32 InSnapshotsAgo, const TArray<UObject*>& InObjects, bool bDiscardNewer = true);
+
+    /** Drops every snapshot*/
+    UFUNCTION(BlueprintCallable, Category = "Numbskull|Snapshots")
+    void Reset();
+
+    /** Number of snapshots stored*/
+    UFUNCTION(BlueprintPure, Category = "Numbskull|Snapshots")
+    int32 Num() const { return Snapshots.Num(); }
+
+    /** Memory used by the snapshots, in bytes*/
+    UFUNCTION(BlueprintPure, Category = "Numbskull|Snapshots")
+    int64 GetMemoryUsage() const { return MemoryUsage; }
+
+    /** Most snapshots to keep*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Numbskull|Snapshots", meta = (ClampMin = "1"))
+    int32 MaxSnapshots = 600;
+
+    /** Most memory the snapshots can use, in kilobytes. Zero for no limit. The newest snapshot is always kept*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Numbskull|Snapshots", meta = (ClampMin = "0"))
+    int32 MemoryBudgetKB = 65536;
+
+    /** Keeps a full copy every this many snapshots so restoring old snapshots doesn't apply every delta. Zero to only keep deltas*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Numbskull|Snapshots", meta = (ClampMin = "0"))
+    int32 KeyframeInterval = 60;
+
+private:
+
+    struct FStoredSnapshot
+    {
+        /** Compressed full data (keyframe) or compressed XOR against the next newer snapshot (delta)*/
+        TArray<uint8> Block;
+
+        /** Size of the snapshot's data once rebuilt*/
+        int32 RawSize = 0;
+
+        /** Size of Block once uncompressed. Deltas are as long as the longer of the two snapshots*/
+        int32 BlockSize = 0;
+
+        /** Whether Block holds the full data rather than a delta*/
+        bool bKeyframe = false;
+
+        /** Whether Block is compressed. Blocks that don't shrink are kept raw*/
+        bool bCompressed = false;
+
+        /** Reference table of the snapshot's data*/
+        TSharedPtr<const FNumbskullReferenceTable> References;
+
+        int64 GetMemoryUsage() const { return Block.GetAllocatedSize(); }
+    };
+
+    /** Replaces the newest snapshot's full data with a block relative to the new snapshot*/
+    void DemoteNewest(const TArray<uint8>& InNewData);
+
+    /** Removes the oldest snapshots until within the limits*/
+    void EnforceLimits();
+
+    /** Rebuilds the raw data of a stored snapshot*/
+    bool Rebuild(int32 InSnapshotsAgo, TArray<uint8>& OutData) const;
+
+    static void StoreBlock(FStoredSnapshot& Snapshot, const TArray<uint8>& InRaw);
+    static bool LoadBlock(const FStoredSnapshot& Snapshot, TArray<uint8>& OutRaw);
+
+    /** Makes Target the XOR of itself and Source, resizing it to InResultSize*/
+    static void XorInto(TArray<uint8>& Target, const TArray<uint8>& Source, int32 InResultSize);
+
+    /** Stored snapshots, oldest first. The newest is always a keyframe with an empty Block, its data is in NewestData*/
+    TArray<FStoredSnapshot> Snapshots;
+
+    /** Full data of the newest snapshot*/
+    TArray<uint8> NewestData;
+
+    /** Number of snapshots captured, used to place keyframes*/
+    int64 CaptureCount = 0;
+
+    int64 MemoryUsage = 0;
+};
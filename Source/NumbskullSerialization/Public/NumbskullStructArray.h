@@ -0,0 +1,50 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ObjectData.h"
+
+/**
+ * Serializes arrays of a UScriptStruct straight into object data, without wrapping each element in a UObject.
+ *
+ * Structs made only of plain data (numbers, enums, native bools and structs of the same) are written as one block of
+ * memory. Any other struct is written with a plan worked out once per struct, and again whenever its layout changes: runs
+ * of plain data properties are copied as they are and the rest are serialized individually through the library's archive,
+ * so names and object references are written as strings. Transient properties are left out of planned structs.
+ *
+ * Either way the data carries a hash of the struct's layout, and loading fails if the struct has changed since it was
+ * saved. The data can only be read back as a struct array, not applied to objects.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullStructArray
+{
+public:
+
+    /**
+     * Serializes an array of structs.
+     *
+     * @param InStruct Type of the elements.
+     * @param InElements The first element.
+     * @param InNum Number of elements.
+     * @param OutObjectData Replaced with the serialized array.
+     *
+     * @return False if the struct or elements are missing
+     */
+    static bool Save(const UScriptStruct* InStruct, const void* InElements, int32 InNum, FObjectData& OutObjectData);
+
+    /**
+     * Loads a serialized array into elements that are already constructed.
+     *
+     * @param InCapacity Number of elements OutElements has room for.
+     * @param OutNum Number of elements loaded.
+     *
+     * @return False if the data isn't an array of this struct, the struct has changed or there's not enough room
+     */
+    static bool Load(const FObjectData& InObjectData, const UScriptStruct* InStruct, void* OutElements, int32 InCapacity, int32& OutNum);
+
+    /** Gets the number of elements in a serialized array, so room can be made for them before loading*/
+    static bool GetNum(const FObjectData& InObjectData, int32& OutNum);
+
+    /** Whether a struct is written as a single block of memory*/
+    static bool IsPlainData(const UScriptStruct* InStruct);
+};
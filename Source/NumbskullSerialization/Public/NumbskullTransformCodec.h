@@ -0,0 +1,121 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NumbskullTransformCodec.generated.h"
+
+/**
+ * How transforms stored in actor proxies and actor data are written to disk.
+ */
+UENUM(BlueprintType)
+enum class ENumbskullTransformEncoding : uint8
+{
+    /** Full precision FTransform. Lossless*/
+    Full,
+
+    /** Quantized translation, smallest-three rotation and a unit scale bit or half precision scale. Lossy, see FNumbskullTransformFormat for error bounds*/
+    Compact
+};
+
+/**
+ * Describes how transforms are encoded. Recorded in each file header so loaders decode it automatically.
+ *
+ * Error bounds of the compact encoding:
+ * - Translation: at most TranslationPrecision / 2 per axis, plus the rounding of the loaded value to a float, which is
+ *   about |x| * 6e-8. The error stays below TranslationPrecision up to TranslationPrecision * 2^23 from the origin (about
+ *   840m at the default 0.01cm) and grows with the distance past that. Values beyond +/- TranslationPrecision * 2^31 are clamped.
+ * - Rotation: each of the three smallest quaternion components has an error of at most 2.2e-5, which is below 0.005 degrees.
+ * - Scale: a scale within 1e-4 of one on every axis loads as exactly one, so is off by up to 1e-4. Otherwise a relative error
+ *   of 0.05% (half precision) or exact (full precision). Scales a half precision float can't hold, above 65504 or with a
+ *   component closer to zero than 6.1e-5, are stored at full precision instead.
+ */
+USTRUCT(BlueprintType)
+struct NUMBSKULLSERIALIZATION_API FNumbskullTransformFormat
+{
+    GENERATED_BODY()
+
+    /** Encoding used for every transform in the file*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category= "Numbskull")
+    ENumbskullTransformEncoding Encoding = ENumbskullTransformEncoding::Full;
+
+    /** Size of one translation step in centimetres when using the compact encoding*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category= "Numbskull", meta=(ClampMin="0.0001", EditCondition="Encoding == ENumbskullTransformEncoding::Compact"))
+    float TranslationPrecision = 0.01f;
+
+    /** Stores non-unit scales as half precision floats when using the compact encoding*/
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category= "Numbskull", meta=(EditCondition="Encoding == ENumbskullTransformEncoding::Compact"))
+    bool bHalfPrecisionScale = true;
+
+    friend FArchive& operator << (FArchive& Ar, FNumbskullTransformFormat& Format)
+    {
+        Ar << Format.Encoding;
+        Ar << Format.TranslationPrecision;
+        Ar << Format.bHalfPrecisionScale;
+        return Ar;
+    }
+};
+
+/**
+ * A transform in the compact encoding. See FNumbskullTransformFormat for error bounds.
+ */
+struct NUMBSKULLSERIALIZATION_API FNumbskullCompactTransform
+{
+    /** Index of the dropped (largest) rotation component and scale flags*/
+    uint8 Flags = 0;
+
+    /** The three smallest rotation components*/
+    int16 Rotation[3] = { 0, 0, 0 };
+
+    /** Translation in steps of TranslationPrecision*/
+    int32 Translation[3] = { 0, 0, 0 };
+
+    /** Only stored when the scale isn't one*/
+    FVector Scale = FVector::OneVector;
+
+    bool HasUnitScale() const;
+    bool HasHalfPrecisionScale() const;
+
+    /** Serializes the stored scale (if there is one)*/
+    void SerializeScale(FArchive& Ar);
+};
+
+/**
+ * Reads and writes transforms in the format described by FNumbskullTransformFormat.
+ */
+struct NUMBSKULLSERIALIZATION_API FNumbskullTransformCodec
+{
+    /**
+     * Serializes a transform using the given format.
+     *
+     * @param Ar Archive to read from or write to.
+     * @param Transform Transform to serialize.
+     * @param Format Format the transform is (or will be) encoded in.
+     */
+    static void Serialize(FArchive& Ar, FTransform& Transform, const FNumbskullTransformFormat& Format);
+
+    /**
+     * Serializes an array of transforms using the given format.
+     *
+     * The compact encoding is written column by column (flags, rotations, translations, scales) so similar data sits together,
+     * and all transforms are decoded in a single pass once the columns are read.
+     *
+     * @param Ar Archive to read from or write to.
+     * @param Transforms Transforms to serialize.
+     * @param Format Format the transforms are (or will be) encoded in.
+     */
+    static void SerializeArray(FArchive& Ar, TArray<FTransform>& Transforms, const FNumbskullTransformFormat& Format);
+
+    /**
+     * Serializes a transform using the compact encoding.
+     *
+     * Layout: 1 byte (largest rotation component index and scale flags), 3 x int16 rotation, 3 x int32 translation, optional scale.
+     */
+    static void SerializeCompact(FArchive& Ar, FTransform& Transform, const FNumbskullTransformFormat& Format);
+
+    /** Quantizes a transform*/
+    static FNumbskullCompactTransform Encode(const FTransform& Transform, const FNumbskullTransformFormat& Format);
+
+    /** Restores a quantized transform*/
+    static FTransform Decode(const FNumbskullCompactTransform& Compact, const FNumbskullTransformFormat& Format);
+};
@@ -0,0 +1,82 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/MemoryWriter.h"
+
+/**
+ * Compact encoding of serialized data that stores integers as varints.
+ *
+ * Archives write every integer, bool, array length and enum at a fixed width, and most of them are small, so much of the
+ * data is zero padding. Encoded data stores each 2, 4 and 8 byte value as a zigzag LEB128 varint, keeping values that
+ * wouldn't shrink (such as most floats) as they are.
+ *
+ * Encoded data starts with Magic so it's recognized wherever it's applied. Data without it is read as it always was.
+ *
+ * Layout: [Magic][varint raw size][varint control size][control bytes][value bytes]. Each control byte describes a run of
+ * values: the top two bits are the width (raw bytes, 2, 4 or 8 byte varints) and the low six bits the count.
+ */
+struct NUMBSKULLSERIALIZATION_API FNumbskullVarInt
+{
+    /** 'NSKV'. Far too large to be the string or array length unencoded data starts with*/
+    static const uint32 Magic;
+
+    /** Whether data was written by @see FNumbskullVarIntWriter with encoding on*/
+    static bool IsEncoded(const uint8* InData, int64 InNumBytes);
+
+    static bool IsEncoded(const TArray<uint8>& InData) { return IsEncoded(InData.GetData(), InData.Num()); }
+
+    /**
+     * Decodes data back into exactly what the archive wrote, in one pass.
+     *
+     * @param InData Encoded data.
+     * @param InNumBytes Size of the encoded data.
+     * @param OutRawBytes The data as it was written.
+     *
+     * @return False if the data is corrupt
+     */
+    static bool Decode(const uint8* InData, int64 InNumBytes, TArray<uint8>& OutRawBytes);
+};
+
+/**
+ * Memory writer that encodes what it writes with @see FNumbskullVarInt once finished.
+ *
+ * Archives don't say which values are integers, so every 2, 4 or 8 byte write appended to the data is treated as a
+ * candidate. Everything is written raw first, so seeking back to patch values (as property tags do with their size)
+ * works as normal. Positions such as Tell() refer to the raw data, which is what readers see after decoding.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullVarIntWriter : public FMemoryWriter
+{
+public:
+
+    /**
+     * @param InBytes Array to write into. Replaced by the encoded data on Finish.
+     * @param bInEncode Whether to encode. Behaves like a plain memory writer if false.
+     */
+    FNumbskullVarIntWriter(TArray<uint8>& InBytes, bool bInEncode);
+
+    virtual void Serialize(void* Data, int64 Num) override;
+
+    virtual FString GetArchiveName() const override { return TEXT("FNumbskullVarIntWriter"); }
+
+    /** Encodes everything written. Nothing can be written afterwards*/
+    void Finish();
+
+private:
+
+    struct FCandidate
+    {
+        int64 Offset;
+        int32 Width;
+    };
+
+    TArray<uint8>& OutBytes;
+
+    bool bEncode;
+
+    bool bFinished = false;
+
+    /** Writes that could be integers, in the order they were appended*/
+    TArray<FCandidate> Candidates;
+};
@@ -0,0 +1,190 @@
+// Copyright 2019-2020 James Kelly, Michael Burdge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+#include "ObjectData.h"
+
+/**
+ * Counters describing what a write queue has done.
+ */
+struct NUMBSKULLSERIALIZATION_API FNumbskullWriteQueueStats
+{
+    /** Writes submitted*/
+    int64 Submitted = 0;
+
+    /** Writes replaced by a newer write to the same file before they reached the disk*/
+    int64 Coalesced = 0;
+
+    /** Files written*/
+    int64 Written = 0;
+
+    /** Files that failed to write*/
+    int64 Failed = 0;
+};
+
+/** How waiting for a write ended*/
+enum class ENumbskullWriteResult : uint8
+{
+    /** The write and every write before it are on disk*/
+    Written,
+
+    /** The write or one before it couldn't be written, so not all of them are on disk*/
+    Failed,
+
+    /** They weren't all finished before the timeout*/
+    TimedOut,
+};
+
+/**
+ * Writes files from any thread, such as gameplay tasks persisting their results from worker threads.
+ *
+ * Submitting a write never takes a lock: it's pushed onto a lock free queue that a single background thread drains. Each
+ * time it drains, writes to the same file are collapsed so only the last one submitted reaches the disk. Files are replaced
+ * through a temporary file that's flushed to the disk first, so a crash or power cut mid-write leaves the previous one intact.
+ *
+ * Every write gets a ticket, increasing in submission order. WaitFor blocks until that write and every write submitted
+ * before it have been written (or replaced by a newer write that has) and flushed to the disk, so a fence is just the
+ * ticket of the last write. A write that fails fails every ticket it completes, and from then on every wait for a ticket
+ * at or after the first failed one reports the failure, since not everything before it reached the disk.
+ * Queued writes are written when the queue is destroyed.
+ */
+class NUMBSKULLSERIALIZATION_API FNumbskullWriteQueue
+{
+public:
+
+    FNumbskullWriteQueue();
+
+    ~FNumbskullWriteQueue();
+
+    /**
+     * Queues object data to be saved to a file, as SaveObjectDataToDisk would.
+     *
+     * @param InFileName Full file path.
+     * @param InObjectData Data to save. Shares its payload rather than copying it.
+     * @param bCompressed Whether to save it compressed.
+     *
+     * @return Ticket of the write, or 0 if there's nothing to write
+     */
+    uint64 Submit(const FString& InFileName, const FObjectData& InObjectData, bool bCompressed = false);
+
+    /**
+     * Queues bytes to be written to a file as they are, as SaveBytesToDisk would.
+     *
+     * @return Ticket of the write, or 0 if there's nothing to write
+     */
+    uint64 SubmitBytes(const FString& InFileName, const FNumbskullPayload& InBytes);
+
+    /** Ticket of the last write submitted. Waiting for it waits for everything submitted so far*/
+    uint64 Fence() const { return LastTicket; }
+
+    /** Whether a write and every write before it have finished, whether or not they were written*/
+    bool IsDone(uint64 InTicket) const { return InTicket <= DoneTicket; }
+
+    /** Whether a write and every write before it are on disk*/
+    bool IsWritten(uint64 InTicket) const { return IsDone(InTicket) && InTicket < FirstFailedTicket; }
+
+    /**
+     * Waits until a write and every write before it have finished.
+     *
+     * @param InTicket Ticket returned when submitting, or from Fence.
+     * @param InTimeoutSeconds Longest to wait. Waits indefinitely if negative.
+     *
+     * @return Whether they were all written, one of them failed or it timed out
+     */
+    ENumbskullWriteResult WaitFor(uint64 InTicket, float InTimeoutSeconds = -1.0f) const;
+
+    /**
+     * Waits until everything submitted so far has finished.
+     *
+     * @return False if any of it couldn't be written
+     */
+    bool Flush() { return WaitFor(Fence()) == ENumbskullWriteResult::Written; }
+
+    FNumbskullWriteQueueStats GetStats() const;
+
+private:
+
+    struct FWrite
+    {
+        FString FileName;
+
+        FObjectData ObjectData;
+
+        /** Written as they are instead of ObjectData, when set*/
+        FNumbskullPayload Bytes;
+
+        bool bRawBytes = false;
+
+        bool bCompressed = false;
+
+        uint64 Ticket = 0;
+    };
+
+    /** A file's latest write in a drained batch, and the tickets it completes*/
+    struct FCoalescedWrite
+    {
+        FWrite Write;
+
+        TArray<uint64> Tickets;
+    };
+
+    class FWriter : public FRunnable
+    {
+    public:
+
+        FWriter(FNumbskullWriteQueue& InQueue) : Queue(InQueue), bStopping(false) {}
+
+        virtual uint32 Run() override;
+
+        virtual void Stop() override;
+
+    private:
+
+        FNumbskullWriteQueue& Queue;
+
+        TAtomic<bool> bStopping;
+    };
+
+    uint64 Enqueue(FWrite&& InWrite);
+
+    /** Writes everything in the queue. Returns false if it was empty*/
+    bool DrainAndWrite();
+
+    bool WriteFile(const FWrite& InWrite);
+
+    /** Records tickets as done and moves DoneTicket past every ticket before the first one that isn't*/
+    void CompleteTickets(const TArray<uint64>& InTickets, bool bWritten);
+
+    TQueue<FWrite, EQueueMode::Mpsc> Pending;
+
+    /** Only used by the writer thread*/
+    TSet<uint64> CompletedOutOfOrder;
+
+    TAtomic<uint64> LastTicket;
+
+    TAtomic<uint64> DoneTicket;
+
+    /** Lowest ticket whose write failed, or MAX_uint64 if none has*/
+    TAtomic<uint64> FirstFailedTicket;
+
+    TAtomic<int64> NumSubmitted;
+
+    TAtomic<int64> NumCoalesced;
+
+    TAtomic<int64> NumWritten;
+
+    TAtomic<int64> NumFailed;
+
+    /** Wakes the writer when something is submitted*/
+    FEvent* SubmittedEvent = nullptr;
+
+    /** Triggered after every batch is written, so waiters can check again*/
+    FEvent* WrittenEvent = nullptr;
+
+    TUniquePtr<FWriter> Writer;
+
+    FRunnableThread* Thread = nullptr;
+};
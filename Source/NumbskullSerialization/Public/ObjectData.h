@@ -3,6 +3,10 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "NumbskullFileHeader.h"
+#include "NumbskullPayload.h"
+#include "NumbskullPropertyIndex.h"
+#include "NumbskullReferenceTable.h"
 #include "ObjectData.generated.h"
 
 /**
@@ -13,13 +17,43 @@ struct NUMBSKULLSERIALIZATION_API FObjectData
 {
     GENERATED_BODY()
     
-    /** Binary data to read back into an object or save to disk*/
+    /** Binary data to read back into an object or save to disk. Shared between copies of the struct*/
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category= "Numbskull")
-	TArray<uint8> Data;
+	FNumbskullPayload Data;
+    
+    /** Objects referenced by Data when saved with SaveObjects. Written by operator<< whenever it's enabled*/
+    UPROPERTY()
+    FNumbskullReferenceTable References;
+    
+    /** Where each property starts in Data, so single properties can be read without loading. Not written by operator<<*/
+    UPROPERTY()
+    FNumbskullPropertyIndex PropertyIndex;
+    
+    /** Written by operator<< in place of the size of Data when a reference table follows it. No array has a negative size*/
+    static const int32 ReferenceTableMarker = -1;
     
     friend FArchive& operator << (FArchive& Ar, FObjectData& Object)
     {
-        Ar << Object.Data;
+        Object.SerializeStream(Ar);
         return Ar;
     }
+    
+    /** Serializes Data, followed by References if the data can't be read without them. Data without a table reads as a plain byte array*/
+    void SerializeStream(FArchive& Ar);
+
+    /** Serializes the data in the format described by a file header. Legacy headers match operator<< without a reference table*/
+    void SerializeVersioned(FArchive& Ar, const FNumbskullFileHeader& Header)
+    {
+        Ar << Data;
+        
+        if (Header.Version >= ENumbskullFileVersion::AddedReferenceTable)
+        {
+            Ar << References;
+        }
+        
+        if (Header.Version >= ENumbskullFileVersion::AddedPropertyIndex)
+        {
+            Ar << PropertyIndex;
+        }
+    }
 };